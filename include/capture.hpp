@@ -0,0 +1,93 @@
+/**
+ * @file capture.hpp
+ * @brief Header file for the wire capture (Capture, CaptureRecord)
+ * @author Martin Mendl <x247581>
+ * @date 18.4.2025
+*/
+
+#ifndef CAPTURE_HPP
+#define CAPTURE_HPP
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "utils.hpp"
+
+/// Magic bytes at the start of a capture file (the last byte is the layout version).
+#define CAPTURE_MAGIC "IPKCAPT1"
+
+/**
+ * @struct CaptureFileHeader
+ * @brief Header of a capture file.
+ */
+struct CaptureFileHeader {
+    char magic[8];       ///< CAPTURE_MAGIC.
+    uint8_t transport;   ///< Mode the chunks were captured with.
+    uint8_t reserved[7]; ///< Zero.
+};
+
+/**
+ * @struct CaptureRecordHeader
+ * @brief Header of one captured chunk, followed by the raw bytes.
+ */
+struct CaptureRecordHeader {
+    uint64_t ns;         ///< Monotonic ns since the capture was opened.
+    uint32_t length;     ///< Number of bytes that follow.
+    uint8_t outgoing;    ///< 1 if the client sent the chunk, 0 if it was received.
+    uint8_t reserved[3]; ///< Zero.
+};
+
+/**
+ * @struct CaptureRecord
+ * @brief One chunk loaded from a capture file.
+ */
+struct CaptureRecord {
+    uint64_t ns;       ///< Monotonic ns since the capture was opened.
+    bool outgoing;     ///< The client sent the chunk.
+    std::string data;  ///< Raw TCP chunk or UDP datagram.
+};
+
+/**
+ * @class Capture
+ * @brief Append-only recording of every raw chunk the client sends or receives.
+ *
+ * Chunks are appended through a stdio buffer, which exit() flushes, so the
+ * capture survives every way the client ends.
+ */
+class Capture {
+    public:
+        /**
+         * @brief Starts capturing into a file.
+         * @param path Path of the capture file (truncated).
+         * @param transport Transport the client uses.
+         * @return True if the file was opened.
+         */
+        static bool open(const std::string& path, Mode transport);
+
+        /**
+         * @brief Appends a chunk (no-op when not capturing).
+         * @param outgoing True for sent chunks.
+         * @param data Pointer to the raw bytes.
+         * @param length Number of bytes.
+         */
+        static void record(bool outgoing, const char* data, std::size_t length);
+
+        /// Flushes the buffered chunks to the file.
+        static void flush();
+
+        /**
+         * @brief Loads a whole capture file.
+         * @param path Path of the capture file.
+         * @param transport Set to the transport of the capture.
+         * @param records Filled with the chunks in capture order.
+         * @return Empty string on success, otherwise the error.
+         */
+        static std::string load(const std::string& path, Mode& transport, std::vector<CaptureRecord>& records);
+
+    private:
+        static FILE* file;        ///< Capture file (nullptr when not capturing).
+        static uint64_t startNs;  ///< Time the capture was opened.
+};
+
+#endif // CAPTURE_HPP
@@ -9,22 +9,75 @@
 #define CHAT_HPP
 
 #include <string>
+#include <string_view>
 #include <vector>
+#include <deque>
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <thread>
 #include <netinet/in.h>
 #include "command.hpp"
 #include "message.hpp"
+#include "pool.hpp"
 #include "settings.hpp"
 #include "utils.hpp"
-#include "messageBuffer.hpp"
+#include "latency.hpp"
+#include "counters.hpp"
+#include "trace.hpp"
+#include "capture.hpp"
+#include "history.hpp"
+#include "messageLog.hpp"
+#include "script.hpp"
+#include "rateLimiter.hpp"
+#include "ring.hpp"
+#include "socketOptions.hpp"
+
+/// First reconnect delay (doubled per attempt).
+#define RECONNECT_BASE_DELAY_MS 100
+/// Longest reconnect delay.
+#define RECONNECT_MAX_DELAY_MS 10000
+/// MSG contents from this size on are written from the message itself, not copied into the TCP frame.
+#define TCP_GATHER_SIZE 4096
+/// Zero-copy sends waiting for their completion at most, further large MSGs are copied until some complete.
+#define ZEROCOPY_MAX_IN_FLIGHT 1024
+/// Bytes the socket may be behind before stdin is not read any more (a script and /sendfile wait for any).
+#define SEND_UNSENT_MAX (1 << 20)
+/// Datagrams the network thread can queue for the protocol thread (--pipeline).
+#define PIPELINE_RING_SIZE 4096
+/// Queued datagrams handled per wake-up of the protocol thread.
+#define PIPELINE_BATCH 64
+
+/**
+ * @class ConnectionLost
+ * @brief Thrown when the connection breaks and reconnecting is enabled.
+ *
+ * A broken connection is noticed deep inside the send and wait loops;
+ * the exception unwinds them back to the event loop, which reconnects.
+ */
+class ConnectionLost : public std::runtime_error {
+    public:
+        /// Constructs the exception with the reason of the loss.
+        ConnectionLost(const std::string& reason) : std::runtime_error(reason) {};
+};
 
 /**
  * @class Chat
- * @brief Abstract base class providing the common framework for TCP and UDP chat implementations.
+ * @brief Base class template providing the common framework for TCP and UDP chat implementations.
  *
- * This class defines a common interface for TCP and UDP chat clients.
  * It manages the finite state machine (FSM) logic, user input handling,
- * and polling for I/O. Subclasses implement protocol-specific behavior.
+ * and polling for I/O. The transport derives from Chat<Transport> (CRTP)
+ * and implements the protocol-specific hooks listed below; they are
+ * resolved at compile time, so the send/receive/parse path can be inlined
+ * end to end. A transport also provides its static description: `mode`,
+ * `name` (the -t value), `peekType(std::string_view)`, whether it counts
+ * incoming frames when reading the socket (`countsFramesOnRead`, otherwise
+ * when parsing them) and `isRetransmit(previous, chunk)` for two sent
+ * chunks, which the replay uses. The member definitions live in
+ * chatImpl.hpp, the transport's source file includes it and explicitly
+ * instantiates Chat<Transport>, so adding a transport does not touch the core.
  */
+template <typename Transport>
 class Chat {
     public:
         /**
@@ -33,8 +86,8 @@ class Chat {
          */
         Chat(NetworkAdress& receiver);
     
-        /// Virtual destructor.
-        virtual ~Chat() {};
+        /// Destructor.
+        ~Chat() {};
     
         /**
          * @brief Starts the main polling loop to send and receive messages.
@@ -43,75 +96,255 @@ class Chat {
          * and transitions between FSM states accordingly.
          */
         void eventLoop();
+
+        /**
+         * @brief Replays a capture file instead of running the event loop.
+         *
+         * Offline (speed 0) the received chunks go straight through the framing,
+         * parser and FSM and the sent ones only through the FSM, as fast as
+         * possible. With speed > 0 the sent chunks are written to the server at
+         * speed times the captured pace and its live answers are handled.
+         * @param path Capture file.
+         * @param speed Multiple of the captured pace, 0 for offline.
+         */
+        void replay(const std::string& path, double speed);
+
+        /**
+         * @brief Sets the memory budget of the message history.
+         * @param bytes Budget in bytes.
+         */
+        void setHistoryBudget(std::size_t bytes) { history.setBudget(bytes); };
+
+        /**
+         * @brief Opens the on-disk message log.
+         * @param directory Directory of the log segments.
+         * @param sync Flush policy.
+         * @param intervalMs Interval of LogSync::INTERVAL in milliseconds.
+         * @return Empty string on success, otherwise the error.
+         */
+        std::string openMessageLog(const std::string& directory, LogSync sync, int intervalMs) { return messageLog.open(directory, sync, intervalMs); };
+
+        /**
+         * @brief Enables reconnecting when the connection breaks.
+         * @param attempts Maximum attempts per outage (0 disables reconnecting).
+         */
+        void setReconnect(int attempts) { reconnectAttempts = attempts; };
+
+        /**
+         * @brief Sets the time the process started (for the first-auth latency).
+         * @param ns Monotonic time in nanoseconds.
+         */
+        void setStartTime(uint64_t ns) { startNs = ns; };
+
+        /**
+         * @brief Opens a script whose lines are sent as if typed, alongside stdin.
+         * @param path Script file.
+         * @return Empty string on success, otherwise the error.
+         */
+        std::string openScript(const std::string& path) { return script.open(path); };
+
+        /**
+         * @brief Sizes the message, command and buffer pools and fills them.
+         * @param size Objects kept per pool.
+         */
+        void setPoolSize(std::size_t size);
+
+        /**
+         * @brief Sets the tuning of the sockets created from now on.
+         * @param options Socket options.
+         */
+        void setSocketOptions(const SocketOptions& options) { socketOptions = options; };
+
+        /**
+         * @brief Sets the outbound rate limits of the session.
+         * @param limit Message and byte rates and bursts.
+         */
+        void setRateLimit(const RateLimit& limit) { limiter.configure(limit); };
     
     protected:
-        /// Sends a user message (implemented in derived class).
-        virtual void sendMessage(std::string userInput) = 0;
-    
-        /// Handles disconnection logic (implemented in derived class).
-        virtual void handleDisconnect(Message* exitMsg) = 0;
-    
-        /// Parses a raw response from the server into a Message (implemented in derived class).
-        virtual Message* parseResponse(std::string response) = 0;
-    
-        /// Cleans up internal resources before program exit (implemented in derived class).
-        virtual void destruct() = 0;
-    
-        /// Receives and processes incoming messages from the server.
-        virtual void readMessageFromServer() = 0;
-    
-        /// Handles a received message and performs the appropriate action.
-        virtual void handleIncommingMessage(Message* message) = 0;
-    
-        /// Fetches a raw response string from the backend (network socket).
-        virtual std::string backendGetServerResponse() = 0;
-    
-        /// Sends a raw message string using the backend socket.
-        virtual void backendSendMessage(std::string message) = 0;
+        /*
+        Hooks implemented by the transport (called through self()):
+            void sendMessage(std::string_view userInput)     - sends a user message
+            void sendCommand(CommandPtr& command)            - sends a parsed command (nullptr is ignored, a throttled one is taken)
+            void handleDisconnect(MessagePtr exitMsg)        - handles disconnection logic (sends exitMsg if given)
+            MessagePtr parseResponse(std::string_view response) - parses a raw response into a pooled Message
+            void destruct()                                  - cleans up before program exit
+            void readMessageFromServer()                     - receives and processes incoming messages
+            void handleIncommingMessage(Message* message)    - handles a received message (owned by the caller)
+            std::string_view backendGetServerResponse()      - fetches a raw response from the socket (valid until the next one)
+            void backendSendMessage(std::string_view message) - sends a raw message over the socket
+            bool openConnection()                            - connects the socket to the server (false on failure)
+            void beginBatch() / void endBatch()              - brackets a burst of script lines (the transport may coalesce them)
+            void resetConnection()                           - replaces the socket and forgets the per-connection state
+            void ingest(std::string_view response)           - frames, parses and handles a raw chunk
+            int receiveFd()                                  - descriptor that is readable when the server sent something
+            std::size_t unsentBytes()                        - bytes handed over and not written to the socket yet (batched or queued)
+            bool sendBlocked()                               - the socket did not take everything, receiveFd() is polled for POLLOUT
+            void writable()                                  - writes what the socket did not take earlier (POLLOUT)
+        */
+
+        /// Returns the transport (the derived object).
+        Transport& self() { return static_cast<Transport&>(*this); };
     
-        /// Parses user input and returns a Command object.
-        Command* handleUserInput(std::string userInput);
+        /// Parses user input and returns a Command object (nullptr if it was handled locally).
+        CommandPtr handleUserInput(std::string_view userInput);
     
         /// Validates whether a message type is allowed to be sent in the current FSM state.
         bool msgTypeValidForStateSent(MessageType type);
     
         /// Validates whether a message type is allowed to be received in the current FSM state.
         bool msgTypeValidForStateReceived(MessageType type);
+
+        /// FSM transition for a sent message (used by msgTypeValidForStateSent).
+        bool transitionSent(MessageType type);
+
+        /// FSM transition for a received message (used by msgTypeValidForStateReceived).
+        bool transitionReceived(MessageType type);
     
-        /// Helper to set up a socket address from a NetworkAdress object.
-        void setupAdress(NetworkAdress& sender, sockaddr_in& addr);
+        /// Waits for the server lookup (once), false if the name did not resolve.
+        bool resolveServer();
+
+        /// Replaces cached addresses that did not answer by freshly resolved ones, false if there are none.
+        bool refreshServer();
     
         /// Prints a status message (e.g., JOIN/LEAVE notifications).
         void printStatusMessage(Message* msg);
     
         /// Prints a user-to-user message.
         void printMessage(Message* msg);
+
+        /// Queues a sent message for the message log.
+        void logSentMessage(Message* msg);
+
+        /// Records the time since the kernel received the data being handled (if it was stamped).
+        void recordSinceArrival(LatencyHistogram& histogram, uint64_t arrival);
+
+        /// Handles a broken connection: throws ConnectionLost when reconnecting, otherwise disconnects.
+        void connectionLost(const std::string& reason, MessagePtr exitMsg);
+
+        /// Reconnects with backoff, resumes the session and sends the queued input.
+        void reconnect(const std::string& reason);
+
+        /// Authenticates and joins the channel again after a reconnect.
+        bool resumeSession();
+
+        /// Waits while offline, queueing stdin lines and handling signals.
+        void waitOffline(int delayMs);
+
+        /// Reads the available stdin lines into the outbox, false at EOF.
+        bool readInput();
+
+        /// Sends the lines in the outbox.
+        void sendInput();
+
+        /// Sends the next batch of script lines.
+        void sendScript();
+
+        /// Sends the next batch of /sendfile messages (as many as its rate lets go).
+        void sendUpload();
+
+        /// Queues the command if the rate limit holds it back (true, the command is taken), false if it may go now.
+        bool throttle(CommandPtr& command, std::size_t size);
+
+        /// Sends the queued commands the rate limit lets go.
+        void releaseThrottled();
+
+        /// Returns the poll timeout until the first queued command may go (-1 if none is queued or the socket is behind).
+        int throttledWaitMs();
+
+        /// Returns true while the throttle queue is full or the socket is behind (the script and /sendfile wait).
+        bool backlogged() { return throttled.size() >= RATE_QUEUE_MAX || self().sendBlocked(); };
+
+        /// Marks everything handed to the transport so far as written, if the transport wrote it.
+        void commitFlushed();
+
+        /// Queues again what was handed to the transport and not written when the connection broke.
+        void requeueUnflushed();
+
+        /// Returns true while a script, a /sendfile or throttled commands are still to be sent.
+        bool sending() const { return script.pending() || upload.pending() || !throttled.empty(); };
     
-        /// Waits for a server response and returns it, handles timeout via pointer.
-        std::string waitForResponse(int* timeLeft);
+        /// Waits for a server response and returns it (valid until the next receive), handles timeout via pointer.
+        std::string_view waitForResponse(int* timeLeft);
     
         /// Makes the given file descriptor non-blocking.
         int setNonBlocking(int fd);
+
+        /// Prints the collected diagnostics to stderr, once, when the client exits.
+        void dumpDiagnostics();
+
+        /// Prints the runtime counters (/stats and SIGUSR1).
+        void printStats(std::ostream& out);
     
-        /// Frees the allocated buffer.
-        void deleteBuffer() {
-            if (buffer != nullptr) {
-                free(buffer);
-                buffer = nullptr;
-            }
+        /// Frees the receive buffer.
+        void deleteBuffer() { buffer.reset(); };
+
+        /// Takes a cleared serialization buffer from the pool.
+        Pooled<std::string> takeBuffer() {
+            Pooled<std::string> out = acquire(buffers);
+            out->clear();
+            return out;
         };
     
-        Command* cmdFactory;              ///< Factory for generating commands.
+        Command cmdFactory;               ///< Factory for generating commands.
+        Pool<CommandMessage> commands;    ///< Reused message commands.
+        MessagePool messages;             ///< Reused messages, sent and received.
+        Pool<std::string> buffers;        ///< Reused serialization buffers of outgoing frames and datagrams.
         int sockfd = -1;                  ///< Socket file descriptor.
-        sockaddr_in receiver;             ///< Receiver address (target).
-        sockaddr_in sender_addr;          ///< Local sender address.
+        sockaddr_storage receiver{};      ///< Receiver address (target).
+        sockaddr_storage sender_addr{};   ///< Address the last datagram came from.
+        Resolver* resolver;               ///< Lookup of the server started by Settings.
+        std::string serverName;           ///< Server as given with -s.
+        std::vector<sockaddr_storage> addresses; ///< Resolved server addresses, in connection order.
+        uint64_t startNs = 0;             ///< Time the process started (0 if unknown).
         struct clientInfo client;         ///< Client metadata and state.
         int epoll_fd;                     ///< Epoll file descriptor for polling events.
-        std::vector<Message*> backlog;    ///< Unprocessed incoming messages.
+        std::vector<MessagePtr> backlog;  ///< Unprocessed incoming messages.
         FSMState state = FSMState::START; ///< Current FSM state.
-        char* buffer;                     ///< Temporary buffer for message I/O.
+        std::unique_ptr<char[]> buffer;   ///< Receive buffer (BUFFER_SIZE).
         int timeout_ms = 5000;            ///< Default timeout in milliseconds.
         uint16_t msgCount = 0;            ///< Number of messages sent.
+        LatencyStats latency;             ///< Latency histograms.
+        uint64_t arrivalNs = 0;           ///< Kernel arrival time of the data being handled (0 without --rx-timestamps).
+        uint64_t inputStartNs = 0;        ///< Time the current stdin line was read (0 if none).
+        uint64_t requestSentNs = 0;       ///< Time the pending AUTH/JOIN was first sent (0 if none).
+        bool running = false;             ///< Event loop was started.
+        bool offline = false;             ///< Offline replay, nothing is written to the socket.
+        uint64_t replayStartNs = 0;       ///< Time the replay started (0 if not replaying).
+        uint64_t replayed = 0;            ///< Number of replayed chunks.
+        History history;                  ///< Received messages, searchable with /search.
+        std::string channel = "default";  ///< Channel the client is in.
+        std::string pendingChannel;       ///< Channel of the pending JOIN.
+        MessageLog messageLog;            ///< Displayed and sent messages on disk, read with /scrollback.
+        int reconnectAttempts = 0;        ///< Reconnect attempts per outage (0 = exit on a broken connection).
+        bool closing = false;             ///< The client is disconnecting on purpose.
+        bool authenticated = false;       ///< An AUTH succeeded, a reconnect authenticates again.
+        bool inputClosed = false;         ///< stdin reached EOF while offline.
+        std::string inputBuffer;          ///< Incomplete stdin line.
+        Script script;                    ///< Lines of the -f script.
+        Script upload;                    ///< File of the running /sendfile.
+        std::string inputLine;            ///< stdin line being sent.
+        std::string_view currentInput;    ///< Line being sent, inputLine or a script line (requeued if the connection breaks).
+        std::deque<std::string> outbox;   ///< stdin lines waiting for the connection to come back.
+        SocketOptions socketOptions;      ///< Tuning of the socket (--rcvbuf, --nodelay, --bind, ...).
+
+        /**
+         * @struct Throttled
+         * @brief Command held back by the rate limit, built again when its turn comes.
+         */
+        struct Throttled {
+            CommandPtr command;           ///< The command.
+            std::size_t size;             ///< Bytes on the wire when it was queued.
+            uint64_t queuedNs;            ///< Time it was queued.
+        };
+
+        RateLimiter limiter;              ///< Token buckets of --rate and --byte-rate.
+        std::deque<Throttled> throttled;  ///< Commands waiting for tokens, in order.
+        bool releasing = false;           ///< The queued commands are being sent.
+        uint64_t releaseQueuedNs = 0;     ///< Time the command being released was queued.
+        bool unthrottled = false;         ///< Commands bypass the limit (the resume of a session).
+        std::deque<Throttled> unflushedCommands; ///< Released commands not written to the socket yet.
+        std::deque<std::string> unflushedInput;  ///< stdin lines not written to the socket yet.
 
 };
     
@@ -122,8 +355,20 @@ class Chat {
  *
  * Handles connection-based reliable message sending/receiving using TCP sockets.
  */
-class ChatTCP : public Chat {
+class ChatTCP : public Chat<ChatTCP> {
+    friend class Chat<ChatTCP>;
+
     public:
+        static constexpr Mode mode = Mode::TCP; ///< Transport of the class.
+        static constexpr const char* name = "tcp"; ///< Name of the transport (-t).
+        static constexpr bool countsFramesOnRead = false; ///< Frames are counted when the stream is parsed.
+
+        /// Returns the type of a serialized message.
+        static MessageType peekType(std::string_view message) { return TCPMessages::peekType(message); };
+
+        /// Returns true if a sent chunk repeats the previous one (never, the stream is reliable).
+        static bool isRetransmit(std::string_view, std::string_view) { return false; };
+
         /**
          * @brief Constructs a TCP chat client with the target receiver address.
          * @param receiver Network address of the server to connect to.
@@ -134,23 +379,107 @@ class ChatTCP : public Chat {
         ~ChatTCP();
     
     private:
-        void readMessageFromServer() override;
-        std::string backendGetServerResponse() override;
-        void backendSendMessage(std::string message) override;
-        void sendMessage(std::string userInput) override;
-        void handleDisconnect(Message* exitMsg) override;
-        void destruct() override;
-        void handleIncommingMessage(Message* message) override;
-        Message* parseResponse(std::string response) override;
+        void readMessageFromServer();
+        std::string_view backendGetServerResponse();
+        void backendSendMessage(std::string_view message);
+        bool openConnection();
+        void resetConnection();
+        void ingest(std::string_view response);
+        void sendMessage(std::string_view userInput);
+        void sendCommand(CommandPtr& command);
+        std::size_t wireSize(Message* message);
+        void handleDisconnect(MessagePtr exitMsg);
+        void destruct();
+        void handleIncommingMessage(Message* message);
+        MessagePtr parseResponse(std::string_view response);
+
+        void beginBatch();
+        void endBatch();
+        int receiveFd() const { return sockfd; };
+        std::size_t unsentBytes() const { return outPending.size() + unsent.size() - unsentOffset; };
+        bool sendBlocked() const { return !unsent.empty(); };
+        void writable();
+
+        /**
+         * @brief Receives a chunk from the socket.
+         * @return View into the receive buffer, valid until the next receive.
+         */
+        std::string_view receive();
+
+        /**
+         * @brief Parses and handles one complete frame.
+         * @param frame The frame with its \r\n.
+         */
+        void handleFrame(std::string_view frame);
+
+        /**
+         * @struct ZeroCopySend
+         * @brief Buffers of a MSG_ZEROCOPY send, kept until the kernel reports it is done with them.
+         */
+        struct ZeroCopySend {
+            std::string frames;        ///< Pending frames and the MSG header written before the content.
+            MessagePtr message;        ///< The MSG whose content was written.
+            uint32_t lastCall = 0;     ///< Number of the last sendmsg() that wrote from them.
+            bool pinned = false;       ///< At least one sendmsg() used MSG_ZEROCOPY.
+            bool written = false;      ///< Everything was handed to the kernel.
+        };
+
+        /**
+         * @brief Sends a large MSG without building the frame (header, content and \r\n go out in one gather write).
+         *
+         * With --zerocopy and a content of at least its size the write uses
+         * MSG_ZEROCOPY, the kernel sends straight from the message. The
+         * message is then taken over (message is left empty) and kept until
+         * the completion of the write is read from the error queue.
+         * @param message The message to send.
+         */
+        void backendSendLarge(MessagePtr& message);
+
+        /**
+         * @brief Reads the MSG_ZEROCOPY completions from the error queue and releases the finished sends.
+         * @return Number of completions read.
+         */
+        int reapCompletions();
+
+        /**
+         * @brief Races connects to the resolved addresses.
+         * @return False if none of them connected within the timeout.
+         */
+        bool connectAddresses();
+
+        /**
+         * @brief Writes the pending frames to the socket.
+         * @param content Content of a large MSG written after them, followed by \r\n (empty if none).
+         * @param held Zero-copy send owning the frames and the content (nullptr for a regular send).
+         */
+        void flushPending(std::string_view content = {}, ZeroCopySend* held = nullptr);
+
+        /**
+         * @brief Writes what the socket did not take earlier, until it would block again.
+         */
+        void writeUnsent();
+
+        /**
+         * @brief Waits (at most the reply timeout) for the queued bytes to go out, before the socket is closed.
+         */
+        void drainUnsent();
     
         /**
          * @brief Waits for a server response with a defined timeout 
          */
         void waitForResponseWithTimeout();
 
-        TCPMessages* tcpFactory;                        ///< Factory for TCP protocol message creation.
-        MessageBuffer* msgBuffer = new MessageBuffer(); ///< Buffer to accumulate incomplete TCP messages.
-        std::string currentMessage;                     ///< Currently read message from socket.
+        TCPMessages tcpFactory{&client, &messages};     ///< Factory for TCP protocol message creation.
+        std::string currentMessage;                     ///< Frame split across receives (complete frames are parsed in place).
+        std::string outPending;                         ///< Frames not written to the socket yet.
+        std::string unsent;                             ///< Bytes the socket did not take (written on POLLOUT, nothing overtakes them).
+        std::size_t unsentOffset = 0;                   ///< Bytes of unsent already written.
+        uint64_t unsentInputNs = 0;                     ///< Time the stdin line waiting in unsent was read (0 if none).
+        bool batching = false;                          ///< MSG frames are coalesced until endBatch().
+        bool zeroCopy = false;                          ///< The socket takes MSG_ZEROCOPY sends.
+        uint32_t zeroCopyCalls = 0;                     ///< sendmsg() calls with MSG_ZEROCOPY on this socket (the kernel numbers them the same).
+        uint32_t zeroCopyCompleted = 0;                 ///< Calls the kernel reported complete.
+        std::deque<ZeroCopySend> zeroCopyInFlight;      ///< Zero-copy sends not completed yet, oldest first.
 };
     
 
@@ -160,8 +489,22 @@ class ChatTCP : public Chat {
  *
  * Handles unreliable message sending/receiving with retransmissions
  */
-class ChatUDP : public Chat {
+class ChatUDP : public Chat<ChatUDP> {
+    friend class Chat<ChatUDP>;
+
     public:
+        static constexpr Mode mode = Mode::UDP; ///< Transport of the class.
+        static constexpr const char* name = "udp"; ///< Name of the transport (-t).
+        static constexpr bool countsFramesOnRead = true; ///< Every datagram is counted when it is read.
+
+        /// Returns the type of a serialized message.
+        static MessageType peekType(std::string_view message) { return UDPMessages::peekType(message); };
+
+        /// Returns true if a sent datagram is a retransmission of the previous one (same message ID).
+        static bool isRetransmit(std::string_view previous, std::string_view datagram) {
+            return previous.size() >= 3 && datagram.size() >= 3 && previous.substr(1, 2) == datagram.substr(1, 2);
+        };
+
         /**
          * @brief Constructs a UDP chat client with retransmission configuration.
          * @param sender Local sender address.
@@ -172,24 +515,66 @@ class ChatUDP : public Chat {
     
         /// Destructor to release resources and buffers.
         ~ChatUDP();
+
+        /**
+         * @brief Receives on a network thread of its own (--pipeline), call before the event loop.
+         *
+         * The network thread owns the receiving side of the socket: it
+         * confirms every datagram and drops the duplicates as soon as they
+         * arrive, then queues them for the calling (protocol) thread, which
+         * parses them, runs the FSM and displays them. A confirmation never
+         * waits for parsing, the history or the display.
+         * @param networkCpu CPU the network thread is pinned to (-1 for none).
+         * @param protocolCpu CPU the calling thread is pinned to (-1 for none).
+         */
+        void setPipeline(int networkCpu, int protocolCpu);
     
     private:
-        void readMessageFromServer() override;
-        std::string backendGetServerResponse() override;
-    
-        void backendSendMessage(std::string message) override;
-        void sendMessage(std::string userInput) override;
-        void handleDisconnect(Message* exitMsg) override;
-        void destruct() override; 
-        void handleIncommingMessage(Message* message) override;
-        Message* parseResponse(std::string response) override;
+        /**
+         * @struct Datagram
+         * @brief Slot of the queue between the network and the protocol thread.
+         */
+        struct Datagram {
+            std::string data;          ///< The datagram (its capacity is reused).
+            sockaddr_storage from{};   ///< Address it came from.
+            int error = 0;             ///< errno of a failed receive (the network thread stopped).
+            uint64_t arrivalNs = 0;    ///< Kernel arrival time (0 without --rx-timestamps).
+            uint64_t confirmedNs = 0;  ///< Time its CONFIRM was sent (0 if none was).
+        };
+
+        void readMessageFromServer();
+        std::string_view backendGetServerResponse();
+    
+        void backendSendMessage(std::string_view message);
+        bool openConnection();
+        void resetConnection();
+        void ingest(std::string_view response);
+        void sendMessage(std::string_view userInput);
+        void sendCommand(CommandPtr& command);
+        std::size_t wireSize(Message* message);
+        void handleDisconnect(MessagePtr exitMsg);
+        void destruct(); 
+        void beginBatch() {}; // every datagram waits for its CONFIRM, nothing to coalesce
+        void endBatch() {};
+        std::size_t unsentBytes() const { return 0; }; // sendto() takes the whole datagram or fails
+        bool sendBlocked() const { return false; };
+        void writable() {};
+        void handleIncommingMessage(Message* message);
+        MessagePtr parseResponse(std::string_view response);
+        int receiveFd() const { return pipeline ? wakeFd : sockfd; };
+
+        /**
+         * @brief Receives a datagram.
+         * @return View into the receive buffer, valid until the next receive.
+         */
+        std::string_view receive();
 
         /**
          * @brief Method that handles confirmation of messages.
          * @param message The incoming message string.
          * @return True if the message needs further processing, false if it is a confirmation/ping.
          */
-        bool handleConfirmation(std::string message);
+        bool handleConfirmation(std::string_view message);
     
         
         /**
@@ -211,11 +596,61 @@ class ChatUDP : public Chat {
          */
         void waitForResponseWithTimeout(Message* msg);
         
+        /**
+         * @brief Sends to one of the resolved addresses from now on.
+         * @param index Index into addresses.
+         * @return False if no socket of its family could be created.
+         */
+        bool useAddress(std::size_t index);
+
+        /// Starts the network thread on the current socket.
+        void startReceiver();
+
+        /// Stops the network thread (before the socket is closed or replaced).
+        void stopReceiver();
+
+        /// Body of the network thread: receives, confirms and queues the datagrams.
+        void receiveLoop();
+
+        /**
+         * @brief Drops a duplicate and marks the ID as seen (the receiving thread only).
+         * @param msgID Message ID of the datagram.
+         * @return True if the datagram was seen before.
+         */
+        bool isDuplicate(uint16_t msgID);
+
+        /**
+         * @brief Sends the CONFIRMs collected by the network thread, in one UDP_SEGMENT (GSO) call if the kernel takes it.
+         * @param batch The CONFIRMs back to back (emptied).
+         * @param to Address they go to (ignored once the socket is connected).
+         */
+        void sendConfirms(std::string& batch, const sockaddr_storage& to);
+
+        /// Connects the socket to the dynamic port of the server (after the REPLY to AUTH).
+        void connectServer();
+
+        /**
+         * @brief Takes the next queued datagram, the previous one goes back to the ring.
+         * @return The datagram, nullptr if none is queued.
+         */
+        Datagram* takeDatagram();
+
+        std::size_t addressIndex = 0;            ///< Address the datagrams go to.
+        bool addressChosen = false;              ///< An address confirmed a message, no more switching or refreshing.
         uint16_t lastShownServerMsgID = 0;       ///< Last received and shown message ID from server.
         bool confirmedAtLeastOneMessage = false; ///< Flag to check if at least one message was confirmed.
-        UDPMessages* udpFactory;                 ///< UDP message factory for message creation.
+        UDPMessages udpFactory{&client, &messages}; ///< UDP message factory for message creation.
         int retransmissions = 0;                 ///< Max number of retransmissions per message.
         int timeout = 0;                         ///< Timeout for waiting for confirmation.
+        bool pipeline = false;                   ///< Datagrams are received by the network thread.
+        int networkCpu = -1;                     ///< CPU the network thread is pinned to (-1 for none).
+        std::unique_ptr<SpscRing<Datagram>> inbound; ///< Confirmed datagrams, network thread -> protocol thread.
+        bool holding = false;                    ///< The front slot of inbound is the current response.
+        std::thread networkThread;               ///< Receives, confirms and queues the datagrams.
+        int wakeFd = -1;                         ///< eventfd, readable while inbound has datagrams.
+        int stopFd = -1;                         ///< eventfd that stops the network thread.
+        std::atomic<bool> connected{false};      ///< The socket is connected to the server session (set by the protocol thread).
+        bool segmentation = true;                ///< The kernel takes UDP_SEGMENT sends (network thread, cleared on the first refusal).
 };
     
 
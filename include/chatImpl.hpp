@@ -0,0 +1,913 @@
+/**
+ * @file chatImpl.hpp
+ * @brief Implementation of the Chat class template (included by the transports)
+ * @author Martin Mendl <x247581>
+ * @date 18.4.2025
+*/
+
+#ifndef CHATIMPL_HPP
+#define CHATIMPL_HPP
+
+#include <iostream>
+#include <string>
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <poll.h>
+#include <csignal>
+#include <chrono>
+#include <random>
+#include "chat.hpp"
+#include "renderer.hpp"
+
+// Constructor for Chat class
+template <typename Transport>
+Chat<Transport>::Chat(NetworkAdress& receiver) {
+    resolver = receiver.resolver;
+    serverName = receiver.hostName.empty() ? receiver.ip : receiver.hostName;
+    //setNonBlocking(STDIN_FILENO);
+    buffer.reset(new char[BUFFER_SIZE]);
+}
+
+// Method to size and fill the pools
+template <typename Transport>
+void Chat<Transport>::setPoolSize(std::size_t size) {
+    /*
+    Everything that is created per message (the command, the Message and
+    the serialized frame or datagram) comes from a pool and goes back when
+    its owner is done with it. Once the strings in the pooled objects have
+    grown to the message sizes in use, sending and receiving allocate nothing.
+    */
+    commands.setCapacity(size);
+    messages.setCapacity(size);
+    buffers.setCapacity(size);
+    commands.fill();
+    messages.fill();
+    buffers.fill();
+}
+
+// Method to get the resolved server addresses
+template <typename Transport>
+bool Chat<Transport>::resolveServer() {
+    if (!addresses.empty()) return true;
+
+    std::string error = "no resolver";
+    if (resolver == nullptr || !resolver->wait(addresses, error)) {
+        std::cout << "ERROR: could not resolve " << serverName << ": " << error << "\n" << std::flush;
+        return false;
+    }
+    return true;
+}
+
+// Method to get fresh addresses after the cached ones did not answer
+template <typename Transport>
+bool Chat<Transport>::refreshServer() {
+    std::string error;
+    std::vector<sockaddr_storage> fresh;
+    if (resolver == nullptr || !resolver->refresh(fresh, error)) return false;
+    addresses = fresh;
+    return true;
+}
+
+// Method to set a fd to non-blocking mode
+template <typename Transport>
+int Chat<Transport>::setNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+// Method to print a status message
+template <typename Transport>
+void Chat<Transport>::printStatusMessage(Message* msg) {
+    if (msg == nullptr) return; // something went wrong
+
+    if (msg->getType() != MessageType::pREPLY && msg->getType() != MessageType::nREPLY) {
+        std::cout << "ERROR: invalid message type, expected REPLY but got MESSAGE\n" << std::flush;
+        self().handleDisconnect(messages.make<MessageError>(msgCount, client.displayName, "invalid message type"));
+    }
+    
+    // the pending AUTH/JOIN got its answer
+    if (requestSentNs != 0) {
+        latency.replyLatency.record(monotonicNs() - requestSentNs);
+        requestSentNs = 0;
+    }
+
+    // dynamic cast only used for casting inharited classes
+    MessageReply* msgReply = dynamic_cast<MessageReply*>(msg);
+
+    bool isOk = msgReply->isReplyOk();
+    const std::string& content = msgReply->getContent();
+
+    // remembered for resuming the session after a reconnect
+    if (isOk && state == FSMState::OPEN && !authenticated) {
+        authenticated = true;
+        if (startNs != 0) latency.firstAuth.record(monotonicNs() - startNs);
+    }
+
+    // print the status message
+    std::string status = isOk ? "Success" : "Failure";  
+    std::cout << "Action " << status << ": " << content << std::endl << std::flush;
+}
+
+// Method to print out a message form the server
+template <typename Transport>
+void Chat<Transport>::printMessage(Message* msg) {
+    if (msg == nullptr) return; // something went wrong
+
+    if (msg->getType() != MessageType::MSG) {
+        std::cout << "ERROR: invalid message type, expected MESSAGE but got REPLY\n" << std::flush;
+        self().handleDisconnect(messages.make<MessageError>(msgCount, client.displayName, "invalid message type"));
+    }
+
+    MessageMsg* msgMsg = dynamic_cast<MessageMsg*>(msg);
+    // through the display queue, a slow terminal or pipe never holds up the protocol
+    if (Renderer::active()) Renderer::message(msgMsg->getDisplayNameHandle(), msgMsg->getContent());
+    else std::cout << msgMsg->getDisplayName() << ": " << msgMsg->getContent() << std::endl << std::flush;
+    recordSinceArrival(latency.rxToDisplay, arrivalNs);
+    history.append(channel, msgMsg->getDisplayNameHandle(), msgMsg->getContent());
+    messageLog.append(channel, msgMsg->getDisplayName(), msgMsg->getContent(), false);
+}
+
+// Method to record the time since a kernel receive timestamp
+template <typename Transport>
+void Chat<Transport>::recordSinceArrival(LatencyHistogram& histogram, uint64_t arrival) {
+    if (arrival == 0) return;
+    // wall clock, a step backwards must not record a huge value
+    uint64_t now = realtimeNs();
+    if (now >= arrival) histogram.record(now - arrival);
+}
+
+// Method to log a message the user sent
+template <typename Transport>
+void Chat<Transport>::logSentMessage(Message* msg) {
+    if (!messageLog.isOpen() || msg->getType() != MessageType::MSG) return;
+    MessageMsg* msgMsg = dynamic_cast<MessageMsg*>(msg);
+    messageLog.append(channel, msgMsg->getDisplayName(), msgMsg->getContent(), true);
+}
+
+// Method to check, if a given sent message is valid for the current state
+template <typename Transport>
+bool Chat<Transport>::msgTypeValidForStateSent(MessageType type) {
+    FSMState previous = state;
+    if (transitionSent(type)) {
+        if (state != previous) Trace::emit(TraceKind::STATE, state, type, msgCount, static_cast<uint32_t>(previous));
+        return true;
+    }
+    CounterBlock::add(Counters::local().fsmRejectedSent);
+    return false;
+}
+
+// Method to advance the FSM on a sent message
+template <typename Transport>
+bool Chat<Transport>::transitionSent(MessageType type) {
+
+    switch (state) {
+        case FSMState::START:
+            if (type == MessageType::AUTH) {
+                state = FSMState::AUTH;
+                return true;
+            }
+            return false;
+        case FSMState::AUTH:
+            switch(type) {
+                case MessageType::AUTH:
+                case MessageType::ERR:
+                    return true;
+                default:
+                    return false;
+            }
+        case FSMState::OPEN:
+            switch(type) {
+                case MessageType::MSG:
+                case MessageType::ERR:
+                    return true;
+                case MessageType::JOIN:
+                    state = FSMState::JOIN;
+                    return true;
+                default:
+                    return false;
+            }
+        case FSMState::JOIN:
+        case FSMState::END:
+            return false;
+    }
+    return false;
+}
+
+// method to validate if a given incoming message is valid for the current state
+template <typename Transport>
+bool Chat<Transport>::msgTypeValidForStateReceived(MessageType type) {
+    // in case i get err or bye, just exit
+    if (type == MessageType::BYE) self().handleDisconnect(nullptr);
+
+    FSMState previous = state;
+    if (transitionReceived(type)) {
+        if (previous == FSMState::JOIN && type == MessageType::pREPLY) channel = pendingChannel;
+        if (state != previous) Trace::emit(TraceKind::STATE, state, type, msgCount, static_cast<uint32_t>(previous));
+        return true;
+    }
+    CounterBlock::add(Counters::local().fsmRejectedReceived);
+    return false;
+}
+
+// method to advance the FSM on a received message
+template <typename Transport>
+bool Chat<Transport>::transitionReceived(MessageType type) {
+
+    switch (state) {
+        case FSMState::START:
+            return false;
+        case FSMState::AUTH:
+            if (type == MessageType::pREPLY) { // auth ok
+                state = FSMState::OPEN;
+                return true;
+            }
+            if (type == MessageType::nREPLY) {  // auth failed
+                state = FSMState::START;
+                return true;
+            }
+            return false;
+        case FSMState::OPEN:
+            switch(type) {
+                case MessageType::MSG:
+                    return true;
+                default:
+                    return false;
+            }
+        case FSMState::JOIN:
+            switch(type) {
+                case MessageType::MSG:
+                    return true;
+                case MessageType::pREPLY:
+                case MessageType::nREPLY:
+                    state = FSMState::OPEN;
+                    return true;
+                default:
+                    return false;
+            }
+        case FSMState::END:
+            return false;
+    }
+    return false;
+}
+
+// Method to handle the user input (convert user input into a command)
+template <typename Transport>
+CommandPtr Chat<Transport>::handleUserInput(std::string_view userInput) {
+    if (userInput.empty()) return nullptr;
+
+    // if it is not a rename, return the command
+    CommandPtr command = cmdFactory.createCommand(userInput, &commands);
+    if (command == nullptr) return nullptr;
+
+    // local command, print the histograms
+    if (typeid(*command) == typeid(CommandLatency)) {
+        latency.print(std::cout);
+        return nullptr;
+    }
+
+    // local command, print the counters
+    if (typeid(*command) == typeid(CommandStats)) {
+        printStats(std::cout);
+        return nullptr;
+    }
+
+    // local command, search the history
+    if (typeid(*command) == typeid(CommandSearch)) {
+        history.search(dynamic_cast<CommandSearch*>(command.get())->getTerms(), std::cout);
+        return nullptr;
+    }
+
+    // local command, read the message log
+    if (typeid(*command) == typeid(CommandScrollback)) {
+        CommandScrollback* scrollback = dynamic_cast<CommandScrollback*>(command.get());
+        if (!messageLog.isOpen()) {
+            std::cout << "ERROR: no message log, start the client with --log-dir\n" << std::flush;
+        } else if (scrollback->getMinutes() >= 0) {
+            uint64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+            uint64_t back = static_cast<uint64_t>(scrollback->getMinutes()) * 60000000000ull;
+            messageLog.printSince(now > back ? now - back : 0, scrollback->getCount(), std::cout);
+        } else {
+            messageLog.printLast(scrollback->getCount(), std::cout);
+        }
+        return nullptr;
+    }
+
+    // local command, stream a file as messages (sent between the polls of the event loop)
+    if (typeid(*command) == typeid(CommandSendFile)) {
+        CommandSendFile* sendFile = dynamic_cast<CommandSendFile*>(command.get());
+        if (state != FSMState::OPEN) {
+            std::cout << "ERROR: you need to authenticate first\n" << std::flush;
+        } else if (upload.pending()) {
+            std::cout << "ERROR: a file is still being sent\n" << std::flush;
+        } else {
+            std::string error = upload.open(sendFile->getPath(), true, sendFile->getRate());
+            if (!error.empty()) std::cout << "ERROR: cannot send " << sendFile->getPath() << ": " << error << "\n" << std::flush;
+            else if (!upload.pending()) std::cout << "sendfile: " << sendFile->getPath() << " is empty\n" << std::flush;
+        }
+        return nullptr;
+    }
+
+    // the channel becomes current once the server confirms the JOIN
+    if (typeid(*command) == typeid(CommandJoin)) pendingChannel = dynamic_cast<CommandJoin*>(command.get())->getChannelId();
+
+    if (typeid(*command) != typeid(CommandRename)) return command;
+
+    // handle rename cmd
+    CommandRename* renameCmd = dynamic_cast<CommandRename*>(command.get());
+    if (renameCmd) {
+        client.displayName = renameCmd->getNewName();
+        std::cout << "Action Sucsess: Display name changed to: " << client.displayName << std::endl << std::flush;
+    }
+    return nullptr;
+}
+
+// Method to wait for a response from the server with a timeout
+template <typename Transport>
+std::string_view Chat<Transport>::waitForResponse(int* timeLeft) {
+
+    if (!timeLeft || *timeLeft <= 0 || offline) return {};
+
+    struct pollfd pfd;
+    pfd.fd = self().receiveFd();
+    pfd.events = POLLIN | (self().sendBlocked() ? POLLOUT : 0); // the request may wait behind queued bytes
+
+    auto start_time = std::chrono::steady_clock::now();
+
+    int ret;
+    do {
+        ret = poll(&pfd, 1, *timeLeft);
+    } while (ret == -1 && errno == EINTR); // Retry on signal interruption
+
+    auto end_time = std::chrono::steady_clock::now();
+    int elapsed_time = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
+
+    // Update the time left
+    *timeLeft = std::max(0, *timeLeft - elapsed_time);
+
+    // Timeout or error
+    if (ret <= 0) return {};
+
+    // the socket took more of the queue, the caller waits again
+    if (pfd.revents & POLLOUT) {
+        self().writable();
+        if (!(pfd.revents & (POLLIN | POLLERR))) return {};
+    }
+
+    // Response (or an error or completion the receive reads, an empty response then)
+    if (pfd.revents & (POLLIN | POLLERR)) return self().backendGetServerResponse();
+
+    // Error
+    std::cout << "ERROR: internal error, poll failed\n" << std::flush;
+    return {}; // To make compiler happy
+}
+
+// Method to print the counters
+template <typename Transport>
+void Chat<Transport>::printStats(std::ostream& out) {
+    Counters::local().queue(backlog.size());
+    Counters::print(out);
+    if (socketOptions.any() && sockfd >= 0) SocketOptions::report(sockfd, Transport::mode, out);
+}
+
+// Method to print the diagnostics on exit
+template <typename Transport>
+void Chat<Transport>::dumpDiagnostics() {
+    if (!running) return; // nothing was measured, or already dumped
+    running = false;
+    std::cerr << "--- latency ---\n";
+    latency.print(std::cerr);
+    std::cerr << "--- counters ---\n";
+    printStats(std::cerr);
+    if (replayStartNs != 0) {
+        double elapsedMs = (monotonicNs() - replayStartNs) / 1e6;
+        std::cerr << "--- replay ---\n"
+                  << "chunks=" << replayed << " elapsed=" << elapsedMs << "ms"
+                  << " rate=" << (elapsedMs > 0 ? replayed / elapsedMs * 1000.0 : 0.0) << " chunks/s\n" << std::flush;
+    }
+    Trace::dump();
+    Capture::flush();
+}
+
+// Method to replay a capture
+template <typename Transport>
+void Chat<Transport>::replay(const std::string& path, double speed) {
+    Mode transport;
+    std::vector<CaptureRecord> records;
+    std::string error = Capture::load(path, transport, records);
+    if (!error.empty()) {
+        std::cout << "ERROR: " << error << "\n" << std::flush;
+        exit(1);
+    }
+    if (transport != Transport::mode) {
+        std::cout << "ERROR: the capture was not taken with -t " << Transport::name << "\n" << std::flush;
+        exit(1);
+    }
+
+    offline = speed <= 0;
+    if (!offline && !self().openConnection()) {
+        self().destruct();
+        exit(1);
+    }
+    running = true;
+    replayStartNs = monotonicNs();
+
+    struct pollfd pfd;
+    pfd.fd = self().receiveFd();
+    pfd.events = POLLIN;
+    std::string_view lastOutgoing; // previous sent chunk
+    bool byeSent = false;
+
+    for (const CaptureRecord& record : records) {
+        // live: keep handling the server until the chunk is due
+        while (!offline) {
+            uint64_t due = replayStartNs + static_cast<uint64_t>(record.ns / speed);
+            uint64_t now = monotonicNs();
+            if (now >= due) break;
+            int waitMs = static_cast<int>((due - now + 999999) / 1000000);
+            pfd.events = POLLIN | (self().sendBlocked() ? POLLOUT : 0); // earlier chunks the socket did not take
+            if (poll(&pfd, 1, waitMs) <= 0) continue;
+            if (pfd.revents & POLLOUT) self().writable();
+            if (pfd.revents & POLLIN) self().readMessageFromServer();
+        }
+        replayed++;
+
+        // received chunks come from the live server, offline they go through the real framing
+        if (!record.outgoing) {
+            if (!offline) continue;
+            // a transport counting frames when reading the socket would miss them (it is skipped here)
+            if (Transport::countsFramesOnRead) Counters::local().frameIn(Transport::peekType(record.data), record.data.size());
+            self().ingest(record.data);
+            continue;
+        }
+
+        // our own CONFIRMs belong to the captured server's IDs, the live ones are sent by ingest
+        MessageType type = Transport::peekType(record.data);
+        if (type == MessageType::CONFIRM) continue;
+
+        // retransmissions already went through the FSM, BYE never does
+        bool retransmit = Transport::isRetransmit(lastOutgoing, record.data);
+        lastOutgoing = record.data;
+        if (!retransmit && type != MessageType::BYE && !msgTypeValidForStateSent(type)) continue;
+
+        if (offline) {
+            Counters::local().frameOut(type, record.data.size());
+            continue;
+        }
+        self().backendSendMessage(record.data);
+        if (type == MessageType::BYE) byeSent = true;
+
+        // like the interactive client, block until AUTH/JOIN is answered (the request may still be queued)
+        while (state == FSMState::AUTH || state == FSMState::JOIN) {
+            pfd.events = POLLIN | (self().sendBlocked() ? POLLOUT : 0);
+            if (poll(&pfd, 1, timeout_ms) <= 0) break;
+            if (pfd.revents & POLLOUT) self().writable();
+            if (pfd.revents & ~POLLOUT) self().readMessageFromServer();
+        }
+    }
+
+    // let the server answer the last chunks (after BYE it just closes)
+    pfd.events = POLLIN;
+    while (!offline && !byeSent && poll(&pfd, 1, timeout_ms / 10) > 0 && (pfd.revents & POLLIN)) self().readMessageFromServer();
+    self().destruct();
+}
+
+// Method to handle a broken connection
+template <typename Transport>
+void Chat<Transport>::connectionLost(const std::string& reason, MessagePtr exitMsg) {
+    // only the interactive client reconnects, and never while it is saying goodbye
+    if (reconnectAttempts > 0 && running && replayStartNs == 0 && !closing) throw ConnectionLost(reason);
+    self().handleDisconnect(std::move(exitMsg));
+}
+
+// Method to wait while offline
+template <typename Transport>
+void Chat<Transport>::waitOffline(int delayMs) {
+    uint64_t deadline = monotonicNs() + static_cast<uint64_t>(delayMs) * 1000000;
+    uint64_t now;
+    while ((now = monotonicNs()) < deadline) {
+        struct pollfd fds[3];
+        fds[0].fd = inputClosed ? -1 : STDIN_FILENO;
+        fds[0].events = POLLIN;
+        fds[1].fd = sigfds[0];
+        fds[1].events = POLLIN;
+        fds[2].fd = Renderer::wantsWrite() ? STDOUT_FILENO : -1;
+        fds[2].events = POLLOUT;
+        if (poll(fds, 3, static_cast<int>((deadline - now + 999999) / 1000000)) <= 0) continue;
+
+        // the output queued before the outage keeps going out
+        if (fds[2].revents & (POLLOUT | POLLERR | POLLHUP)) Renderer::writable();
+
+        // typed during the outage, sent once the session is back
+        if (fds[0].revents & (POLLIN | POLLHUP) && !readInput()) inputClosed = true;
+
+        if (fds[1].revents & POLLIN) {
+            int sig;
+            if (read(sigfds[0], &sig, sizeof(sig)) == -1) continue;
+            if (sig == SIGUSR1) {
+                printStats(std::cerr);
+                Trace::dump();
+                Capture::flush();
+                continue;
+            }
+            if (sig == SIGWINCH) {
+                Renderer::resize();
+                continue;
+            }
+            // nobody to say goodbye to
+            closing = true;
+            self().destruct();
+            exit(0);
+        }
+    }
+}
+
+// Method to authenticate and join again
+template <typename Transport>
+bool Chat<Transport>::resumeSession() {
+    if (!authenticated) return true; // nothing to resume yet
+
+    // the resume does not wait behind the throttled commands, they are for the resumed session
+    std::string joined = channel;
+    unthrottled = true;
+    try {
+        self().sendMessage("/auth " + client.username + " " + client.secret + " " + client.displayName);
+        // AUTH puts the client into the server's default channel
+        if (state == FSMState::OPEN) channel = "default";
+        if (state == FSMState::OPEN && joined != "default") self().sendMessage("/join " + joined);
+    } catch (...) {
+        unthrottled = false;
+        throw;
+    }
+    unthrottled = false;
+    return state == FSMState::OPEN && channel == joined;
+}
+
+// Method to reconnect after the connection broke
+template <typename Transport>
+void Chat<Transport>::reconnect(const std::string& reason) {
+    uint64_t lostNs = monotonicNs();
+    std::minstd_rand random(static_cast<unsigned>(lostNs));
+    std::cerr << "ERROR: connection lost (" << reason << "), reconnecting\n" << std::flush;
+
+    for (int attempt = 0; attempt < reconnectAttempts; ++attempt) {
+        // exponential backoff with jitter, so a fleet does not reconnect in lockstep
+        int delay = std::min(RECONNECT_MAX_DELAY_MS, RECONNECT_BASE_DELAY_MS << std::min(attempt, 16));
+        waitOffline(delay / 2 + static_cast<int>(random() % (delay / 2 + 1)));
+
+        self().resetConnection();
+        state = FSMState::START;
+        msgCount = 0;
+        requestSentNs = 0;
+        try {
+            if (!self().openConnection() || !resumeSession()) continue;
+
+            uint64_t recoveryNs = monotonicNs() - lostNs;
+            latency.recovery.record(recoveryNs);
+            CounterBlock::add(Counters::local().reconnects);
+            std::cerr << "session resumed after " << recoveryNs / 1000000 << " ms (" << attempt + 1 << " attempt(s))\n" << std::flush;
+
+            // input typed during the outage, in order
+            sendInput();
+        } catch (const ConnectionLost& error) {
+            if (!currentInput.empty()) outbox.emplace_front(currentInput);
+            currentInput = {};
+            requeueUnflushed();
+            std::cerr << "ERROR: reconnect attempt " << attempt + 1 << " failed (" << error.what() << ")\n" << std::flush;
+            continue;
+        }
+
+        if (inputClosed && !sending()) self().handleDisconnect(messages.make<MessageBye>(msgCount, client.displayName));
+        return;
+    }
+
+    std::cout << "ERROR: could not reconnect\n" << std::flush;
+    closing = true;
+    self().destruct();
+    exit(1);
+}
+
+// Method to read the available stdin lines into the outbox
+template <typename Transport>
+bool Chat<Transport>::readInput() {
+    /*
+    stdin is read in chunks straight from the descriptor: std::getline
+    buffers more than one line, poll does not see the buffered ones and a
+    piped file would stall until the next chunk arrives.
+    */
+    char chunk[BUFFER_SIZE];
+    ssize_t length = read(STDIN_FILENO, chunk, sizeof(chunk));
+    if (length < 0) return errno == EINTR || errno == EAGAIN;
+
+    // EOF, a last line without a line break still counts
+    if (length == 0) {
+        if (!inputBuffer.empty()) outbox.push_back(inputBuffer);
+        inputBuffer.clear();
+        return false;
+    }
+
+    // keys of a terminal are edited by the renderer, it hands over the finished lines
+    if (Renderer::terminal()) return Renderer::type(chunk, length, outbox);
+
+    inputBuffer.append(chunk, length);
+    std::size_t start = 0, end;
+    while ((end = inputBuffer.find('\n', start)) != std::string::npos) {
+        std::size_t lineLength = end - start;
+        if (lineLength > 0 && inputBuffer[end - 1] == '\r') lineLength--;
+        if (lineLength > 0) outbox.emplace_back(inputBuffer, start, lineLength);
+        start = end + 1;
+    }
+    inputBuffer.erase(0, start);
+    return true;
+}
+
+// Method to send the queued stdin lines
+template <typename Transport>
+void Chat<Transport>::sendInput() {
+    while (!outbox.empty()) {
+        inputLine = std::move(outbox.front());
+        outbox.pop_front();
+        currentInput = inputLine;
+        inputStartNs = monotonicNs();
+        self().sendMessage(currentInput);
+        currentInput = {};
+        inputStartNs = 0;
+        // a message still queued in the transport goes again if the connection breaks (commands are redone by the resume)
+        if (self().unsentBytes() != 0 && inputLine[0] != '/') unflushedInput.push_back(std::move(inputLine));
+        commitFlushed();
+    }
+}
+
+// Method to send the next batch of script lines
+template <typename Transport>
+void Chat<Transport>::sendScript() {
+    std::string_view line;
+    // like a /sendfile batch, it ends after SCRIPT_BATCH_MS so stop-and-wait sends do not hold stdin back
+    uint64_t batchEndNs = monotonicNs() + SCRIPT_BATCH_MS * 1000000ull;
+    self().beginBatch();
+    for (int i = 0; i < SCRIPT_BATCH_LINES && monotonicNs() < batchEndNs && !self().sendBlocked() && script.next(line); ++i) {
+        if (line.empty()) continue;
+        // sent straight from the mapping, if the connection breaks the script rewinds to the first line not written
+        self().sendMessage(line);
+        commitFlushed();
+    }
+    self().endBatch();
+    commitFlushed();
+    script.report(std::cerr);
+}
+
+// Method to send the next batch of /sendfile messages
+template <typename Transport>
+void Chat<Transport>::sendUpload() {
+    std::string_view line;
+    // a batch also ends after SCRIPT_BATCH_MS, with UDP waiting for every CONFIRM that can be one message
+    uint64_t batchEndNs = monotonicNs() + SCRIPT_BATCH_MS * 1000000ull;
+    self().beginBatch();
+    for (int i = 0; i < SCRIPT_BATCH_LINES && monotonicNs() < batchEndNs && upload.ready() && !self().sendBlocked() && upload.next(line); ++i) {
+        if (line.empty()) continue;
+        // the content is never parsed as a command, a line starting with '/' is sent as it is
+        CommandPtr command = Command::createMessage(line, &commands);
+        self().sendCommand(command);
+        commitFlushed();
+    }
+    self().endBatch();
+    commitFlushed();
+    upload.report(std::cerr);
+}
+
+// Method to hold a command back while the session is over its rate
+template <typename Transport>
+bool Chat<Transport>::throttle(CommandPtr& command, std::size_t size) {
+    // CONFIRM, BYE and ERR are not sent as commands, they never wait here
+    if (!limiter.enabled() || unthrottled) return false;
+    uint64_t now = monotonicNs();
+
+    // the command at the front of the queue goes back there if its tokens are not in yet
+    if (releasing) {
+        if (limiter.take(size, now)) {
+            latency.rateLimit.record(now - releaseQueuedNs);
+            return false;
+        }
+        throttled.push_front({std::move(command), size, releaseQueuedNs});
+        return true;
+    }
+
+    // nothing overtakes the queue
+    if (throttled.empty() && limiter.take(size, now)) return false;
+    // the input line (or script line) of a message is reused before its turn comes
+    if (typeid(*command) == typeid(CommandMessage)) static_cast<CommandMessage*>(command.get())->keep();
+    throttled.push_back({std::move(command), size, now});
+    CounterBlock::add(Counters::local().throttled);
+    return true;
+}
+
+// Method to send the queued commands the rate limit lets go
+template <typename Transport>
+void Chat<Transport>::releaseThrottled() {
+    self().beginBatch();
+    while (!throttled.empty() && throttledWaitMs() == 0) {
+        Throttled next = std::move(throttled.front());
+        throttled.pop_front();
+        releaseQueuedNs = next.queuedNs;
+        releasing = true;
+        try {
+            self().sendCommand(next.command);
+        } catch (const ConnectionLost&) {
+            // the command goes again after the reconnect (unless it went back to the queue already)
+            releasing = false;
+            if (next.command != nullptr) throttled.push_front(std::move(next));
+            throw;
+        }
+        releasing = false;
+        // taken back, the buckets ran dry since the check
+        if (next.command == nullptr) break;
+        // still queued in the transport, it goes again if the connection breaks
+        if (self().unsentBytes() != 0) unflushedCommands.push_back(std::move(next));
+        commitFlushed();
+    }
+    self().endBatch();
+    commitFlushed();
+}
+
+// Method to mark what the transport wrote as sent
+template <typename Transport>
+void Chat<Transport>::commitFlushed() {
+    // only all at once, the transport does not tell which of its queued frames were written
+    if (self().unsentBytes() != 0) return;
+    script.commit();
+    upload.commit();
+    unflushedInput.clear();
+    unflushedCommands.clear();
+}
+
+// Method to queue again what the broken connection did not write
+template <typename Transport>
+void Chat<Transport>::requeueUnflushed() {
+    // the script and /sendfile rewind to the first line not written, the rest goes in front of the queues in order
+    script.rewind();
+    upload.rewind();
+    while (!unflushedInput.empty()) {
+        outbox.push_front(std::move(unflushedInput.back()));
+        unflushedInput.pop_back();
+    }
+    while (!unflushedCommands.empty()) {
+        throttled.push_front(std::move(unflushedCommands.back()));
+        unflushedCommands.pop_back();
+    }
+}
+
+// Method to get the time until the first queued command may go
+template <typename Transport>
+int Chat<Transport>::throttledWaitMs() {
+    if (throttled.empty() || self().sendBlocked()) return -1; // nothing is released until the socket drains
+    return limiter.waitMs(throttled.front().size, monotonicNs());
+}
+
+// Method to create the event loop (run the chat client)
+template <typename Transport>
+void Chat<Transport>::eventLoop() {
+    bool connected = self().openConnection();
+    if (!connected && reconnectAttempts == 0) {
+        self().destruct();
+        exit(1);
+    }
+    running = true;
+
+    // Create a socket pair for signal handling 
+    // credit -> chat GPT
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sigfds) == -1) {
+        std::cout << "ERROR: failed to create socket pair\n" << std::flush;
+        exit(1);
+    }
+
+    // Setup SIGINT handler (SIGUSR1 dumps the counters and trace, SIGWINCH resizes the renderer, same socket pair)
+    struct sigaction sa;
+    sa.sa_handler = signalHandler;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART;
+    if (sigaction(SIGINT, &sa, nullptr) == -1 || sigaction(SIGUSR1, &sa, nullptr) == -1 || sigaction(SIGWINCH, &sa, nullptr) == -1) {
+        std::cout << "ERROR: faild to setup sigint\n" << std::flush;
+        exit(1);
+    }
+
+    struct pollfd fds[4];
+    // user input
+    fds[0].fd = STDIN_FILENO;
+    fds[0].events = POLLIN;
+
+    // server response
+    fds[1].fd = self().receiveFd();
+    fds[1].events = POLLIN | POLLHUP; // POLLHUP needs to bere here, in case the stdin would be closed
+
+    // ctrl+c signal
+    fds[2].fd = sigfds[0]; // Signal notification via socketpair
+    fds[2].events = POLLIN;
+
+    // display queue, only while it has something to write
+    fds[3].fd = -1;
+    fds[3].events = POLLOUT;
+    int ret;
+
+    if (!connected) reconnect("connection failed");
+
+    while (true) {
+        // messages of the last iteration go to the log in one batch, to the terminal once a frame is due
+        messageLog.flush();
+        Renderer::frame();
+        // stdin may end before the script, it waits while the rate limit (or the socket) is far behind
+        bool inputHeld = throttled.size() >= RATE_QUEUE_MAX || self().unsentBytes() >= SEND_UNSENT_MAX;
+        fds[0].fd = inputClosed || inputHeld ? -1 : STDIN_FILENO;
+        // replaced by a reconnect, not read while a blocking display catches up, written while the socket is behind
+        bool blocked = self().sendBlocked();
+        fds[1].fd = Renderer::paused() && !blocked ? -1 : self().receiveFd();
+        fds[1].events = (Renderer::paused() ? 0 : POLLIN | POLLHUP) | (blocked ? POLLOUT : 0);
+        fds[3].fd = Renderer::wantsWrite() ? STDOUT_FILENO : -1;
+
+        // unindexed history is indexed while there is nothing else to do, the next frame (or /sendfile message, or throttled command) bounds the wait
+        bool scriptDue = script.pending() && !backlogged();
+        int wait = history.pending() || scriptDue ? 0 : Renderer::timeoutMs();
+        for (int due : {upload.pending() && !backlogged() ? upload.dueMs() : -1, throttledWaitMs()}) {
+            if (due >= 0) wait = wait < 0 ? due : std::min(wait, due);
+        }
+        do {
+            ret = poll(fds, 4, wait);
+        } while (ret == -1 && errno == EINTR); // Retry on signal interruption (ctr+c someties results in EINTR in my testing)
+
+        if (ret == 0 && !scriptDue && !(upload.ready() && !backlogged()) && throttledWaitMs() != 0) {
+            history.indexSome();
+            continue;
+        }
+
+        // poll error 
+        if (ret == -1 && errno != EINTR) {
+            std::cout << "ERROR: poll failed\n" << std::flush;
+            self().handleDisconnect(messages.make<MessageError>(msgCount, client.displayName, "internal client error")); 
+        }
+
+        if (fds[3].revents & (POLLOUT | POLLERR | POLLHUP)) Renderer::writable();
+
+        std::string lost;
+        try {
+            // Check for user input
+            if (fds[0].revents & POLLIN || fds[0].revents & POLLHUP) {
+                if (!readInput()) inputClosed = true; // Handle EOF
+                sendInput();
+            }
+
+            // the queued bytes go out as the server reads (a socket error shows up on the write too)
+            if (blocked && fds[1].revents & (POLLOUT | POLLERR | POLLHUP)) {
+                self().writable();
+                commitFlushed();
+            }
+
+            // Check for server response (POLLERR alone: a socket error, or a completion on the error queue)
+            if (!Renderer::paused() && fds[1].revents & (POLLIN | POLLERR)) self().readMessageFromServer();
+
+            // the script goes on in batches, stdin and the server are polled in between
+            if (throttledWaitMs() == 0) releaseThrottled();
+            if (script.pending() && !backlogged()) sendScript();
+            if (upload.ready() && !backlogged()) sendUpload();
+            if (inputClosed && !sending()) self().handleDisconnect(messages.make<MessageBye>(msgCount, client.displayName));
+        } catch (const ConnectionLost& error) {
+            lost = error.what();
+            // a line that was being sent goes again after the reconnect (commands are redone by the resume)
+            if (!currentInput.empty() && currentInput[0] != '/') outbox.emplace_front(currentInput);
+            currentInput = {};
+            requeueUnflushed();
+        }
+        if (!lost.empty()) {
+            reconnect(lost);
+            continue;
+        }
+        
+        // Check for SIGINT (Ctrl+C)
+        if (fds[2].revents & POLLIN) {
+            int sig;
+            if (read(sigfds[0], &sig, sizeof(sig)) == -1) {
+                std::cerr << "ERROR: failed to read from signal socket\n" << std::flush;
+                exit(1);
+            };
+            // counters dump, keep running
+            if (sig == SIGUSR1) {
+                printStats(std::cerr);
+                Trace::dump();
+                Capture::flush();
+                continue;
+            }
+            if (sig == SIGWINCH) {
+                Renderer::resize();
+                continue;
+            }
+            self().handleDisconnect(messages.make<MessageBye>(msgCount, client.displayName)); 
+        }
+    }
+
+    // Clean up before exiting (not really needed, but just to be safe)
+    close(sigfds[0]);
+    close(sigfds[1]);
+    self().destruct();
+}
+
+#endif // CHATIMPL_HPP
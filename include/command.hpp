@@ -8,8 +8,28 @@
 #define COMMAND_HPP
 
 #include <string>
+#include <string_view>
+#include <memory>
+#include "pool.hpp"
 #include "utils.hpp"
 
+class Command;
+class CommandMessage;
+
+/**
+ * @struct CommandReturn
+ * @brief Deleter of a CommandPtr, gives a message command back to its pool (deletes any other command).
+ */
+struct CommandReturn {
+    Pool<CommandMessage>* pool = nullptr; ///< Pool of the message commands.
+
+    /// Returns or deletes the command.
+    void operator()(Command* command) const;
+};
+
+/// Command owned by the caller.
+using CommandPtr = std::unique_ptr<Command, CommandReturn>;
+
 /**
  * @class Command
  * @brief Abstract base class for handling user commands.
@@ -33,10 +53,19 @@ class Command {
     
         /**
          * @brief Creates a new command instance based on user input.
-         * @param userInput The raw input string from the user.
-         * @return A pointer to a dynamically created Command object.
+         * @param userInput The raw input string from the user (a message borrows it).
+         * @param pool Pool of the message commands (nullptr allocates every one).
+         * @return The command, nullptr if there is nothing to do.
          */
-        Command* createCommand(std::string userInput);
+        CommandPtr createCommand(std::string_view userInput, Pool<CommandMessage>* pool = nullptr);
+
+        /**
+         * @brief Creates a message command, whatever the content starts with.
+         * @param content Content of the message (borrowed).
+         * @param pool Pool of the message commands (nullptr allocates it).
+         * @return The command.
+         */
+        static CommandPtr createMessage(std::string_view content, Pool<CommandMessage>* pool = nullptr);
     
         /**
          * @brief Virtual method for representing the command.
@@ -175,32 +204,210 @@ class CommandRename : public Command {
  * @class CommandMessage
  * @brief Derived class for handling message commands.
  *
- * This class is responsible for parsing and storing the
- * message content from the user input.
+ * The content is borrowed from the input line, which outlives the
+ * command; the Message sent copies it once. A command that is queued
+ * past its input line copies the content with keep().
  */
 class CommandMessage : public Command {
     public:
+        /**
+         * @brief Constructs an empty command (for the pool).
+         */
+        CommandMessage() {};
         /**
          * @brief Constructor that initializes the command with user input.
          * @param userInput The raw input string from the user.
          */
-        CommandMessage(std::string userInput);
+        CommandMessage(std::string_view userInput);
         /**
          * @brief Destructor.
          */
         ~CommandMessage() {};
+        /**
+         * @brief Refills a pooled command.
+         * @param userInput The raw input string from the user.
+         */
+        void assign(std::string_view userInput) { message = userInput; };
+        /**
+         * @brief Copies the borrowed content into the command (it outlives the input line).
+         */
+        void keep() {
+            if (message.data() == kept.data()) return;
+            kept.assign(message);
+            message = kept;
+        };
         /**
          * @brief Returns the message content.
-         * @return The message content as a string.
+         * @return View of the input line.
+         */
+        std::string_view getMessage() const { return message; };
+        /**
+         * @brief Represents the command.
+         */
+        void represent() override;
+    private:
+        // message content (borrowed)
+        std::string_view message;
+        // copy of the content once kept (reused by the pool)
+        std::string kept;
+};
+
+/**
+ * @class CommandLatency
+ * @brief Derived class for the local /latency command.
+ *
+ * The command is never sent to the server, it asks the client to
+ * print its latency histograms.
+ */
+class CommandLatency : public Command {
+    public:
+        /**
+         * @brief Constructor that validates the user input.
+         * @param userInput The raw input string from the user.
+         */
+        CommandLatency(std::string userInput);
+        /**
+         * @brief Destructor.
+         */
+        ~CommandLatency() {};
+        /**
+         * @brief Represents the command.
+         */
+        void represent() override;
+};
+
+/**
+ * @class CommandStats
+ * @brief Derived class for the local /stats command.
+ *
+ * The command is never sent to the server, it asks the client to
+ * print its runtime counters.
+ */
+class CommandStats : public Command {
+    public:
+        /**
+         * @brief Constructor that validates the user input.
+         * @param userInput The raw input string from the user.
+         */
+        CommandStats(std::string userInput);
+        /**
+         * @brief Destructor.
+         */
+        ~CommandStats() {};
+        /**
+         * @brief Represents the command.
+         */
+        void represent() override;
+};
+
+/**
+ * @class CommandSearch
+ * @brief Derived class for the local /search command.
+ *
+ * The command is never sent to the server, it searches the
+ * history of received messages.
+ */
+class CommandSearch : public Command {
+    public:
+        /**
+         * @brief Constructor that initializes the command with user input.
+         * @param userInput The raw input string from the user.
+         */
+        CommandSearch(std::string userInput);
+        /**
+         * @brief Destructor.
+         */
+        ~CommandSearch() {};
+        /**
+         * @brief Returns the search terms.
+         * @return The search terms as a string.
+         */
+        std::string getTerms() const { return terms; };
+        /**
+         * @brief Represents the command.
+         */
+        void represent() override;
+    private:
+        // search terms
+        std::string terms;
+};
+
+/**
+ * @class CommandScrollback
+ * @brief Derived class for the local /scrollback command.
+ *
+ * The command is never sent to the server, it prints messages
+ * from the on-disk message log.
+ */
+class CommandScrollback : public Command {
+    public:
+        /**
+         * @brief Constructor that initializes the command with user input.
+         * @param userInput The raw input string from the user.
+         */
+        CommandScrollback(std::string userInput);
+        /**
+         * @brief Destructor.
+         */
+        ~CommandScrollback() {};
+        /**
+         * @brief Returns the number of messages to print.
+         * @return The message count.
+         */
+        std::size_t getCount() const { return count; };
+        /**
+         * @brief Returns how far back to start.
+         * @return Minutes, -1 for the last messages.
+         */
+        int getMinutes() const { return minutes; };
+        /**
+         * @brief Represents the command.
+         */
+        void represent() override;
+    private:
+        // number of messages
+        std::size_t count = 20;
+        // minutes back, -1 if not given
+        int minutes = -1;
+};
+
+/**
+ * @class CommandSendFile
+ * @brief Derived class for the local /sendfile command.
+ *
+ * The command itself is not sent, it starts streaming the lines of
+ * a file as messages.
+ */
+class CommandSendFile : public Command {
+    public:
+        /**
+         * @brief Constructor that initializes the command with user input.
+         * @param userInput The raw input string from the user.
+         */
+        CommandSendFile(std::string userInput);
+        /**
+         * @brief Destructor.
+         */
+        ~CommandSendFile() {};
+        /**
+         * @brief Returns the path of the file.
+         * @return The path.
+         */
+        std::string getPath() const { return path; };
+        /**
+         * @brief Returns the rate cap.
+         * @return Messages per second, 0 for no cap.
          */
-        std::string getMessage() const { return message; };
+        int getRate() const { return rate; };
         /**
          * @brief Represents the command.
          */
         void represent() override;
     private:
-        // message content
-        std::string message;
+        // file to send
+        std::string path;
+        // messages per second, 0 if not given
+        int rate = 0;
 };
 
 #endif // COMMAND_HPP
\ No newline at end of file
@@ -0,0 +1,98 @@
+/**
+ * @file counters.hpp
+ * @brief Header file for the runtime counters (Counters, CounterBlock)
+ * @author Martin Mendl <x247581>
+ * @date 18.4.2025
+*/
+
+#ifndef COUNTERS_HPP
+#define COUNTERS_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <ostream>
+#include "utils.hpp"
+
+/// Number of message types (MessageType::UNKNOWN is the last one).
+#define MESSAGE_TYPES (static_cast<std::size_t>(MessageType::UNKNOWN) + 1)
+
+/**
+ * @struct CounterBlock
+ * @brief Counters of a single thread.
+ *
+ * Every block has exactly one writer (its thread), so increments are a
+ * relaxed load and store instead of a locked read-modify-write. Readers
+ * (/stats, SIGUSR1) sum all blocks and may see slightly stale values.
+ */
+struct CounterBlock {
+    std::atomic<uint64_t> framesIn[MESSAGE_TYPES] = {};   ///< Received frames/datagrams per type, parsed or not (UNKNOWN if the type is not known).
+    std::atomic<uint64_t> bytesIn[MESSAGE_TYPES] = {};    ///< Received bytes per type.
+    std::atomic<uint64_t> framesOut[MESSAGE_TYPES] = {};  ///< Sent messages per type.
+    std::atomic<uint64_t> bytesOut[MESSAGE_TYPES] = {};   ///< Sent bytes per type.
+    std::atomic<uint64_t> rawBytesIn{0};                  ///< Bytes read from the socket.
+    std::atomic<uint64_t> retransmits{0};                 ///< UDP retransmissions.
+    std::atomic<uint64_t> duplicates{0};                  ///< Duplicate UDP messages dropped.
+    std::atomic<uint64_t> fsmRejectedSent{0};             ///< Outgoing messages rejected by the FSM.
+    std::atomic<uint64_t> fsmRejectedReceived{0};         ///< Incoming messages rejected by the FSM.
+    std::atomic<uint64_t> parseFailures{0};               ///< Messages the parsers did not understand.
+    std::atomic<uint64_t> queueDepth{0};                  ///< Current depth of the inbound queue.
+    std::atomic<uint64_t> queueDepthMax{0};               ///< Highest depth of the inbound queue.
+    std::atomic<uint64_t> reconnects{0};                  ///< Sessions resumed after a lost connection.
+    std::atomic<uint64_t> poolMisses{0};                  ///< Objects a pool had to allocate.
+    std::atomic<uint64_t> names{0};                       ///< Names interned.
+    std::atomic<uint64_t> nameOverflows{0};               ///< Names kept by their message (not interned).
+    std::atomic<uint64_t> framesDrawn{0};                 ///< Terminal frames drawn by the renderer.
+    std::atomic<uint64_t> linesSkipped{0};                ///< Lines that scrolled out before their frame.
+    std::atomic<uint64_t> displayDropped{0};              ///< Received messages dropped from the full display queue.
+    std::atomic<uint64_t> displaySuppressed{0};           ///< Received messages only counted in a summary (sample policy).
+    std::atomic<uint64_t> pipelineStalls{0};              ///< Waits of the network thread for room in the full pipeline ring.
+    std::atomic<uint64_t> confirmBatches{0};              ///< UDP_SEGMENT sends carrying several CONFIRMs.
+    std::atomic<uint64_t> groReceives{0};                 ///< UDP_GRO receives carrying several datagrams.
+    std::atomic<uint64_t> zeroCopySends{0};               ///< sendmsg() calls with MSG_ZEROCOPY.
+    std::atomic<uint64_t> zeroCopyCopied{0};              ///< Zero-copy sends the kernel completed by copying after all.
+    std::atomic<uint64_t> throttled{0};                   ///< Commands queued by the outbound rate limit.
+
+    /// Adds to a counter owned by this thread.
+    static void add(std::atomic<uint64_t>& counter, uint64_t value = 1) {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    /// Counts a received message.
+    void frameIn(MessageType type, std::size_t bytes) {
+        add(framesIn[static_cast<std::size_t>(type)]);
+        add(bytesIn[static_cast<std::size_t>(type)], bytes);
+    }
+
+    /// Counts a sent message.
+    void frameOut(MessageType type, std::size_t bytes) {
+        add(framesOut[static_cast<std::size_t>(type)]);
+        add(bytesOut[static_cast<std::size_t>(type)], bytes);
+    }
+
+    /// Updates the inbound queue gauge.
+    void queue(std::size_t depth) {
+        queueDepth.store(depth, std::memory_order_relaxed);
+        if (depth > queueDepthMax.load(std::memory_order_relaxed)) queueDepthMax.store(depth, std::memory_order_relaxed);
+    }
+};
+
+/**
+ * @class Counters
+ * @brief Registry of the per-thread counter blocks.
+ */
+class Counters {
+    public:
+        /**
+         * @brief Returns the block of the calling thread (registered on first use).
+         */
+        static CounterBlock& local();
+
+        /**
+         * @brief Prints the sum of all blocks.
+         * @param out Stream to print to.
+         */
+        static void print(std::ostream& out);
+};
+
+#endif // COUNTERS_HPP
@@ -0,0 +1,138 @@
+/**
+ * @file history.hpp
+ * @brief Header file for the per-channel message history (History)
+ * @author Martin Mendl <x247581>
+ * @date 18.4.2025
+*/
+
+#ifndef HISTORY_HPP
+#define HISTORY_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <deque>
+#include <list>
+#include <vector>
+#include <ostream>
+#include <unordered_map>
+#include "names.hpp"
+
+/// Default memory budget of the history.
+#define HISTORY_DEFAULT_BUDGET (64u << 20)
+/// Messages indexed per idle event loop iteration.
+#define HISTORY_INDEX_BATCH 4096
+/// Maximum number of printed search results.
+#define HISTORY_MAX_RESULTS 20
+/// Longer words are not indexed (nobody searches for them and a 60 000 byte key would dominate the budget).
+#define HISTORY_MAX_WORD 64
+
+/**
+ * @struct HistoryEntry
+ * @brief One received message.
+ */
+struct HistoryEntry {
+    uint64_t timeNs;      ///< Wall clock time the message was displayed (ns since epoch).
+    KeptName sender;      ///< Display name of the sender (interned, shared with the messages).
+    std::string content;  ///< Message content.
+};
+
+/**
+ * @struct HistoryChannel
+ * @brief Messages of one channel with their inverted index.
+ *
+ * Messages are addressed by a per-channel sequence number; postings hold
+ * sequence numbers in ascending order, so evicted messages (below firstSeq)
+ * are trimmed from the front of a posting list.
+ */
+struct HistoryChannel {
+    std::deque<HistoryEntry> messages;                              ///< Stored messages, oldest first.
+    uint32_t firstSeq = 0;                                          ///< Sequence number of messages.front().
+    uint32_t indexedSeq = 0;                                        ///< Messages below this are indexed.
+    std::unordered_map<std::string, std::vector<uint32_t>> index;   ///< Token -> sequence numbers.
+    std::size_t bytes = 0;                                          ///< Estimated memory use.
+    std::list<std::string>::iterator lru;                           ///< Position in the LRU list.
+
+    /// Sequence number the next message gets.
+    uint32_t endSeq() const { return firstSeq + static_cast<uint32_t>(messages.size()); };
+};
+
+/**
+ * @class History
+ * @brief Per-channel history of received messages with full-text search.
+ *
+ * Appending only stores the message, tokens are indexed later in batches
+ * when the event loop is idle (and before a search), so the receive path
+ * does not pay for indexing. When the memory budget is exceeded the least
+ * recently used channel is evicted; a single channel over the budget drops
+ * its oldest messages.
+ */
+class History {
+    public:
+        /**
+         * @brief Constructs an empty history.
+         * @param budget Memory budget in bytes.
+         */
+        History(std::size_t budget = HISTORY_DEFAULT_BUDGET) : budget(budget) {};
+
+        /**
+         * @brief Sets the memory budget (evicts if needed).
+         * @param bytes Memory budget in bytes.
+         */
+        void setBudget(std::size_t bytes);
+
+        /**
+         * @brief Stores a received message.
+         * @param channel Channel the message was received in.
+         * @param sender Display name of the sender (handle of the message's table).
+         * @param content Message content.
+         */
+        void append(const std::string& channel, const Name& sender, const std::string& content);
+
+        /// Returns true if some messages are not indexed yet.
+        bool pending() const { return unindexed > 0; };
+
+        /**
+         * @brief Indexes up to a number of not yet indexed messages.
+         * @param limit Maximum number of messages to index.
+         */
+        void indexSome(std::size_t limit = HISTORY_INDEX_BATCH);
+
+        /**
+         * @brief Prints the newest messages matching all terms.
+         *
+         * A term matches a word of the content or the sender's display name,
+         * "from:<name>" only matches the sender.
+         * @param terms Search terms separated by whitespace.
+         * @param out Stream to print to.
+         */
+        void search(const std::string& terms, std::ostream& out);
+
+        /// Returns the number of stored messages.
+        std::size_t size() const { return stored; };
+
+        /// Returns the estimated memory use.
+        std::size_t memory() const { return used; };
+
+    private:
+        /// Indexes one message of a channel.
+        void indexMessage(HistoryChannel& channel, uint32_t seq);
+
+        /// Marks a channel as recently used.
+        void touch(HistoryChannel& channel);
+
+        /// Evicts channels/messages until the budget is met.
+        void evict(const std::string& keep);
+
+        /// Drops the oldest messages of a channel.
+        void dropOldest(HistoryChannel& channel, std::size_t count);
+
+        std::unordered_map<std::string, HistoryChannel> channels; ///< Channel name -> channel.
+        std::list<std::string> lru;                                ///< Channel names, most recently used first.
+        std::size_t budget;                                        ///< Memory budget in bytes.
+        std::size_t used = 0;                                      ///< Estimated memory use.
+        std::size_t stored = 0;                                    ///< Number of stored messages.
+        std::size_t unindexed = 0;                                 ///< Number of messages waiting for the indexer.
+};
+
+#endif // HISTORY_HPP
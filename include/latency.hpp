@@ -0,0 +1,119 @@
+/**
+ * @file latency.hpp
+ * @brief Header file for the LatencyHistogram class and latency bookkeeping
+ * @author Martin Mendl <x247581>
+ * @date 18.4.2025
+*/
+
+#ifndef LATENCY_HPP
+#define LATENCY_HPP
+
+#include <cstdint>
+#include <ostream>
+
+/// Sub-bucket bits of the histogram, 2^7 sub-buckets give < 1.6 % relative error.
+#define HISTOGRAM_SUB_BITS 7
+/// Number of counters needed to cover the whole 64-bit range.
+#define HISTOGRAM_SLOTS (((64 - HISTOGRAM_SUB_BITS) << (HISTOGRAM_SUB_BITS - 1)) + (1 << HISTOGRAM_SUB_BITS))
+
+/**
+ * @brief Returns the monotonic time in nanoseconds.
+ */
+uint64_t monotonicNs();
+
+/**
+ * @brief Returns the wall clock time in nanoseconds (the clock of kernel receive timestamps).
+ */
+uint64_t realtimeNs();
+
+/**
+ * @class LatencyHistogram
+ * @brief HDR-style log-linear histogram.
+ *
+ * Values are split into powers of two, each divided into a fixed number of
+ * linear sub-buckets. Recording is a couple of bit operations and one
+ * increment on a preallocated array, so it never allocates.
+ */
+class LatencyHistogram {
+    public:
+        /**
+         * @brief Constructs an empty histogram.
+         * @param name Name printed in reports.
+         * @param isTime True if the values are nanoseconds (printed as microseconds).
+         */
+        LatencyHistogram(const char* name, bool isTime = true);
+
+        /**
+         * @brief Records one value.
+         * @param value Value to record (nanoseconds for time histograms).
+         */
+        void record(uint64_t value);
+
+        /**
+         * @brief Returns the value at a given percentile.
+         * @param percentile Percentile in the <0, 100> range.
+         * @return Highest value equivalent to the bucket of the percentile.
+         */
+        uint64_t percentile(double percentile) const;
+
+        /// Returns the number of recorded values.
+        uint64_t getCount() const { return count; };
+
+        /// Returns the smallest recorded value.
+        uint64_t getMin() const { return count ? min : 0; };
+
+        /// Returns the largest recorded value.
+        uint64_t getMax() const { return max; };
+
+        /// Returns the mean of the recorded values.
+        double getMean() const { return count ? static_cast<double>(sum) / count : 0.0; };
+
+        /// Forgets every recorded value.
+        void reset();
+
+        /**
+         * @brief Prints a one line summary (count, min, mean, percentiles, max).
+         * @param out Stream to print to.
+         */
+        void print(std::ostream& out) const;
+
+    private:
+        /// Maps a value to its counter.
+        static unsigned indexOf(uint64_t value);
+
+        /// Returns the highest value mapping to a counter.
+        static uint64_t highestOf(unsigned index);
+
+        const char* name;                  ///< Name printed in reports.
+        bool isTime;                       ///< Values are nanoseconds.
+        uint64_t count = 0;                ///< Number of recorded values.
+        uint64_t sum = 0;                  ///< Sum of the recorded values (for the mean).
+        uint64_t min = UINT64_MAX;         ///< Smallest recorded value.
+        uint64_t max = 0;                  ///< Largest recorded value.
+        uint64_t counts[HISTOGRAM_SLOTS];  ///< Bucket counters.
+};
+
+/**
+ * @struct LatencyStats
+ * @brief Set of histograms kept by the chat client.
+ */
+struct LatencyStats {
+    LatencyHistogram confirmRtt{"confirm-rtt"};            ///< UDP send -> CONFIRM, per attempt.
+    LatencyHistogram replyLatency{"reply"};                ///< AUTH/JOIN send -> REPLY.
+    LatencyHistogram retransmits{"retransmits", false};    ///< Retransmissions needed per UDP message.
+    LatencyHistogram inputToWire{"input-to-wire"};         ///< stdin line read -> socket write.
+    LatencyHistogram recovery{"recovery"};                 ///< Connection lost -> session resumed.
+    LatencyHistogram firstAuth{"first-auth"};              ///< Process start -> first successful AUTH.
+    LatencyHistogram rxToParse{"rx-to-parse"};             ///< Kernel arrival -> frame/datagram parsed (--rx-timestamps).
+    LatencyHistogram rxToConfirm{"rx-to-confirm"};         ///< Kernel arrival -> CONFIRM sent (UDP, --rx-timestamps).
+    LatencyHistogram rxToDisplay{"rx-to-display"};         ///< Kernel arrival -> MSG handed to the display (--rx-timestamps).
+    LatencyHistogram rateLimit{"rate-limit"};              ///< Command held back by --rate/--byte-rate -> sent.
+
+    /**
+     * @brief Prints every non-empty histogram.
+     * @param out Stream to print to.
+     */
+    void print(std::ostream& out) const;
+};
+
+#endif // LATENCY_HPP
@@ -0,0 +1,52 @@
+/**
+ * @file lz.hpp
+ * @brief Header file for the LZ block codec (LZ)
+ * @author Martin Mendl <x247581>
+ * @date 18.4.2025
+*/
+
+#ifndef LZ_HPP
+#define LZ_HPP
+
+#include <cstddef>
+
+/**
+ * @class LZ
+ * @brief Byte-oriented LZ77 block codec (LZ4-like sequence format).
+ *
+ * A block is a list of sequences: a token byte (literal length in the high
+ * nibble, match length - 4 in the low nibble, 15 means more length bytes
+ * follow, each adding up to 255), the literals, a 16-bit little endian match
+ * offset and the extra match length bytes. The last sequence has literals
+ * only. Blocks are independent, so any block decodes on its own.
+ */
+class LZ {
+    public:
+        /**
+         * @brief Returns the worst-case compressed size of a block.
+         * @param length Raw size.
+         * @return Size the output buffer of compress() needs.
+         */
+        static std::size_t bound(std::size_t length) { return length + length / 255 + 16; };
+
+        /**
+         * @brief Compresses a block.
+         * @param src Raw data.
+         * @param length Raw size.
+         * @param dst Output, at least bound(length) bytes.
+         * @return Compressed size.
+         */
+        static std::size_t compress(const char* src, std::size_t length, char* dst);
+
+        /**
+         * @brief Decompresses a block.
+         * @param src Compressed data.
+         * @param length Compressed size.
+         * @param dst Output, exactly rawLength bytes.
+         * @param rawLength Raw size.
+         * @return False if the block is corrupt (never writes past dst + rawLength).
+         */
+        static bool decompress(const char* src, std::size_t length, char* dst, std::size_t rawLength);
+};
+
+#endif // LZ_HPP
@@ -1,8 +1,12 @@
-
 #ifndef MESSAGE_HPP
 #define MESSAGE_HPP
 #include <string>
+#include <string_view>
+#include <memory>
+#include <tuple>
 #include "command.hpp"
+#include "pool.hpp"
+#include "names.hpp"
 #include "utils.hpp"
 #include <cstdint>
 
@@ -13,163 +17,254 @@ struct clientInfo {
     std::string currentChannel;
 };
 
-bool startsWith(const std::string& str, const std::string& prefix);
+bool startsWith(std::string_view str, std::string_view prefix);
+
+class Message;
+class MessagePool;
+
+// deleter of a MessagePtr, gives the message back to its pool (deletes it without one)
+struct MessageReturn {
+    MessagePool* pool = nullptr;
+    void operator()(Message* message) const;
+};
+
+// owned message, back in its pool once it goes out of scope
+using MessagePtr = std::unique_ptr<Message, MessageReturn>;
 
 // interface/factory for message
 class Message {
     public:
+        Message() {}; // empty message (refilled by assign)
         Message(uint16_t msgID) {this->msgID = msgID;}; // default constructor
         Message(clientInfo* client) {this->client = client;}; // constructor with client info (for factory)
-        ~Message() {};
+        virtual ~Message() {};
         // factory method, to create message form a server response
-        virtual Message* readResponse() {return nullptr;};
+        virtual MessagePtr readResponse() {return nullptr;};
         // base method for converting a cmd to a message
-        virtual Message* convertCommandToMessage() {return nullptr;};
+        virtual MessagePtr convertCommandToMessage() {return nullptr;};
         virtual MessageType getType() = 0;
         uint16_t getId() const {return msgID;};
-        virtual std::string getTCPMsg() {return "";};
-        virtual std::string getUDPMsg() {return "";};
+        // serialized message appended to a (reused) buffer
+        virtual void appendTCPMsg(std::string& message) const {(void)message;};
+        virtual void appendUDPMsg(std::string& message) const {(void)message;};
+        std::string getTCPMsg() const {std::string message; appendTCPMsg(message); return message;};
+        std::string getUDPMsg() const {std::string message; appendUDPMsg(message); return message;};
     protected:
+        friend class MessagePool;
+        // table the names of this message are interned in (the one of its pool)
+        NameTable& nameTable() {return names != nullptr ? *names : NameTable::local();};
         struct clientInfo* client = nullptr;
-        uint16_t msgID;
+        NameTable* names = nullptr;
+        uint16_t msgID = 0;
 };
 
-// TCP factory 
+// TCP factory
 class TCPMessages : public Message {
     public:
-        TCPMessages(clientInfo* client) : Message(client) {};
-        Message* readResponse() override {return nullptr;};
-        Message* readResponse(const std::string& resopnse);
-        Message* convertCommandToMessage() override {return nullptr;};
-        Message* convertCommandToMessage(Command* command);
+        // messages come from the pool if there is one
+        TCPMessages(clientInfo* client, MessagePool* pool = nullptr) : Message(client) {this->pool = pool;};
+        MessagePtr readResponse() override {return nullptr;};
+        // parses one frame (with its \r\n), the contents are copied out of it once
+        MessagePtr readResponse(std::string_view resopnse);
+        MessagePtr convertCommandToMessage() override {return nullptr;};
+        MessagePtr convertCommandToMessage(Command* command);
         MessageType getType() override {return MessageType::UNKNOWN;};
+        // type of a serialized message, without parsing it
+        static MessageType peekType(std::string_view message);
+    private:
+        MessagePool* pool = nullptr;
 };
 
 // UDP factory
 class UDPMessages : public Message {
     public:
-        UDPMessages(clientInfo* client) : Message(client) {};
-        Message* readResponse() override {return nullptr;};
-        Message* readResponse(const std::string& resopnse);
-        Message* convertCommandToMessage() override {return nullptr;};
-        Message* convertCommandToMessage(uint16_t messageID, Command* command);
+        // messages come from the pool if there is one
+        UDPMessages(clientInfo* client, MessagePool* pool = nullptr) : Message(client) {this->pool = pool;};
+        MessagePtr readResponse() override {return nullptr;};
+        // parses one datagram, the contents are copied out of it once
+        MessagePtr readResponse(std::string_view resopnse);
+        MessagePtr convertCommandToMessage() override {return nullptr;};
+        MessagePtr convertCommandToMessage(uint16_t messageID, Command* command);
         MessageType getType() override {return MessageType::UNKNOWN;}
         // static method for udp ping message
-        static std::size_t getNextZeroIdx(const std::string& message, std::size_t startIdx);
-}; 
+        static std::size_t getNextZeroIdx(std::string_view message, std::size_t startIdx);
+        // type of a datagram, without parsing it
+        static MessageType peekType(std::string_view message);
+    private:
+        // parses a datagram, nullptr if it is not understood
+        MessagePtr parseUDP(std::string_view resopnse);
+        MessagePool* pool = nullptr;
+};
 
 // message Error
 class MessageError : public Message {
     public:
-    MessageError(uint16_t msgID, const std::string& displayName, const std::string& content);
+    MessageError() {};
+    MessageError(uint16_t msgID, std::string displayName, std::string content);
     ~MessageError() {};
+    // refills a pooled message (keeps the capacity of its strings)
+    void assign(uint16_t msgID, std::string_view displayName, std::string_view content);
     MessageType getType() override {return MessageType::ERR;};
-    std::string getDisplayName() const { return displayName; };
-    std::string getContent() const { return content; };
-    std::string getTCPMsg() override;
-    std::string getUDPMsg() override;
-    
+    std::string_view getDisplayName() const { return displayName.view(); };
+    Name getDisplayNameHandle() const { return displayName.get(); };
+    const std::string& getContent() const { return content; };
+    void appendTCPMsg(std::string& message) const override;
+    void appendUDPMsg(std::string& message) const override;
+
     protected:
-    std::string displayName;
+    KeptName displayName;
     std::string content;
 };
 
 // message Reply
 class MessageReply : public Message {
     public:
-    MessageReply(uint16_t msgID, bool isOk, uint16_t refID, const std::string& content);
+    MessageReply() {};
+    MessageReply(uint16_t msgID, bool isOk, uint16_t refID, std::string content);
     ~MessageReply() {};
+    void assign(uint16_t msgID, bool isOk, uint16_t refID, std::string_view content);
     MessageType getType() override {return isOk ? MessageType::pREPLY : MessageType::nREPLY;};
     bool isReplyOk() const { return isOk; };
-    std::string getContent() const { return content; };
+    const std::string& getContent() const { return content; };
     uint16_t getRefMsgID() const { return refMsgID; };
-    std::string getTCPMsg() override;
-    std::string getUDPMsg() override;
-    
+    void appendTCPMsg(std::string& message) const override;
+    void appendUDPMsg(std::string& message) const override;
+
     protected:
-    bool isOk;
-    uint16_t refMsgID;
+    bool isOk = false;
+    uint16_t refMsgID = 0;
     std::string content;
 };
 
 // message Auth
 class MessageAuth : public Message {
     public:
-    MessageAuth(uint16_t msgID, const std::string& username, const std::string& displayName, const std::string& secret);
+    MessageAuth() {};
+    MessageAuth(uint16_t msgID, std::string username, std::string displayName, std::string secret);
     ~MessageAuth() {};
+    void assign(uint16_t msgID, std::string_view username, std::string_view displayName, std::string_view secret);
     MessageType getType() override {return MessageType::AUTH;};
-    std::string getTCPMsg() override;
-    std::string getUDPMsg() override;
-    
+    const std::string& getUsername() const { return username; };
+    std::string_view getDisplayName() const { return displayName.view(); };
+    Name getDisplayNameHandle() const { return displayName.get(); };
+    const std::string& getSecret() const { return secret; };
+    void appendTCPMsg(std::string& message) const override;
+    void appendUDPMsg(std::string& message) const override;
+
     protected:
     std::string username;
-    std::string displayName;
+    KeptName displayName;
     std::string secret;
 };
 
 // message Join
 class MessageJoin : public Message {
     public:
-    MessageJoin(uint16_t msgID, const std::string& channelId, const std::string& displayName);
+    MessageJoin() {};
+    MessageJoin(uint16_t msgID, std::string channelId, std::string displayName);
     ~MessageJoin() {};
+    void assign(uint16_t msgID, std::string_view channelId, std::string_view displayName);
     MessageType getType() override {return MessageType::JOIN;};
-    std::string getTCPMsg() override;
-    std::string getUDPMsg() override;
-    
+    std::string_view getChannelId() const { return channelId.view(); };
+    Name getChannelHandle() const { return channelId.get(); };
+    std::string_view getDisplayName() const { return displayName.view(); };
+    Name getDisplayNameHandle() const { return displayName.get(); };
+    void appendTCPMsg(std::string& message) const override;
+    void appendUDPMsg(std::string& message) const override;
+
     protected:
-    std::string displayName;
-    std::string channelId;
+    KeptName displayName;
+    KeptName channelId;
 };
 
 // message Msg
 class MessageMsg : public Message {
     public:
-    MessageMsg(uint16_t msgID, const std::string& displayName, const std::string& content);
+    MessageMsg() {};
+    MessageMsg(uint16_t msgID, std::string displayName, std::string content);
     ~MessageMsg() {};
+    void assign(uint16_t msgID, std::string_view displayName, std::string_view content);
     MessageType getType() override {return MessageType::MSG;};
-    std::string getDisplayName() const { return displayName; };
-    std::string getContent() const { return content; };
-    std::string getTCPMsg() override;
-    std::string getUDPMsg() override;
-    
+    std::string_view getDisplayName() const { return displayName.view(); };
+    Name getDisplayNameHandle() const { return displayName.get(); };
+    const std::string& getContent() const { return content; };
+    void appendTCPMsg(std::string& message) const override;
+    void appendUDPMsg(std::string& message) const override;
+    // "MSG FROM {DisplayName} IS ", the frame without its content and \r\n
+    void appendTCPHeader(std::string& message) const;
+
     protected:
-    std::string displayName;
+    KeptName displayName;
     std::string content;
 };
 
 // message bye
 class MessageBye : public Message {
     public:
-    MessageBye(uint16_t msgID, const std::string& displayName);
+    MessageBye() {};
+    MessageBye(uint16_t msgID, std::string displayName);
     ~MessageBye() {};
+    void assign(uint16_t msgID, std::string_view displayName);
     MessageType getType() override {return MessageType::BYE;};
-    std::string getTCPMsg() override;
-    std::string getUDPMsg() override;
-    
+    std::string_view getDisplayName() const { return displayName.view(); };
+    Name getDisplayNameHandle() const { return displayName.get(); };
+    void appendTCPMsg(std::string& message) const override;
+    void appendUDPMsg(std::string& message) const override;
+
     protected:
-    std::string displayName;
+    KeptName displayName;
 };
 
 // CONFIRM message
 class MessageConfirm : public Message {
     public:
+    MessageConfirm() {};
     MessageConfirm(uint16_t msgID) : Message(msgID) {};
     ~MessageConfirm() {};
-    std::string getUDPMsg() override;
-    std::string getTCPMsg() override {return "";};
+    void assign(uint16_t msgID) {this->msgID = msgID;};
+    void appendUDPMsg(std::string& message) const override;
     MessageType getType() override {return MessageType::CONFIRM;};
-    
+
 };
 
 // PING message
 class MessagePing : public Message {
     public:
+    MessagePing() {};
     MessagePing(uint16_t msgID) : Message(msgID) {};
     ~MessagePing() {};
-    std::string getUDPMsg() override;
-    std::string getTCPMsg() override {return "";};
+    void assign(uint16_t msgID) {this->msgID = msgID;};
+    void appendUDPMsg(std::string& message) const override;
     MessageType getType() override {return MessageType::PING;};
-    
+
+};
+
+// one free list per message type, sized from --pool-size (one pool per thread)
+class MessagePool {
+    public:
+        MessagePool(std::size_t capacity = POOL_DEFAULT_SIZE) {setCapacity(capacity);};
+        void setCapacity(std::size_t capacity) {std::apply([capacity](auto&... pool) {(pool.setCapacity(capacity), ...);}, pools);};
+        // creates the messages up front, so the first ones do not allocate
+        void fill() {std::apply([](auto&... pool) {(pool.fill(), ...);}, pools);};
+        template <typename T> T* take() {
+            T* message = std::get<Pool<T>>(pools).take();
+            message->names = &names;
+            return message;
+        }
+        // takes a message of type T from the pool and fills it (the arguments of T::assign)
+        template <typename T, typename... Args> MessagePtr make(Args&&... args) {
+            T* message = take<T>();
+            message->assign(std::forward<Args>(args)...);
+            return MessagePtr(message, MessageReturn{this});
+        }
+        // gives a message back to the pool of its type
+        void release(Message* message);
+        // display names and channel IDs of the messages
+        NameTable& getNames() {return names;};
+    private:
+        NameTable names;
+        std::tuple<Pool<MessageError>, Pool<MessageReply>, Pool<MessageAuth>, Pool<MessageJoin>,
+                   Pool<MessageMsg>, Pool<MessageBye>, Pool<MessageConfirm>, Pool<MessagePing>> pools;
 };
 
-#endif // MESSAGE_HPP
\ No newline at end of file
+#endif // MESSAGE_HPP
@@ -0,0 +1,232 @@
+/**
+ * @file messageLog.hpp
+ * @brief Header file for the on-disk message log (MessageLog)
+ * @author Martin Mendl <x247581>
+ * @date 18.4.2025
+*/
+
+#ifndef MESSAGELOG_HPP
+#define MESSAGELOG_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <ostream>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/// Size of one log segment (preallocated and mapped).
+#define LOG_SEGMENT_SIZE (64u << 20)
+/// A sparse index entry is written at least every this many bytes.
+#define LOG_INDEX_INTERVAL (64u << 10)
+/// Magic bytes at the start of an archived (compressed) segment.
+#define LOG_ARCHIVE_MAGIC "IPKLZA01"
+
+// When the log is flushed to the disk
+enum class LogSync {
+    NEVER,     // Left to the kernel
+    BATCH,     // After every event loop iteration that wrote something
+    INTERVAL,  // At most once per interval
+};
+
+/**
+ * @struct LogRecordHeader
+ * @brief Header of a log record, followed by channel, sender and content.
+ *
+ * Records are padded to 8 bytes; a zero length marks the end of the
+ * written part of a segment (segments are preallocated with zeros).
+ */
+struct LogRecordHeader {
+    uint32_t length;         ///< Size of the whole record including padding.
+    uint16_t channelLength;  ///< Bytes of the channel name.
+    uint16_t senderLength;   ///< Bytes of the sender's display name.
+    uint64_t timeNs;         ///< Wall clock time (ns since epoch).
+    uint32_t contentLength;  ///< Bytes of the content.
+    uint8_t outgoing;        ///< 1 if the client sent the message.
+    uint8_t reserved[3];     ///< Zero.
+};
+
+/**
+ * @struct LogIndexEntry
+ * @brief Entry of a segment's sparse index (time of the first record at an offset).
+ */
+struct LogIndexEntry {
+    uint64_t timeNs;  ///< Time of the record.
+    uint64_t offset;  ///< Offset of the record in the segment.
+};
+
+/**
+ * @struct LogArchiveHeader
+ * @brief Header of an archived segment (.lza).
+ *
+ * The file is the header, the compressed blocks and the block index
+ * (an array of LogArchiveBlock at indexOffset). Every block is one chunk
+ * of the segment's sparse index, so it starts with a record.
+ */
+struct LogArchiveHeader {
+    char magic[8];         ///< LOG_ARCHIVE_MAGIC.
+    uint64_t rawSize;      ///< Size of the records before compression.
+    uint64_t blocks;       ///< Number of blocks.
+    uint64_t indexOffset;  ///< Offset of the block index in the file.
+};
+
+/**
+ * @struct LogArchiveBlock
+ * @brief Block index entry of an archived segment.
+ */
+struct LogArchiveBlock {
+    uint64_t timeNs;     ///< Time of the first record in the block.
+    uint64_t rawOffset;  ///< Offset of the block in the original segment.
+    uint64_t offset;     ///< Offset of the block in the archive file.
+    uint32_t size;       ///< Stored size (equal to rawSize if stored uncompressed).
+    uint32_t rawSize;    ///< Size of the block before compression.
+};
+
+/**
+ * @struct LogSegment
+ * @brief One segment file, mapped only when it is read or written.
+ */
+struct LogSegment {
+    std::string path;                  ///< Path of the .log file (the index is .idx, the archive .lza).
+    uint64_t firstTimeNs = 0;          ///< Time of the first record (from the file name).
+    bool archived = false;             ///< Only the compressed .lza exists.
+    char* data = nullptr;              ///< Mapping (nullptr until needed).
+    std::vector<LogIndexEntry> index;  ///< Sparse index, chunk i starts at index[i] (loaded with the mapping).
+    std::vector<LogArchiveBlock> blocks; ///< Block index of an archived segment.
+    uint64_t size = 0;                 ///< Size of the mapping.
+    uint64_t end = 0;                  ///< End of the written records (known once mapped).
+};
+
+/**
+ * @struct LogMessage
+ * @brief A message read back from the log.
+ */
+struct LogMessage {
+    uint64_t timeNs;       ///< Wall clock time (ns since epoch).
+    bool outgoing;         ///< The client sent the message.
+    std::string channel;   ///< Channel name.
+    std::string sender;    ///< Sender's display name.
+    std::string content;   ///< Content.
+};
+
+/**
+ * @class MessageLog
+ * @brief Append-only log of displayed and sent messages in mmap-ed segments.
+ *
+ * Messages are queued with append() and written with flush(), once per
+ * event loop iteration. Segments are named by the time of their first
+ * record, so a time seek picks the segment by binary search over the
+ * names and the record by binary search over the segment's sparse index,
+ * then scans at most LOG_INDEX_INTERVAL bytes. Opening only lists the
+ * directory and maps the last segment, older ones are mapped when read.
+ *
+ * A full segment is sealed and compressed by a background thread into an
+ * archive with one LZ block per index chunk, so reading an archived
+ * segment only decompresses the blocks that are actually read.
+ */
+class MessageLog {
+    public:
+        /// Constructs a disabled log.
+        MessageLog() {};
+
+        /// Destructor, flushes and unmaps everything.
+        ~MessageLog();
+
+        /**
+         * @brief Opens (or creates) the log in a directory.
+         * @param directory Directory of the segments.
+         * @param sync Flush policy.
+         * @param intervalMs Interval of LogSync::INTERVAL in milliseconds.
+         * @return Empty string on success, otherwise the error.
+         */
+        std::string open(const std::string& directory, LogSync sync, int intervalMs);
+
+        /// Returns true if the log is open.
+        bool isOpen() const { return !directory.empty(); };
+
+        /**
+         * @brief Queues a message (written by the next flush()).
+         * @param channel Channel name.
+         * @param sender Sender's display name.
+         * @param content Content.
+         * @param outgoing True if the client sent the message.
+         */
+        void append(const std::string& channel, std::string_view sender, const std::string& content, bool outgoing);
+
+        /// Writes the queued messages and applies the flush policy.
+        void flush();
+
+        /// Flushes, syncs and unmaps everything.
+        void close();
+
+        /**
+         * @brief Prints the last messages.
+         * @param count Number of messages.
+         * @param out Stream to print to.
+         */
+        void printLast(std::size_t count, std::ostream& out);
+
+        /**
+         * @brief Prints messages from a point in time on.
+         * @param timeNs Wall clock time (ns since epoch).
+         * @param count Maximum number of messages.
+         * @param out Stream to print to.
+         */
+        void printSince(uint64_t timeNs, std::size_t count, std::ostream& out);
+
+        /**
+         * @brief Compresses a sealed segment into its archive and removes the segment.
+         * @param path Path of the .log file.
+         * @return False if the archive could not be written (the segment is kept).
+         */
+        static bool archiveSegment(const std::string& path);
+
+    private:
+        /// Maps a segment (and loads its index) if it is not mapped yet.
+        bool map(LogSegment& segment, bool writable);
+
+        /// Starts a new segment for a record of the given time.
+        bool rotate(uint64_t timeNs);
+
+        /// Returns the records of one chunk of a segment (decompressed if archived).
+        bool chunk(std::size_t segment, std::size_t index, const char*& data, uint64_t& length);
+
+        /// Finds the segment, chunk and offset of the first record at or after a time.
+        void seek(uint64_t timeNs, std::size_t& segment, std::size_t& chunkNumber, uint64_t& offset);
+
+        /// Queues a sealed segment for the archiver thread.
+        void enqueueArchive(const std::string& path);
+
+        /// Body of the archiver thread.
+        void archiveLoop();
+
+        /// Syncs the written and not yet synced range.
+        void sync();
+
+        std::string directory;              ///< Directory of the segments ("" if disabled).
+        std::vector<LogSegment> segments;   ///< Segments, oldest first.
+        std::string batch;                  ///< Serialized records waiting for flush().
+        std::vector<uint64_t> batchTimes;   ///< Time of every queued record.
+        std::vector<uint32_t> batchOffsets; ///< Offset of every queued record in batch.
+        bool active = false;                ///< segments.back() is mapped for writing.
+        int indexFd = -1;                   ///< Index file of the active segment.
+        uint64_t lastIndexed = 0;           ///< Offset of the last index entry of the active segment.
+        uint64_t synced = 0;                ///< Active segment is synced up to here.
+        LogSync syncPolicy = LogSync::NEVER;///< Flush policy.
+        int intervalMs = 0;                 ///< Interval of LogSync::INTERVAL.
+        uint64_t lastSyncNs = 0;            ///< Time of the last sync.
+        std::string chunkBuffer;            ///< Last decompressed block.
+        std::size_t chunkSegment = SIZE_MAX;///< Segment of chunkBuffer.
+        std::size_t chunkIndex = SIZE_MAX;  ///< Block of chunkBuffer.
+        std::thread archiver;               ///< Compresses sealed segments.
+        std::mutex archiveLock;             ///< Guards archiveQueue and stopping.
+        std::condition_variable archiveWake;///< Wakes the archiver.
+        std::deque<std::string> archiveQueue; ///< Sealed segments waiting for the archiver.
+        bool stopping = false;              ///< The archiver should exit.
+};
+
+#endif // MESSAGELOG_HPP
@@ -0,0 +1,192 @@
+/**
+ * @file names.hpp
+ * @brief Header file for the display name / channel ID interning table (Name, NameTable)
+ * @author Martin Mendl <x247581>
+ * @date 18.4.2025
+*/
+
+#ifndef NAMES_HPP
+#define NAMES_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// Memory a table may use for its names (arena and lookup).
+#define NAMES_DEFAULT_BUDGET (1u << 20)
+/// Size of one arena chunk.
+#define NAMES_CHUNK_SIZE 4096
+/// Longer names are not interned (the protocol allows 20 characters).
+#define NAMES_MAX_LENGTH 64
+/// Estimated lookup overhead of one interned name.
+#define NAMES_ENTRY_OVERHEAD 32
+/// Initial number of lookup slots.
+#define NAMES_INITIAL_SLOTS 256
+
+class NameTable;
+
+/**
+ * @class Name
+ * @brief Handle of a display name or channel ID.
+ *
+ * An interned name points into the arena of its table and has a non zero
+ * id, two interned names of the same table are equal exactly when their
+ * ids are. Every message pool (and every thread) has a table of its own,
+ * ids of different tables say nothing about each other, such names are
+ * compared by their text. So is a name that was not interned (id 0), it
+ * points to text owned by someone else.
+ */
+class Name {
+    public:
+        Name() {};
+
+        /// Returns the text of the name.
+        std::string_view view() const { return std::string_view(text, size); };
+
+        /// Returns the id in its table, 0 if the name is not interned.
+        uint32_t getId() const { return id; };
+
+        /// Returns the table the name is interned in, nullptr if it is not interned.
+        const NameTable* getTable() const { return table; };
+
+        /// Compares two names, O(1) if both are interned in the same table.
+        bool operator==(const Name& other) const {
+            if (id != 0 && table == other.table) return id == other.id;
+            return view() == other.view();
+        };
+
+    private:
+        friend class NameTable;
+        friend class KeptName;
+
+        /**
+         * @brief Constructs a handle.
+         * @param text Text of the name.
+         * @param size Length of the text.
+         * @param id Id in the table (0 if not interned).
+         * @param table Table the name is interned in (nullptr if not interned).
+         */
+        Name(const char* text, uint32_t size, uint32_t id, const NameTable* table) : text(text), size(size), id(id), table(table) {};
+
+        const char* text = "";             ///< Text of the name (not terminated).
+        uint32_t size = 0;                 ///< Length of the text.
+        uint32_t id = 0;                   ///< Id in the table, 0 if not interned.
+        const NameTable* table = nullptr;  ///< Table the id belongs to.
+};
+
+/**
+ * @struct NameHash
+ * @brief Hash of a name for unordered containers (by its text, equal names of different tables hash the same).
+ */
+struct NameHash {
+    std::size_t operator()(const Name& name) const;
+};
+
+/**
+ * @class NameTable
+ * @brief Interning table of display names and channel IDs.
+ *
+ * Every distinct name is stored once in an arena and looked up by its
+ * text (word-at-a-time hash, open addressing; the names are short enough
+ * that a std::unordered_map lookup costs more than copying them), so
+ * messages carry a Name handle instead of their own copy. Names
+ * are never removed (handles stay valid for the lifetime of the table);
+ * once the budget is used up new names are no longer interned and the
+ * caller has to keep the text itself. A table belongs to one thread.
+ */
+class NameTable {
+    public:
+        /**
+         * @brief Constructs an empty table.
+         * @param budget Memory the table may use.
+         */
+        NameTable(std::size_t budget = NAMES_DEFAULT_BUDGET) : budget(budget) {};
+
+        NameTable(const NameTable&) = delete;
+        NameTable& operator=(const NameTable&) = delete;
+
+        /**
+         * @brief Returns the interned handle of a name.
+         *
+         * A name that does not fit (too long, budget used up) is returned
+         * with id 0, pointing to the text passed in.
+         * @param text Text of the name.
+         */
+        Name intern(std::string_view text);
+
+        /// Returns the number of interned names.
+        std::size_t size() const { return names.size(); };
+
+        /// Returns the estimated memory use.
+        std::size_t memory() const { return used; };
+
+        /// Returns the table of the calling thread, for messages built without a pool.
+        static NameTable& local();
+
+    private:
+        /**
+         * @struct Slot
+         * @brief Slot of the open addressing lookup.
+         */
+        struct Slot {
+            uint32_t hash = 0;  ///< Hash of the name.
+            uint32_t id = 0;    ///< Id of the name, 0 if the slot is empty.
+        };
+
+        /// Doubles the lookup and reinserts the names.
+        void grow();
+
+        std::vector<std::unique_ptr<char[]>> chunks;    ///< Arena holding the text of the names.
+        std::size_t chunkUsed = NAMES_CHUNK_SIZE;       ///< Bytes used in the last chunk.
+        std::vector<Name> names;                        ///< Interned names, id - 1 is the index.
+        std::vector<Slot> slots;                        ///< Lookup by hash (power of two, at most half full).
+        std::size_t used = 0;                           ///< Estimated memory use.
+        std::size_t budget;                             ///< Memory the table may use.
+};
+
+/**
+ * @class KeptName
+ * @brief Name held by a message or a history entry.
+ *
+ * Normally just the interned handle, a name the table cannot take is
+ * copied to a string of its own (allocated the first time it is needed,
+ * reused by a pooled message afterwards).
+ */
+class KeptName {
+    public:
+        KeptName() {};
+
+        /**
+         * @brief Sets the name.
+         * @param text Text of the name.
+         * @param table Table to intern it in.
+         */
+        void assign(std::string_view text, NameTable& table) { assign(table.intern(text)); };
+
+        /**
+         * @brief Sets the name from a handle (kept as is if interned, else copied).
+         * @param other Handle of the name.
+         */
+        void assign(const Name& other) {
+            name = other;
+            if (name.getId() != 0) return;
+            if (!copy) copy.reset(new std::string());
+            copy->assign(other.view());
+            name = Name(copy->data(), static_cast<uint32_t>(copy->size()), 0, nullptr);
+        };
+
+        /// Returns the handle.
+        const Name& get() const { return name; };
+
+        /// Returns the text of the name.
+        std::string_view view() const { return name.view(); };
+
+    private:
+        Name name;                          ///< Handle (points to copy if not interned).
+        std::unique_ptr<std::string> copy;  ///< Own copy of a name that was not interned.
+};
+
+#endif // NAMES_HPP
@@ -0,0 +1,108 @@
+/**
+ * @file pool.hpp
+ * @brief Header file for the free-list object pool (Pool)
+ * @author Martin Mendl <x247581>
+ * @date 18.4.2025
+*/
+
+#ifndef POOL_HPP
+#define POOL_HPP
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "counters.hpp"
+
+/// Objects kept per pool unless --pool-size says otherwise.
+#define POOL_DEFAULT_SIZE 16
+
+/**
+ * @class Pool
+ * @brief Free list of reusable objects of one type.
+ *
+ * Objects are handed out by take() and come back through give(); a
+ * returned object keeps its strings, so their capacity is reused by the
+ * next one. At most capacity objects are kept, the rest are deleted, so
+ * a burst cannot grow the pool for good. Every object that has to be
+ * created counts as a pool miss, after the warm-up there are none.
+ * A pool belongs to one thread.
+ */
+template <typename T>
+class Pool {
+    public:
+        /**
+         * @brief Constructs an empty pool.
+         * @param capacity Objects kept at most.
+         */
+        Pool(std::size_t capacity = POOL_DEFAULT_SIZE) { setCapacity(capacity); };
+
+        /// Destructor, deletes the kept objects.
+        ~Pool() { for (T* item : items) delete item; };
+
+        Pool(const Pool&) = delete;
+        Pool& operator=(const Pool&) = delete;
+
+        /**
+         * @brief Sets how many objects are kept (the free list never reallocates).
+         * @param capacity Objects kept at most.
+         */
+        void setCapacity(std::size_t capacity) {
+            this->capacity = capacity;
+            while (items.size() > capacity) {
+                delete items.back();
+                items.pop_back();
+            }
+            items.reserve(capacity);
+        };
+
+        /// Creates objects until the pool is full.
+        void fill() { while (items.size() < capacity) items.push_back(new T()); };
+
+        /// Returns a kept object, or a new one if there is none.
+        T* take() {
+            if (items.empty()) {
+                CounterBlock::add(Counters::local().poolMisses);
+                return new T();
+            }
+            T* item = items.back();
+            items.pop_back();
+            return item;
+        };
+
+        /// Takes an object back (deletes it if the pool is full).
+        void give(T* item) {
+            if (items.size() < capacity) items.push_back(item);
+            else delete item;
+        };
+
+    private:
+        std::vector<T*> items;   ///< Objects ready to be handed out.
+        std::size_t capacity;    ///< Objects kept at most.
+};
+
+/**
+ * @struct PoolReturn
+ * @brief Deleter of a Pooled object, gives it back to its pool (or deletes it without one).
+ */
+template <typename T>
+struct PoolReturn {
+    Pool<T>* pool = nullptr; ///< Pool the object came from.
+
+    /// Returns the object.
+    void operator()(T* item) const {
+        if (pool != nullptr) pool->give(item);
+        else delete item;
+    };
+};
+
+/// Object owned by the caller until it goes out of scope, then back in its pool.
+template <typename T>
+using Pooled = std::unique_ptr<T, PoolReturn<T>>;
+
+/// Takes an object from a pool, owned by the caller.
+template <typename T>
+Pooled<T> acquire(Pool<T>& pool) {
+    return Pooled<T>(pool.take(), PoolReturn<T>{&pool});
+}
+
+#endif // POOL_HPP
@@ -0,0 +1,114 @@
+/**
+ * @file rateLimiter.hpp
+ * @brief Header file for the outbound token buckets (TokenBucket, RateLimiter)
+ * @author Martin Mendl <x247581>
+ * @date 18.4.2025
+*/
+
+#ifndef RATE_LIMITER_HPP
+#define RATE_LIMITER_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+/// Messages waiting for tokens before stdin, a script and a /sendfile stop being read.
+#define RATE_QUEUE_MAX 1024
+
+/**
+ * @struct RateLimit
+ * @brief Outbound limits of a session (0 = no limit).
+ */
+struct RateLimit {
+    double messages = 0;       ///< Messages per second.
+    double messageBurst = 0;   ///< Messages sent back to back at most (0 = one second of the rate).
+    double bytes = 0;          ///< Bytes on the wire per second.
+    double byteBurst = 0;      ///< Bytes sent back to back at most (0 = one second of the rate).
+
+    /// Returns true if any limit is set.
+    bool any() const { return messages > 0 || bytes > 0; };
+};
+
+/**
+ * @class TokenBucket
+ * @brief Token bucket refilled at a fixed rate up to its burst.
+ *
+ * A cost larger than the whole bucket still passes once the bucket is
+ * full, the tokens then go negative and the next sends wait for the debt
+ * to be paid back, so the average rate holds for any cost.
+ */
+class TokenBucket {
+    public:
+        /**
+         * @brief Sets the rate and empties the history (the bucket starts full).
+         * @param rate Tokens per second (0 disables the bucket).
+         * @param burst Capacity in tokens (0 = one second of the rate).
+         */
+        void configure(double rate, double burst);
+
+        /// Returns true if the bucket limits anything.
+        bool enabled() const { return rate > 0; };
+
+        /**
+         * @brief Returns the time until cost can be taken.
+         * @param cost Tokens needed.
+         * @param now Monotonic time in nanoseconds.
+         * @return Nanoseconds to wait (0 if it can be taken now).
+         */
+        uint64_t waitNs(double cost, uint64_t now);
+
+        /**
+         * @brief Takes cost (call after waitNs() said 0).
+         * @param cost Tokens taken.
+         */
+        void take(double cost) { tokens -= cost; };
+
+    private:
+        /// Adds the tokens earned since the last refill.
+        void refill(uint64_t now);
+
+        double rate = 0;          ///< Tokens per second.
+        double capacity = 0;      ///< Most tokens the bucket holds.
+        double tokens = 0;        ///< Tokens now (negative while a large cost is paid back).
+        uint64_t refillNs = 0;    ///< Time of the last refill (0 = not started, the bucket is full).
+};
+
+/**
+ * @class RateLimiter
+ * @brief Message and byte buckets of a session, a send takes from both or waits.
+ */
+class RateLimiter {
+    public:
+        /**
+         * @brief Sets the limits.
+         * @param limit Rates and bursts.
+         */
+        void configure(const RateLimit& limit);
+
+        /// Returns true if any bucket limits anything.
+        bool enabled() const { return messages.enabled() || bytes.enabled(); };
+
+        /// Returns true if the size of a message has to be known.
+        bool countsBytes() const { return bytes.enabled(); };
+
+        /**
+         * @brief Takes one message of the given size if both buckets allow it.
+         * @param size Bytes on the wire.
+         * @param now Monotonic time in nanoseconds.
+         * @return True if the message may go now.
+         */
+        bool take(std::size_t size, uint64_t now);
+
+        /**
+         * @brief Returns the poll timeout until a message of the given size may go.
+         * @param size Bytes on the wire.
+         * @param now Monotonic time in nanoseconds.
+         * @return Milliseconds (rounded up).
+         */
+        int waitMs(std::size_t size, uint64_t now);
+
+    private:
+        TokenBucket messages;  ///< One token per message.
+        TokenBucket bytes;     ///< One token per byte on the wire.
+};
+
+#endif // RATE_LIMITER_HPP
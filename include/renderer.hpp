@@ -0,0 +1,193 @@
+/**
+ * @file renderer.hpp
+ * @brief Header file for the terminal renderer and display queue (Renderer)
+ * @author Martin Mendl <x247581>
+ * @date 18.4.2025
+*/
+
+#ifndef RENDERER_HPP
+#define RENDERER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "names.hpp"
+
+/// Frames per second drawn at most unless --fps says otherwise.
+#define RENDER_DEFAULT_FPS 60
+/// Prompt in front of the input line.
+#define RENDER_PROMPT "> "
+/// Received messages the display queue holds unless --display-queue says otherwise.
+#define DISPLAY_DEFAULT_QUEUE 4096
+/// With the sample policy, one of this many messages is still shown while the queue is full.
+#define DISPLAY_SAMPLE_RATE 16
+/// Interval of the "suppressed" summaries.
+#define DISPLAY_SUMMARY_MS 1000
+/// Bytes handed to one write() of the line output.
+#define DISPLAY_WRITE_SIZE (1 << 16)
+
+/**
+ * @enum DisplayPolicy
+ * @brief What happens to a received message when the display queue is full.
+ */
+enum class DisplayPolicy {
+    BLOCK,        ///< Nothing is lost, the server is not read until the queue drains.
+    DROP_OLDEST,  ///< The oldest queued message is dropped.
+    SAMPLE,       ///< Every DISPLAY_SAMPLE_RATE-th message is shown, the rest are summarised per sender.
+};
+
+/**
+ * @class Renderer
+ * @brief Owner of stdout: a bounded display queue, drawn as a terminal UI or written as lines.
+ *
+ * Everything written to std::cout (and to std::cerr if it is the same
+ * terminal or pipe) becomes a line of the display queue, received
+ * messages come in through message(). stdout is non-blocking, the queue
+ * is written when poll() says it is writable, so a slow terminal or a
+ * stalled pipe never blocks the event loop. Only received messages count
+ * against the bound of the queue and only they are ever dropped; status
+ * lines and errors always get through.
+ *
+ * When stdin and stdout are terminals the queue is drawn at most fps
+ * times per second as one frame: the cursor goes to the bottom of the
+ * scroll region, every line is a \n (the terminal scrolls the region)
+ * plus its text, then the input line is redrawn. Lines that would scroll
+ * out in the same frame are not drawn at all. Keys are read in
+ * non-canonical mode and edited here, typing is echoed right away and
+ * never waits for a frame. Otherwise the lines are written as they are.
+ */
+class Renderer {
+    public:
+        /**
+         * @brief Takes over stdout.
+         * @param fps Frames per second drawn at most.
+         * @param terminal False to write plain lines even to a terminal.
+         * @param capacity Received messages the queue holds.
+         * @param policy What happens to a message when the queue is full.
+         */
+        static void start(int fps, bool terminal, std::size_t capacity, DisplayPolicy policy);
+
+        /// Returns true if the renderer owns stdout.
+        static bool active() { return running; };
+
+        /// Returns true if the renderer draws a terminal UI (and edits the input).
+        static bool terminal() { return running && tty; };
+
+        /**
+         * @brief Displays a received message (subject to the queue policy).
+         * @param sender Display name of the sender (the handle is kept while its messages are summarised).
+         * @param content Message content.
+         */
+        static void message(const Name& sender, std::string_view content);
+
+        /// Returns true if the server should not be read (block policy, queue full).
+        static bool paused() { return running && policy == DisplayPolicy::BLOCK && queued >= capacity; };
+
+        /// Returns true if stdout has to be polled for POLLOUT.
+        static bool wantsWrite();
+
+        /// Writes what stdout takes without blocking (POLLOUT).
+        static void writable();
+
+        /**
+         * @brief Edits the input line with raw keys.
+         * @param data Bytes read from stdin.
+         * @param length Number of bytes.
+         * @param lines Completed lines are appended here.
+         * @return False on Ctrl+D on an empty line (end of input).
+         */
+        static bool type(const char* data, std::size_t length, std::deque<std::string>& lines);
+
+        /// Returns the poll timeout until the next frame or summary is due (-1 if none is).
+        static int timeoutMs();
+
+        /// Writes the summaries and the queue (a terminal frame only if one is due).
+        static void frame();
+
+        /// Adapts to a new terminal size (SIGWINCH).
+        static void resize();
+
+        /// Writes what is left (blocking) and gives stdout back (also runs at exit).
+        static void finish();
+
+    private:
+        /**
+         * @struct Line
+         * @brief Line of the display queue (its string is reused).
+         */
+        struct Line {
+            std::string text;        ///< Text without the line break.
+            bool received = false;   ///< A received message (counts against the bound, may be dropped).
+            bool dropped = false;    ///< Dropped after it was queued.
+        };
+
+        /**
+         * @class Buffer
+         * @brief Stream buffer std::cout writes into while the renderer is active.
+         */
+        class Buffer : public std::streambuf {
+            protected:
+                int_type overflow(int_type c) override;
+                std::streamsize xsputn(const char* data, std::streamsize length) override;
+        };
+
+        /// Appends a line to the queue and returns its text to fill.
+        static std::string& push(bool received);
+
+        /// Removes the first line of the queue.
+        static void pop();
+
+        /// Drops the oldest queued received message.
+        static void dropOldest();
+
+        /// Queues the "suppressed" summaries.
+        static void summarise();
+
+        /// Moves queued lines to the output (line mode).
+        static void fill();
+
+        /// Builds a terminal frame from the queue.
+        static void draw();
+
+        /// Appends the input line (prompt and the end that fits) to the output.
+        static void appendInput();
+
+        /// Writes the output until stdout would block.
+        static void flush();
+
+        /// Writes the output, waiting for stdout.
+        static void flushBlocking();
+
+        static bool running;             ///< The renderer owns stdout.
+        static bool tty;                 ///< Terminal UI instead of plain lines.
+        static Buffer buffer;            ///< Replaces the stream buffer of std::cout.
+        static std::streambuf* coutBuf;  ///< Original stream buffer of std::cout.
+        static std::streambuf* cerrBuf;  ///< Original stream buffer of std::cerr (nullptr if not redirected).
+        static int stdoutFlags;          ///< File status flags of stdout before it was made non-blocking.
+        static std::vector<Line> lines;  ///< Ring of queued lines.
+        static std::size_t head;         ///< Index of the first queued line.
+        static std::size_t count;        ///< Number of queued lines.
+        static std::size_t queued;       ///< Received messages queued (not dropped).
+        static std::size_t capacity;     ///< Received messages the queue holds.
+        static DisplayPolicy policy;     ///< What happens to a message when the queue is full.
+        static std::string partial;      ///< std::cout output without its line break yet.
+        static std::string out;          ///< Bytes being written to stdout.
+        static std::size_t outOffset;    ///< Bytes of out already written.
+        static std::unordered_map<Name, uint64_t, NameHash> suppressed; ///< Sender -> messages suppressed since the last summary.
+        static std::deque<KeptName> suppressedNames; ///< Copies of the senders in suppressed that were not interned.
+        static uint64_t sampled;         ///< Messages that arrived while the queue was full (sample policy).
+        static uint64_t summaryNs;       ///< Time the next summary is due (0 if nothing is suppressed).
+        static std::string input;        ///< Input line being typed.
+        static int escape;               ///< State of a skipped escape sequence (0 none, 1 ESC, 2 CSI, 3 SS3).
+        static int rows;                 ///< Terminal height.
+        static int cols;                 ///< Terminal width.
+        static uint64_t frameNs;         ///< Minimum time between two frames.
+        static uint64_t lastFrameNs;     ///< Time the last frame was drawn.
+};
+
+#endif // RENDERER_HPP
@@ -0,0 +1,110 @@
+/**
+ * @file resolver.hpp
+ * @brief Header file for the asynchronous server name resolver (Resolver)
+ * @author Martin Mendl <x247581>
+ * @date 18.4.2025
+*/
+
+#ifndef RESOLVER_HPP
+#define RESOLVER_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <thread>
+#include <sys/socket.h>
+
+/// Delay before the next address is tried while the previous attempt is pending (RFC 8305 recommends 250 ms).
+#define HAPPY_EYEBALLS_DELAY_MS 250
+/// Default lifetime of a resolver cache entry in seconds.
+#define RESOLVER_CACHE_TTL 300
+
+/**
+ * @class Resolver
+ * @brief Resolves the server name on a background thread.
+ *
+ * getaddrinfo() runs while the client sets up its trace, capture and
+ * message log, the transport only waits for the result when it connects.
+ * Every A and AAAA record is returned, ordered for Happy Eyeballs
+ * (RFC 8305): the families alternate, starting with the one getaddrinfo()
+ * sorted first.
+ *
+ * With a cache file, a cached host name is returned without waiting for
+ * the lookup. An entry older than its TTL is still returned, but a lookup
+ * runs in the background and rewrites it; if the cached addresses do not
+ * answer, refresh() hands out the result of a fresh lookup instead.
+ * getaddrinfo() does not report record TTLs, so every entry gets the same
+ * configured lifetime.
+ */
+class Resolver {
+    public:
+        /// Constructs an idle resolver.
+        Resolver() {};
+
+        /// Destructor, waits for a running lookup.
+        ~Resolver();
+
+        /**
+         * @brief Enables the on-disk cache (before start()).
+         * @param path Cache file ("" disables the cache).
+         * @param ttl Lifetime of an entry in seconds.
+         */
+        void setCache(const std::string& path, int ttl) { cachePath = path; cacheTtl = ttl; };
+
+        /**
+         * @brief Starts resolving a host name or address literal.
+         * @param host Host name, IPv4 or IPv6 address.
+         * @param port Port stored in every address.
+         */
+        void start(const std::string& host, uint16_t port);
+
+        /**
+         * @brief Waits for the lookup started by start() (returns at once on a cache hit).
+         * @param addresses Resolved addresses, in connection order.
+         * @param error Reason if nothing was resolved.
+         * @return False if the name did not resolve.
+         */
+        bool wait(std::vector<sockaddr_storage>& addresses, std::string& error);
+
+        /**
+         * @brief Returns freshly resolved addresses after the cached ones failed.
+         * @param addresses Resolved addresses, in connection order.
+         * @param error Reason if nothing was resolved.
+         * @return False if wait() did not return cached addresses or the name did not resolve.
+         */
+        bool refresh(std::vector<sockaddr_storage>& addresses, std::string& error);
+
+        /// Returns the size of an address of its family.
+        static socklen_t length(const sockaddr_storage& address);
+
+        /// Returns the port of an address (host byte order).
+        static uint16_t port(const sockaddr_storage& address);
+
+        /// Sets the port of an address (host byte order).
+        static void setPort(sockaddr_storage& address, uint16_t port);
+
+        /// Formats an address as "ip:port" ("[ip]:port" for IPv6).
+        static std::string toString(const sockaddr_storage& address);
+
+    private:
+        /// Body of the lookup thread.
+        void run();
+
+        /// Finds the host in the cache file, false if it is not there.
+        bool readCache(std::vector<sockaddr_storage>& entry, bool& expired);
+
+        /// Replaces the host's entry in the cache file.
+        void writeCache(const std::vector<sockaddr_storage>& addresses);
+
+        std::thread worker;                      ///< Lookup thread.
+        std::string host;                        ///< Name being resolved.
+        uint16_t hostPort = 0;                   ///< Port stored in every address.
+        std::vector<sockaddr_storage> results;   ///< Resolved addresses (valid after join).
+        std::string failure;                     ///< Error of the lookup.
+        std::string cachePath;                   ///< Cache file ("" if disabled).
+        int cacheTtl = RESOLVER_CACHE_TTL;       ///< Lifetime of an entry in seconds.
+        std::vector<sockaddr_storage> cached;    ///< Addresses wait() took from the cache.
+        bool cacheHit = false;                   ///< wait() returns the cached addresses.
+};
+
+#endif // RESOLVER_HPP
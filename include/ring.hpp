@@ -0,0 +1,93 @@
+/**
+ * @file ring.hpp
+ * @brief Header file for the lock-free single producer / single consumer ring (SpscRing)
+ * @author Martin Mendl <x247581>
+ * @date 18.4.2025
+*/
+
+#ifndef RING_HPP
+#define RING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// Size of a cache line, the producer and consumer indices each get their own.
+#define RING_CACHE_LINE 64
+
+/**
+ * @class SpscRing
+ * @brief Fixed ring of reusable slots between exactly one producer and one consumer thread.
+ *
+ * The producer fills the slot returned by claim() in place and hands it
+ * over with publish(), the consumer reads front() and gives it back with
+ * pop(). Nothing is allocated or copied by the ring itself and slots keep
+ * their contents, so the strings in them keep their capacity. The two
+ * indices sit on separate cache lines and each side caches the index of
+ * the other one, a slot costs one acquire load only when the cached index
+ * says the ring is full (or empty).
+ */
+template <typename T>
+class SpscRing {
+    public:
+        /**
+         * @brief Constructs the ring.
+         * @param capacity Number of slots, rounded up to a power of two.
+         */
+        SpscRing(std::size_t capacity) {
+            std::size_t size = 1;
+            while (size < capacity) size *= 2;
+            slots.resize(size);
+            mask = size - 1;
+        };
+
+        SpscRing(const SpscRing&) = delete;
+        SpscRing& operator=(const SpscRing&) = delete;
+
+        /**
+         * @brief Returns a slot to fill, nullptr if the ring has no room for it (producer).
+         * @param ahead Slots already claimed and not published yet, a batch is filled before it is handed over.
+         */
+        T* claim(std::size_t ahead = 0) {
+            uint64_t tail = producer.index.load(std::memory_order_relaxed) + ahead;
+            if (tail - producer.cached > mask) {
+                producer.cached = consumer.index.load(std::memory_order_acquire);
+                if (tail - producer.cached > mask) return nullptr;
+            }
+            return &slots[tail & mask];
+        };
+
+        /// Hands the claimed slots to the consumer (producer).
+        void publish(std::size_t count = 1) { producer.index.store(producer.index.load(std::memory_order_relaxed) + count, std::memory_order_release); };
+
+        /// Returns the oldest published slot, nullptr if the ring is empty (consumer).
+        T* front() {
+            uint64_t head = consumer.index.load(std::memory_order_relaxed);
+            if (head == consumer.cached) {
+                consumer.cached = producer.index.load(std::memory_order_acquire);
+                if (head == consumer.cached) return nullptr;
+            }
+            return &slots[head & mask];
+        };
+
+        /// Gives the front slot back to the producer (consumer).
+        void pop() { consumer.index.store(consumer.index.load(std::memory_order_relaxed) + 1, std::memory_order_release); };
+
+    private:
+        /**
+         * @struct Side
+         * @brief Index of one side and its cached copy of the other one, on a cache line of its own.
+         */
+        struct alignas(RING_CACHE_LINE) Side {
+            std::atomic<uint64_t> index{0};  ///< Slots ever published (producer) or popped (consumer).
+            uint64_t cached = 0;             ///< Last seen index of the other side.
+        };
+
+        Side producer;              ///< Written by the producer only.
+        Side consumer;              ///< Written by the consumer only.
+        std::vector<T> slots;       ///< The slots (power of two).
+        std::size_t mask = 0;       ///< Number of slots - 1.
+};
+
+#endif // RING_HPP
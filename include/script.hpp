@@ -0,0 +1,104 @@
+/**
+ * @file script.hpp
+ * @brief Header file for the scripted input file (Script)
+ * @author Martin Mendl <x247581>
+ * @date 18.4.2025
+*/
+
+#ifndef SCRIPT_HPP
+#define SCRIPT_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <ostream>
+#include "latency.hpp"
+
+/// Lines sent per event loop iteration, between two polls of stdin and the socket.
+#define SCRIPT_BATCH_LINES 256
+/// Time a batch may take in milliseconds, a stop-and-wait (UDP) send takes a round trip per line.
+#define SCRIPT_BATCH_MS 5
+/// Interval of the progress line in milliseconds.
+#define SCRIPT_REPORT_MS 1000
+/// Longest MSG content the protocol allows, longer lines of a /sendfile are split.
+#define SCRIPT_MESSAGE_MAX 60000
+/// Messages a rate capped /sendfile may send late to catch up, in milliseconds of its rate.
+#define SCRIPT_CATCH_UP_MS 1000
+
+/**
+ * @class Script
+ * @brief Input file of the -f mode, memory-mapped and split into lines in place.
+ *
+ * Lines are handed out as views into the mapping, so reading a script
+ * costs one memchr per line and no copies until a line is sent.
+ *
+ * The same reader streams the file of a /sendfile: then every line is a
+ * message, lines longer than SCRIPT_MESSAGE_MAX are split, bytes the
+ * protocol does not allow in a content are replaced (a copy is made only
+ * for such a line) and an optional rate spaces the messages out.
+ */
+class Script {
+    public:
+        /// Constructs a closed script.
+        Script() {};
+
+        /// Destructor, unmaps the file.
+        ~Script();
+
+        /**
+         * @brief Maps a script file (a file that is still open is closed first).
+         * @param path Path of the file.
+         * @param messages Hand out protocol-valid message contents (/sendfile) instead of raw lines.
+         * @param rate Lines per second at most (0 = as fast as they are taken).
+         * @return Empty string on success, otherwise the error.
+         */
+        std::string open(const std::string& path, bool messages = false, int rate = 0);
+
+        /// Returns true while there are lines left.
+        bool pending() const { return offset < size; };
+
+        /// Returns true if a line is left and the rate lets it go now.
+        bool ready() const { return pending() && (interval == 0 || monotonicNs() >= dueNs); };
+
+        /// Returns the poll timeout until the next line is due (-1 if none is left).
+        int dueMs() const;
+
+        /**
+         * @brief Returns the next line (without the line break).
+         * @param line View of the line, valid while the script is open.
+         * @return False if there are no lines left.
+         */
+        bool next(std::string_view& line);
+
+        /// Marks the lines handed out so far as sent (written to the socket).
+        void commit() { sentOffset = offset; sentLines = lines; };
+
+        /// Hands out the lines after the last commit again (they were not sent, the connection broke).
+        void rewind();
+
+        /**
+         * @brief Prints the progress, at most every SCRIPT_REPORT_MS (and once when done).
+         * @param out Stream to print to.
+         */
+        void report(std::ostream& out);
+
+    private:
+        /// Unmaps the file and forgets the progress.
+        void close();
+
+        const char* data = nullptr;  ///< Mapping of the file.
+        uint64_t size = 0;           ///< Size of the file.
+        uint64_t offset = 0;         ///< Start of the next line.
+        uint64_t lines = 0;          ///< Lines handed out.
+        uint64_t sentOffset = 0;     ///< Start of the first line not sent yet (rewind).
+        uint64_t sentLines = 0;      ///< Lines sent.
+        bool messages = false;       ///< Lines are message contents (/sendfile).
+        std::string scratch;         ///< Copy of a line that needed replaced bytes.
+        uint64_t interval = 0;       ///< Time between two lines in ns (0 = no rate).
+        uint64_t dueNs = 0;          ///< Time the next line may go (with a rate).
+        uint64_t startNs = 0;        ///< Time the first line was handed out.
+        uint64_t lastReportNs = 0;   ///< Time of the last progress line.
+        bool finished = false;       ///< The final summary was printed.
+};
+
+#endif // SCRIPT_HPP
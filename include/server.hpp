@@ -0,0 +1,328 @@
+/**
+ * @file server.hpp
+ * @brief Header file for the reference chat server (Server, Worker and friends)
+ * @author Martin Mendl <x247581>
+ * @date 18.4.2025
+ */
+
+#ifndef SERVER_HPP
+#define SERVER_HPP
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <random>
+#include <bitset>
+#include <unordered_map>
+#include <unordered_set>
+#include <cstdint>
+#include <netinet/in.h>
+#include "message.hpp"
+#include "serverSettings.hpp"
+#include "utils.hpp"
+
+class Server;
+
+/**
+ * @class FaultInjector
+ * @brief Seeded source of loss, duplication and delay decisions.
+ *
+ * Every worker owns its own injector seeded from the global seed and the
+ * worker index, so a run with the same seed and the same traffic makes
+ * the same decisions.
+ */
+class FaultInjector {
+    public:
+        /**
+         * @brief Constructs the injector from the server settings.
+         * @param settings Server settings holding the fault parameters.
+         * @param stream Index mixed into the seed (worker index).
+         */
+        FaultInjector(const ServerSettings& settings, uint64_t stream);
+
+        /// Decides whether the next outgoing datagram is lost.
+        bool drop();
+
+        /// Decides whether the next outgoing datagram is sent twice.
+        bool duplicate();
+
+        /// Returns the delay for the next outgoing message in nanoseconds.
+        uint64_t delayNs();
+
+        /// Checks if any delay is configured at all.
+        bool hasDelay() const { return delayMs > 0 || jitterMs > 0; };
+
+    private:
+        std::mt19937_64 generator;                 ///< Seeded generator.
+        std::uniform_real_distribution<double> unit{0.0, 1.0}; ///< Distribution for probabilities.
+        double loss;                               ///< Loss probability.
+        double duplication;                        ///< Duplication probability.
+        int delayMs;                               ///< Fixed delay.
+        int jitterMs;                              ///< Random jitter.
+};
+
+/**
+ * @struct Session
+ * @brief State of one connected client (TCP connection or UDP peer).
+ *
+ * A session is owned by exactly one worker at a time, the one owning the
+ * channel the client is in. Sessions move between workers on JOIN.
+ */
+struct Session {
+    /**
+     * @brief Unconfirmed outgoing UDP message waiting for a CONFIRM.
+     */
+    struct Pending {
+        std::string wire;   ///< Serialized datagram.
+        int attempts;       ///< Number of times it was sent.
+    };
+
+    uint64_t id = 0;                    ///< Unique session id (epoll key).
+    Mode transport = Mode::NONE;        ///< TCP or UDP.
+    int fd = -1;                        ///< Connected TCP socket or dedicated UDP socket.
+    sockaddr_in peer{};                 ///< Address of the UDP client.
+    std::string displayName;            ///< Last display name used by the client.
+    std::string channel;                ///< Channel the client is in (empty before AUTH).
+    bool authenticated = false;         ///< Client passed AUTH.
+    bool closing = false;               ///< Session failed and is closed at the end of the iteration.
+    bool lingering = false;             ///< UDP client said BYE, only duplicates are confirmed until closed.
+    bool replyPending = false;          ///< An AUTH/JOIN reply must be sent by the channel owner.
+    uint16_t replyRefId = 0;            ///< Message ID of the AUTH/JOIN being answered.
+    std::string replyContent;           ///< Content of the pending reply.
+    std::string inbuf;                  ///< TCP bytes not forming a full message yet.
+    std::string outbuf;                 ///< TCP bytes not accepted by the kernel yet.
+    uint64_t nextDueNs = 0;             ///< Due time of the last delayed message (keeps TCP ordering).
+    uint16_t nextMsgId = 0;             ///< Next ID of a server to client UDP message.
+    std::bitset<65536> seen;            ///< UDP message IDs already processed.
+    std::unordered_map<uint16_t, Pending> unconfirmed; ///< UDP messages waiting for CONFIRM.
+    std::vector<std::pair<uint64_t, std::string>> deferred; ///< Delayed messages carried over a handoff.
+};
+
+/**
+ * @class Worker
+ * @brief Thread owning a shard of channels and all sessions inside them.
+ *
+ * Each worker runs its own epoll loop. Broadcasts never leave the worker,
+ * since all members of a channel live on the channel's owner.
+ */
+class Worker {
+    public:
+        /**
+         * @brief Constructs a worker.
+         * @param server The server the worker belongs to.
+         * @param index Index of the worker (shard number).
+         * @param settings Server settings.
+         */
+        Worker(Server& server, unsigned index, const ServerSettings& settings);
+
+        /// Destructor, closes all owned sessions.
+        ~Worker();
+
+        /// Starts the worker thread.
+        void start();
+
+        /// Asks the worker to stop and waits for it.
+        void stop();
+
+        /**
+         * @brief Hands a session over to this worker (thread-safe).
+         * @param session The session to adopt.
+         */
+        void adopt(std::unique_ptr<Session> session);
+
+    private:
+        /**
+         * @brief Timer entry kept in the worker's min-heap.
+         */
+        struct Timer {
+            enum class Kind { RETRANSMIT, DELAYED_SEND, PING, CLOSE };
+            uint64_t due;          ///< Monotonic due time in nanoseconds.
+            Kind kind;             ///< What to do when the timer fires.
+            uint64_t sessionId;    ///< Target session (0 for PING).
+            uint16_t msgId;        ///< Message ID for RETRANSMIT.
+            std::string payload;   ///< Bytes for DELAYED_SEND.
+        };
+
+        /// Main loop of the worker thread.
+        void run();
+
+        /// Takes over all sessions handed to this worker.
+        void adoptPending();
+
+        /// Reads and handles everything available on a session socket.
+        void handleReadable(Session& session);
+
+        /// Tries to write the queued TCP bytes of a session.
+        void handleWritable(Session& session);
+
+        /// Splits the TCP input buffer into messages and handles them.
+        void processTcpInput(Session& session);
+
+        /**
+         * @brief Handles one datagram received on a UDP session socket.
+         * @param session The receiving session.
+         * @param datagram The raw datagram.
+         * @return False if the session was closed or moved away.
+         */
+        bool processDatagram(Session& session, const std::string& datagram);
+
+        /**
+         * @brief Handles a parsed client message.
+         * @param session The sending session.
+         * @param msg The parsed message (nullptr if malformed).
+         * @param msgId Message ID of the client message (UDP only).
+         * @return False if the session was closed or moved away.
+         */
+        bool handleMessage(Session& session, Message* msg, uint16_t msgId);
+
+        /**
+         * @brief Moves an authenticated session into a channel, possibly to another worker.
+         * @param session The session.
+         * @param channel The channel to enter.
+         * @param refId Message ID of the AUTH/JOIN being answered.
+         * @param reply Content of the positive reply.
+         * @return False if the session was handed over to another worker.
+         */
+        bool enterChannel(Session& session, const std::string& channel, uint16_t refId, const std::string& reply);
+
+        /// Finishes a JOIN on the channel owner (reply + announcement).
+        void completeJoin(Session& session);
+
+        /// Sends a REPLY to a session.
+        void sendReply(Session& session, bool ok, uint16_t refId, const std::string& content);
+
+        /// Sends an ERR to a session.
+        void sendError(Session& session, const std::string& content);
+
+        /**
+         * @brief Sends a MSG to every member of a channel.
+         * @param channel The target channel.
+         * @param displayName The display name of the sender.
+         * @param content The message content.
+         * @param except Session that should not get the message (the sender).
+         */
+        void broadcast(const std::string& channel, const std::string& displayName, const std::string& content, Session* except);
+
+        /// Writes a fresh server message ID into a serialized datagram.
+        uint16_t stampId(Session& session, std::string& wire);
+
+        /// Sends already serialized bytes to a TCP session, honouring the delay.
+        void sendTcp(Session& session, const std::string& wire);
+
+        /**
+         * @brief Sends a datagram to a UDP session.
+         * @param session The target session.
+         * @param wire The serialized datagram.
+         * @param reliable Track the datagram and retransmit until CONFIRMed.
+         */
+        void sendUdp(Session& session, std::string wire, bool reliable);
+
+        /// Pushes bytes onto the wire, applying loss and duplication for UDP.
+        void transmit(Session& session, const std::string& wire);
+
+        /// Writes bytes to a TCP socket or queues them on EAGAIN.
+        void writeTcp(Session& session, const std::string& wire);
+
+        /// Registers a timer.
+        void schedule(Timer timer);
+
+        /// Fires all timers that are due.
+        void processTimers();
+
+        /// Milliseconds until the next timer (-1 when there are none).
+        int nextTimeout() const;
+
+        /// Removes a session from its channel and the epoll set.
+        std::unique_ptr<Session> detach(Session& session);
+
+        /// Closes a session, announcing the leave when it was in a channel.
+        void closeSession(Session& session, bool announce);
+
+        /// Leaves the channel after a UDP BYE, the socket stays open to confirm retransmissions.
+        void linger(Session& session);
+
+        /// Closes the sessions that failed during the last iteration.
+        void reapClosing();
+
+        Server& server;                                             ///< Owning server.
+        unsigned index;                                             ///< Shard number.
+        const ServerSettings& settings;                             ///< Server settings.
+        FaultInjector faults;                                       ///< Fault injection for this shard.
+        MessagePool messages;                                       ///< Parsed messages, reused by this worker's thread.
+        UDPMessages udpFactory{nullptr, &messages};                 ///< Datagram parser.
+        TCPMessages tcpFactory{nullptr, &messages};                 ///< Text message parser.
+        int epollFd = -1;                                           ///< Epoll instance of the worker.
+        int wakeFd = -1;                                            ///< Eventfd used to wake the worker.
+        std::thread thread;                                         ///< Worker thread.
+        std::atomic<bool> running{false};                           ///< Loop keeps going while true.
+        std::mutex inboxMutex;                                      ///< Guards the inbox.
+        std::vector<std::unique_ptr<Session>> inbox;                ///< Sessions handed over by other threads.
+        std::unordered_map<uint64_t, std::unique_ptr<Session>> sessions; ///< Owned sessions.
+        std::unordered_map<std::string, std::vector<Session*>> channels; ///< Members per channel.
+        std::vector<Timer> timers;                                  ///< Min-heap of timers.
+        std::vector<uint64_t> doomed;                               ///< Sessions to close after the iteration.
+        char* buffer;                                               ///< Receive buffer.
+};
+
+/**
+ * @class Server
+ * @brief Reference IPK25-chat server speaking both TCP and UDP.
+ *
+ * The main thread accepts TCP connections and AUTH datagrams on the UDP
+ * welcome socket, then hands the new sessions to the worker owning the
+ * target channel.
+ */
+class Server {
+    public:
+        /**
+         * @brief Constructs the server and binds the listening sockets.
+         * @param settings Server settings.
+         */
+        Server(const ServerSettings& settings);
+
+        /// Destructor, stops the workers and closes the sockets.
+        ~Server();
+
+        /// Runs the accept loop until SIGINT/SIGTERM.
+        void run();
+
+        /// Returns the worker owning a channel.
+        Worker& ownerOf(const std::string& channel);
+
+        /// Returns a fresh session id.
+        uint64_t nextSessionId() { return sessionIds.fetch_add(1); };
+
+        /// Forgets a UDP peer, called when its session closes.
+        void forgetPeer(const sockaddr_in& peer);
+
+        /// Logs a line when verbose output is enabled (thread-safe).
+        void log(const std::string& line);
+
+    private:
+        /// Accepts all pending TCP connections.
+        void acceptTcp();
+
+        /// Handles datagrams on the UDP welcome socket.
+        void receiveWelcome();
+
+        /// Builds the key of a UDP peer.
+        static uint64_t peerKey(const sockaddr_in& peer);
+
+        const ServerSettings& settings;                       ///< Server settings.
+        int tcpFd = -1;                                       ///< TCP listening socket.
+        int udpFd = -1;                                       ///< UDP welcome socket.
+        int signalFd = -1;                                    ///< Signalfd for SIGINT/SIGTERM.
+        std::vector<std::unique_ptr<Worker>> workers;         ///< Channel shards.
+        unsigned nextWorker = 0;                              ///< Round robin for fresh TCP sessions.
+        std::atomic<uint64_t> sessionIds{1};                  ///< Session id source (0 is the wake event).
+        std::mutex peersMutex;                                ///< Guards knownPeers.
+        std::unordered_set<uint64_t> knownPeers;              ///< UDP peers with a session.
+        FaultInjector faults;                                 ///< Faults for the welcome socket.
+        std::mutex logMutex;                                  ///< Serializes log lines.
+        char* buffer;                                         ///< Receive buffer of the welcome socket.
+};
+
+#endif // SERVER_HPP
@@ -0,0 +1,106 @@
+/**
+ * @file serverSettings.hpp
+ * @brief Header file for the ServerSettings class
+ * @author Martin Mendl <x247581>
+ * @date 18.4.2025
+*/
+
+#ifndef SERVERSETTINGS_HPP
+#define SERVERSETTINGS_HPP
+
+#include <string>
+#include <cstdint>
+
+/**
+ * @class ServerSettings
+ * @brief Class for handling command-line arguments of the reference server.
+ *
+ * Parses the listen address, worker count, reliability parameters and
+ * the fault injection knobs (loss, duplication, delay) used to make
+ * client benchmarks reproducible.
+ */
+class ServerSettings {
+
+    public:
+        /**
+         * @brief Constructor that initializes settings based on command-line arguments.
+         * @param argc The number of command-line arguments.
+         * @param argv The array of command-line arguments.
+         */
+        ServerSettings(int argc, char* argv[]);
+
+        /**
+         * @brief Destructor.
+         */
+        ~ServerSettings() {};
+
+        /// Gets the IPv4 address the server listens on.
+        std::string getListenIp() const { return listenIp; };
+
+        /// Gets the port used by both the TCP listener and the UDP welcome socket.
+        uint16_t getPort() const { return port; };
+
+        /// Gets the number of worker threads channels are sharded across.
+        unsigned getWorkers() const { return workers; };
+
+        /// Gets the UDP confirmation timeout in milliseconds.
+        int getUdpTimeoutConfirmation() const { return udpTimeoutConfirmation; };
+
+        /// Gets the maximum number of UDP retransmissions.
+        int getMaxUdpRetransmissions() const { return maxUdpRetransmissions; };
+
+        /// Gets the interval between UDP pings in milliseconds (0 disables pings).
+        int getPingInterval() const { return pingInterval; };
+
+        /// Gets the probability of dropping an outgoing datagram.
+        double getLoss() const { return loss; };
+
+        /// Gets the probability of duplicating an outgoing datagram.
+        double getDuplication() const { return duplication; };
+
+        /// Gets the fixed delay added to every outgoing message in milliseconds.
+        int getDelay() const { return delay; };
+
+        /// Gets the maximum random jitter added on top of the delay in milliseconds.
+        int getJitter() const { return jitter; };
+
+        /// Gets the seed of the fault injection generators.
+        uint64_t getSeed() const { return seed; };
+
+        /// Checks whether the server should log every handled message.
+        bool isVerbose() const { return verbose; };
+
+        /**
+         * @brief Prints the settings to the console.
+         */
+        void representSettings() const;
+
+    private:
+        /**
+         * @brief Prints the usage of the server.
+         */
+        void printHelp() const;
+
+        /**
+         * @brief Parses a probability argument and checks its range.
+         * @param arg The name of the argument (for error reporting).
+         * @param value The raw value.
+         * @return The parsed probability.
+         */
+        double parseProbability(const std::string& arg, const std::string& value) const;
+
+        std::string listenIp;           ///< Address to bind the sockets to.
+        uint16_t port;                  ///< Listening port.
+        unsigned workers;               ///< Number of worker threads.
+        int udpTimeoutConfirmation;     ///< Timeout for UDP confirmation in milliseconds.
+        int maxUdpRetransmissions;      ///< Maximum number of UDP retransmissions.
+        int pingInterval;               ///< Interval between UDP pings in milliseconds.
+        double loss;                    ///< Outgoing datagram loss probability.
+        double duplication;             ///< Outgoing datagram duplication probability.
+        int delay;                      ///< Fixed outgoing delay in milliseconds.
+        int jitter;                     ///< Random outgoing jitter in milliseconds.
+        uint64_t seed;                  ///< Seed for the fault injection.
+        bool verbose;                   ///< Log handled messages.
+};
+
+#endif // SERVERSETTINGS_HPP
@@ -11,6 +11,15 @@
 #include <string>
 #include <cstdint>
 #include "utils.hpp"
+#include "messageLog.hpp"
+#include "resolver.hpp"
+#include "pool.hpp"
+#include "renderer.hpp"
+#include "socketOptions.hpp"
+#include "rateLimiter.hpp"
+
+/// Config files one command line may read (they may include each other).
+#define SETTINGS_MAX_CONFIGS 16
 
 /// struct for network address
 struct NetworkAdress {
@@ -18,6 +27,7 @@ struct NetworkAdress {
     std::string ip;
     IpVersion ipVer;
     uint16_t port;
+    Resolver* resolver = nullptr; // lookup of hostName (or ip) started by Settings
 };
 
 /**
@@ -73,6 +83,126 @@ class Settings {
          */
         int getMaxUdpRetransmissions() const { return maxUdpRetransmissions; };
 
+        /**
+         * @brief Gets the file the event trace is written to.
+         * @return The trace file path, empty if tracing to a file is disabled.
+         */
+        std::string getTraceFile() const { return traceFile; };
+
+        /**
+         * @brief Gets the file raw traffic is captured to.
+         * @return The capture file path, empty if capturing is disabled.
+         */
+        std::string getCaptureFile() const { return captureFile; };
+
+        /**
+         * @brief Gets the capture file to replay.
+         * @return The replayed capture file path, empty for a normal session.
+         */
+        std::string getReplayFile() const { return replayFile; };
+
+        /**
+         * @brief Gets the replay speed.
+         * @return Multiple of the captured pace, 0 replays offline as fast as possible.
+         */
+        double getReplaySpeed() const { return replaySpeed; };
+
+        /**
+         * @brief Gets the memory budget of the message history.
+         * @return The budget in bytes.
+         */
+        std::size_t getHistoryBudget() const { return historyBudget; };
+
+        /**
+         * @brief Gets the directory of the on-disk message log.
+         * @return The directory, empty if logging is disabled.
+         */
+        std::string getLogDir() const { return logDir; };
+
+        /**
+         * @brief Gets the flush policy of the message log.
+         * @return The policy.
+         */
+        LogSync getLogSync() const { return logSync; };
+
+        /**
+         * @brief Gets the flush interval of the message log.
+         * @return Interval in milliseconds (LogSync::INTERVAL only).
+         */
+        int getLogSyncInterval() const { return logSyncInterval; };
+
+        /**
+         * @brief Gets the maximum number of reconnect attempts per outage.
+         * @return Attempts (0 if reconnecting is disabled).
+         */
+        int getReconnectAttempts() const { return reconnectAttempts; };
+
+        /**
+         * @brief Gets the script whose lines are sent alongside stdin.
+         * @return Path ("" if none).
+         */
+        std::string getScriptFile() const { return scriptFile; };
+
+        /**
+         * @brief Gets the number of objects kept per pool.
+         * @return Pool size.
+         */
+        std::size_t getPoolSize() const { return poolSize; };
+
+        /**
+         * @brief Gets the outbound rate limit of the session.
+         * @return Rates and bursts (0 = no limit).
+         */
+        const RateLimit& getRateLimit() const { return rateLimit; };
+
+        /**
+         * @brief Gets the frame rate cap of the terminal renderer.
+         * @return Frames per second.
+         */
+        int getFps() const { return fps; };
+
+        /**
+         * @brief Gets whether the terminal renderer is disabled.
+         * @return True for plain line output even on a terminal.
+         */
+        bool getPlain() const { return plain; };
+
+        /**
+         * @brief Gets the number of received messages the display queue holds.
+         * @return Queue bound.
+         */
+        std::size_t getDisplayQueue() const { return displayQueue; };
+
+        /**
+         * @brief Gets what happens to received messages when the display queue is full.
+         * @return Display policy (block for TCP, sample for UDP unless set).
+         */
+        DisplayPolicy getDisplayPolicy() const { return displayPolicy; };
+
+        /**
+         * @brief Gets whether UDP datagrams are received and confirmed on a thread of their own.
+         * @return True for the pipelined mode.
+         */
+        bool getPipeline() const { return pipeline; };
+
+        /**
+         * @brief Gets the CPU the network thread of the pipeline is pinned to.
+         * @return CPU number (-1 if not pinned).
+         */
+        int getPinNetwork() const { return pinNetwork; };
+
+        /**
+         * @brief Gets the CPU the protocol (main) thread of the pipeline is pinned to.
+         * @return CPU number (-1 if not pinned).
+         */
+        int getPinProtocol() const { return pinProtocol; };
+
+        /**
+         * @brief Gets the tuning of the client socket.
+         * @return Socket options (kernel defaults where not set).
+         */
+        const SocketOptions& getSocketOptions() const { return socketOptions; };
+
         /**
          * @brief Prints the settings to the console.
          *
@@ -89,17 +219,33 @@ class Settings {
          */
         void printHelp() const;
 
-        /**
-         * @brief Converts a domain name to an IP address.
-         * @param domain The domain name to convert.
-         * @return The corresponding IP address as a string.
-        */
-        std::string getIpFromDomain(const std::string& domain);
-        
         Mode mode;                          ///< Mode of operation (TCP or UDP).
         NetworkAdress server;               ///< Server address.
         int udpTimeoutConfirmation;         ///< Timeout for UDP confirmation in milliseconds.
         int maxUdpRetransmissions;          ///< Maximum number of UDP retransmissions.
+        std::string traceFile;              ///< File the event trace is dumped to.
+        std::string captureFile;            ///< File raw traffic is captured to.
+        std::string replayFile;             ///< Capture file to replay.
+        double replaySpeed;                 ///< Replay pace (0 = offline, as fast as possible).
+        std::size_t historyBudget;          ///< Memory budget of the message history in bytes.
+        std::string logDir;                 ///< Directory of the message log.
+        LogSync logSync;                    ///< Flush policy of the message log.
+        int logSyncInterval;                ///< Flush interval of the message log in milliseconds.
+        int reconnectAttempts;              ///< Reconnect attempts per outage (0 disables reconnecting).
+        std::string scriptFile;             ///< Script sent alongside stdin (-f).
+        std::size_t poolSize;               ///< Objects kept per message, command and buffer pool.
+        RateLimit rateLimit;                ///< Outbound token buckets (--rate, --burst, --byte-rate, --byte-burst).
+        int fps;                            ///< Frame rate cap of the terminal renderer.
+        bool plain;                         ///< Plain line output even on a terminal.
+        std::size_t displayQueue;           ///< Received messages the display queue holds.
+        DisplayPolicy displayPolicy;        ///< Policy of a full display queue.
+        bool pipeline;                      ///< UDP datagrams are received and confirmed on a network thread.
+        int pinNetwork;                     ///< CPU of the network thread (-1 if not pinned).
+        int pinProtocol;                    ///< CPU of the protocol thread (-1 if not pinned).
+        SocketOptions socketOptions;        ///< Tuning of the client socket.
+        std::string dnsCache;               ///< Resolver cache file ("" if disabled).
+        int dnsTtl;                         ///< Lifetime of a resolver cache entry in seconds.
+        Resolver resolver;                  ///< Resolves the server while the client starts up.
 };
 
 #endif // SETTINGS_HPPP
\ No newline at end of file
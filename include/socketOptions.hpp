@@ -0,0 +1,82 @@
+/**
+ * @file socketOptions.hpp
+ * @brief Header file for the client socket tuning (SocketOptions)
+ * @author Martin Mendl <x247581>
+ * @date 18.4.2025
+*/
+
+#ifndef SOCKET_OPTIONS_HPP
+#define SOCKET_OPTIONS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <sys/socket.h>
+#include "utils.hpp"
+
+/**
+ * @struct SocketOptions
+ * @brief Options set on the client socket before it connects (or sends its first datagram).
+ *
+ * Everything left at its default is not touched, the kernel defaults
+ * stay. A buffer size the kernel caps at net.core.rmem_max/wmem_max is
+ * forced past the cap when the process may (CAP_NET_ADMIN); either way
+ * report() shows what the socket really got. An option that cannot be
+ * set is reported and skipped, only a failed bind fails the socket.
+ */
+struct SocketOptions {
+    int receiveBuffer = 0;      ///< SO_RCVBUF in bytes (0 = kernel default).
+    int sendBuffer = 0;         ///< SO_SNDBUF in bytes (0 = kernel default).
+    int busyPoll = -1;          ///< SO_BUSY_POLL in microseconds (-1 = kernel default).
+    bool noDelay = false;       ///< TCP_NODELAY.
+    bool quickAck = false;      ///< TCP_QUICKACK (re-armed after every receive, the kernel clears it).
+    int tos = -1;               ///< IP_TOS / IPV6_TCLASS byte (-1 = kernel default).
+    std::string bindAddress;    ///< Local address ("" = any).
+    uint16_t bindPort = 0;      ///< Local port (0 = any).
+    bool rxTimestamps = false;  ///< SO_TIMESTAMPNS, every receive carries its kernel arrival time.
+    int zeroCopy = 0;           ///< SO_ZEROCOPY, MSGs of at least this many bytes are sent with MSG_ZEROCOPY (0 = off, TCP).
+    bool zeroCopyForce = false; ///< Keeps MSG_ZEROCOPY after the kernel reported a copied send (for measuring).
+
+    /// Returns true if any option differs from the kernel defaults.
+    bool any() const {
+        return receiveBuffer > 0 || sendBuffer > 0 || busyPoll >= 0 || noDelay || quickAck || tos >= 0 || !bindAddress.empty() || bindPort != 0 || rxTimestamps || zeroCopy > 0;
+    };
+
+    /**
+     * @brief Sets the options on a new socket and binds it if asked to.
+     * @param fd The socket.
+     * @param family Address family of the socket.
+     * @param mode Transport of the socket (the TCP options are skipped for UDP).
+     * @return False if the socket could not be bound (errno is set).
+     */
+    bool apply(int fd, int family, Mode mode) const;
+
+    /**
+     * @brief Sets TCP_QUICKACK again (the kernel clears it after a few ACKs).
+     * @param fd The socket.
+     */
+    void rearm(int fd) const;
+
+    /**
+     * @brief Writes the effective values read back from the socket.
+     * @param fd The socket.
+     * @param mode Transport of the socket.
+     * @param out Stream to write the line to.
+     */
+    static void report(int fd, Mode mode, std::ostream& out);
+
+    /**
+     * @brief Receives like recvfrom() and picks up the kernel arrival time if the socket stamps it.
+     * @param fd The socket.
+     * @param data Buffer to receive into.
+     * @param size Size of the buffer.
+     * @param from Sender address (nullptr if not needed).
+     * @param arrivalNs Set to the arrival time (CLOCK_REALTIME ns), 0 if the socket has no timestamps.
+     * @param segment Set to the size of the coalesced datagrams of a UDP_GRO receive, 0 if it holds one (nullptr if UDP_GRO is off).
+     * @return Bytes received, -1 on error (errno is set).
+     */
+    static ssize_t receive(int fd, char* data, std::size_t size, sockaddr_storage* from, uint64_t& arrivalNs, int* segment = nullptr);
+};
+
+#endif // SOCKET_OPTIONS_HPP
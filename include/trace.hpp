@@ -0,0 +1,130 @@
+/**
+ * @file trace.hpp
+ * @brief Header file for the binary event trace (Trace, TraceRecord)
+ * @author Martin Mendl <x247581>
+ * @date 18.4.2025
+*/
+
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include "utils.hpp"
+#include "latency.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/// Number of records kept in the ring (power of two, oldest ones are overwritten).
+#define TRACE_CAPACITY 8192
+/// Magic bytes at the start of a trace file.
+#define TRACE_MAGIC "IPKTRACE"
+/// Version of the trace file layout.
+#define TRACE_VERSION 1
+
+// Kinds of traced events
+enum class TraceKind : uint8_t {
+    SEND,        // Datagram/frame written to the socket
+    RECV,        // Datagram/chunk read from the socket
+    CONFIRM,     // CONFIRM for a sent UDP message arrived
+    RETRANSMIT,  // UDP message sent again
+    TIMEOUT,     // Wait for a CONFIRM or REPLY ran out
+    STATE,       // FSM state changed (size holds the previous state)
+    DROP,        // Connection given up
+};
+
+/**
+ * @struct TraceRecord
+ * @brief One 16 byte trace event.
+ *
+ * The FSM state and message type share a byte (state in the high nibble)
+ * so a record fits a quarter of a cache line.
+ */
+struct TraceRecord {
+    uint64_t ticks;   ///< Timestamp (TSC ticks, or monotonic ns where there is no TSC).
+    uint32_t size;    ///< Bytes on the wire (or the previous state for STATE).
+    uint16_t msgId;   ///< Message ID (0 for TCP).
+    uint8_t kind;     ///< TraceKind.
+    uint8_t info;     ///< FSM state << 4 | MessageType.
+};
+static_assert(sizeof(TraceRecord) == 16, "trace records must stay 16 bytes");
+
+/**
+ * @struct TraceHeader
+ * @brief Header of a trace file, followed by the records in chronological order.
+ *
+ * Two (ticks, ns) pairs taken at start and at dump time let the decoder
+ * convert ticks to nanoseconds.
+ */
+struct TraceHeader {
+    char magic[8];        ///< TRACE_MAGIC.
+    uint32_t version;     ///< TRACE_VERSION.
+    uint32_t records;     ///< Number of records in the file.
+    uint64_t written;     ///< Number of records ever emitted (written - records were overwritten).
+    uint64_t ticksStart;  ///< Ticks when the ring was created.
+    uint64_t nsStart;     ///< Monotonic ns when the ring was created.
+    uint64_t ticksEnd;    ///< Ticks when the file was written.
+    uint64_t nsEnd;       ///< Monotonic ns when the file was written.
+};
+
+/**
+ * @class Trace
+ * @brief Always-on, fixed-size ring of TraceRecords.
+ *
+ * Emitting claims a slot with one relaxed fetch_add and fills it in place,
+ * there are no locks and no allocations. The ring is written to a file on
+ * exit and on SIGUSR1 when an output file was set (--trace).
+ */
+class Trace {
+    public:
+        /**
+         * @brief Reads the trace clock.
+         */
+        static uint64_t ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+            return __rdtsc();
+#else
+            return monotonicNs();
+#endif
+        }
+
+        /**
+         * @brief Records one event.
+         * @param kind Kind of the event.
+         * @param state Current FSM state.
+         * @param type Message type the event is about.
+         * @param msgId Message ID.
+         * @param size Size in bytes.
+         */
+        static void emit(TraceKind kind, FSMState state, MessageType type, uint16_t msgId, uint32_t size) {
+            uint64_t slot = head.fetch_add(1, std::memory_order_relaxed);
+            TraceRecord& record = ring[slot & (TRACE_CAPACITY - 1)];
+            record.ticks = ticks();
+            record.size = size;
+            record.msgId = msgId;
+            record.kind = static_cast<uint8_t>(kind);
+            record.info = static_cast<uint8_t>(static_cast<uint8_t>(state) << 4 | static_cast<uint8_t>(type));
+        }
+
+        /**
+         * @brief Sets the file the ring is dumped to (empty disables dumping).
+         * @param path Path of the trace file.
+         */
+        static void setOutput(const std::string& path) { output = path; };
+
+        /**
+         * @brief Writes the ring to the output file.
+         * @return True if a file was written.
+         */
+        static bool dump();
+
+    private:
+        static TraceRecord ring[TRACE_CAPACITY];  ///< The ring.
+        static std::atomic<uint64_t> head;        ///< Number of records ever emitted.
+        static std::string output;                ///< Trace file ("" if disabled).
+};
+
+#endif // TRACE_HPP
@@ -0,0 +1,75 @@
+/**
+ * @file capture.cpp
+ * @brief Implementation of the Capture class
+ * @author Martin Mendl <x247581>
+ * @date 18.4.2025
+*/
+
+#include <cstring>
+#include "capture.hpp"
+#include "latency.hpp"
+
+#define CAPTURE_BUFFER_SIZE (1 << 16)
+
+FILE* Capture::file = nullptr;
+uint64_t Capture::startNs = 0;
+
+// Method to start capturing
+bool Capture::open(const std::string& path, Mode transport) {
+    file = fopen(path.c_str(), "wb");
+    if (file == nullptr) return false;
+    setvbuf(file, nullptr, _IOFBF, CAPTURE_BUFFER_SIZE);
+
+    CaptureFileHeader header{};
+    memcpy(header.magic, CAPTURE_MAGIC, sizeof(header.magic));
+    header.transport = static_cast<uint8_t>(transport);
+    fwrite(&header, sizeof(header), 1, file);
+    startNs = monotonicNs();
+    return true;
+}
+
+// Method to append a chunk
+void Capture::record(bool outgoing, const char* data, std::size_t length) {
+    if (file == nullptr) return;
+
+    CaptureRecordHeader header{};
+    header.ns = monotonicNs() - startNs;
+    header.length = static_cast<uint32_t>(length);
+    header.outgoing = outgoing ? 1 : 0;
+    // one record at a time, the network thread of --pipeline records as well
+    flockfile(file);
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(data, 1, length, file);
+    funlockfile(file);
+}
+
+// Method to flush the capture
+void Capture::flush() {
+    if (file != nullptr) fflush(file);
+}
+
+// Method to load a capture file
+std::string Capture::load(const std::string& path, Mode& transport, std::vector<CaptureRecord>& records) {
+    FILE* in = fopen(path.c_str(), "rb");
+    if (in == nullptr) return "cannot open " + path;
+
+    CaptureFileHeader fileHeader{};
+    if (fread(&fileHeader, sizeof(fileHeader), 1, in) != 1 || memcmp(fileHeader.magic, CAPTURE_MAGIC, sizeof(fileHeader.magic)) != 0) {
+        fclose(in);
+        return path + " is not a capture file";
+    }
+    transport = static_cast<Mode>(fileHeader.transport);
+
+    // a capture cut short by a crash simply ends at the last complete chunk
+    CaptureRecordHeader header{};
+    while (fread(&header, sizeof(header), 1, in) == 1) {
+        CaptureRecord record;
+        record.ns = header.ns;
+        record.outgoing = header.outgoing != 0;
+        record.data.resize(header.length);
+        if (header.length > 0 && fread(record.data.data(), 1, header.length, in) != header.length) break;
+        records.push_back(std::move(record));
+    }
+    fclose(in);
+    return "";
+}
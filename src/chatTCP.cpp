@@ -8,6 +8,7 @@
 #include <iostream>
 #include <string>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <fcntl.h>
 #include <arpa/inet.h>
 #include <unistd.h>
@@ -15,75 +16,184 @@
 #include <sys/socket.h>
 #include <cstring>
 #include <cstring>
-#include "chat.hpp"
+#include <netinet/in.h>
+#include <linux/errqueue.h>
+#include "chatImpl.hpp"
 
 // Constructor for ChatTCP
 ChatTCP::ChatTCP(NetworkAdress& receiver) : Chat(receiver) {
     client.displayName = "unknown"; // default value
-    tcpFactory = new TCPMessages(&client); // factory for TCP messages
 
-    // create the socket
-    sockfd = socket(AF_INET, SOCK_STREAM, 0);
-    if (sockfd < 0) {
-        std::cout << "Error opening socket\n" << std::flush;
-        destruct();
-        exit(1);
-    }
+    // the socket is created by openConnection, its family depends on the address that wins
+    // create a buffer for the current message, since I am using stream on socket, meaning messges can be split
+    currentMessage.reserve(BUFFER_SIZE); 
+}
+
+// Method to connect to the server
+bool ChatTCP::openConnection() {
+    if (!resolveServer()) return false;
+    if (connectAddresses()) return true;
+
+    // cached addresses may be stale, try what the name resolves to now
+    return refreshServer() && connectAddresses();
+}
+
+// Method to connect to the first address that answers (Happy Eyeballs, RFC 8305)
+bool ChatTCP::connectAddresses() {
 
-    sockaddr_in server = this->receiver;
+    /*
+    The next address is tried every HAPPY_EYEBALLS_DELAY_MS while the earlier
+    attempts stay pending (or right away once they all failed), the first
+    connect that completes wins and the others are closed. The whole race is
+    bounded by the reply timeout, a dead host would block for minutes.
+    */
+    std::vector<struct pollfd> pending;
+    std::vector<std::size_t> pendingAddress;
+    std::size_t next = 0;
+    int lastError = ECONNREFUSED;
+    uint64_t now = monotonicNs();
+    uint64_t deadline = now + static_cast<uint64_t>(timeout_ms) * 1000000;
+    uint64_t nextStart = now;
+    int winner = -1;
+    std::size_t winnerAddress = 0;
+
+    while (winner < 0 && now < deadline) {
+        // start the next attempt
+        if (next < addresses.size() && (now >= nextStart || pending.empty())) {
+            std::size_t index = next++;
+            int fd = socket(addresses[index].ss_family, SOCK_STREAM | SOCK_NONBLOCK, 0);
+            bool ready = fd >= 0 && socketOptions.apply(fd, addresses[index].ss_family, Mode::TCP);
+            int result = !ready ? -1 : connect(fd, (struct sockaddr*)&addresses[index], Resolver::length(addresses[index]));
+            if (result == 0) {
+                winner = fd;
+                winnerAddress = index;
+                break;
+            }
+            if (ready && errno == EINPROGRESS) {
+                pending.push_back({fd, POLLOUT, 0});
+                pendingAddress.push_back(index);
+            } else {
+                lastError = errno;
+                if (fd >= 0) close(fd);
+            }
+            nextStart = now + HAPPY_EYEBALLS_DELAY_MS * 1000000ull;
+            continue;
+        }
+        if (pending.empty()) break; // every address failed
+
+        // wait for an attempt to finish or for the next one to start
+        uint64_t wake = next < addresses.size() ? std::min(deadline, nextStart) : deadline;
+        int ret = poll(pending.data(), pending.size(), static_cast<int>((wake - now + 999999) / 1000000));
+        if (ret < 0 && errno != EINTR) break;
+        for (std::size_t i = 0; ret > 0 && i < pending.size(); ) {
+            if (pending[i].revents == 0) {
+                ++i;
+                continue;
+            }
+            int error = 0;
+            socklen_t length = sizeof(error);
+            getsockopt(pending[i].fd, SOL_SOCKET, SO_ERROR, &error, &length);
+            if (error == 0) {
+                winner = pending[i].fd;
+                winnerAddress = pendingAddress[i];
+                pending.erase(pending.begin() + i);
+                pendingAddress.erase(pendingAddress.begin() + i);
+                break;
+            }
+            lastError = error;
+            close(pending[i].fd);
+            pending.erase(pending.begin() + i);
+            pendingAddress.erase(pendingAddress.begin() + i);
+            nextStart = 0; // a failure starts the next attempt without the delay
+        }
+        now = monotonicNs();
+    }
+    for (struct pollfd& attempt : pending) close(attempt.fd);
 
-    // connect to the server
-    if (connect(sockfd, (struct sockaddr *)&server, sizeof(server)) < 0) {
+    if (winner < 0) {
         std::cout << "Connection failed\n" << std::flush;
+        errno = now >= deadline ? ETIMEDOUT : lastError;
         perror("connect");
-        destruct();
-        exit(1);
+        return false;
     }
+    sockfd = winner;
+    receiver = addresses[winnerAddress];
+
+    // the kernel may refuse SO_ZEROCOPY (it was reported), large MSGs are copied then
+    int enabled = 0;
+    socklen_t enabledLength = sizeof(enabled);
+    zeroCopy = socketOptions.zeroCopy > 0 && getsockopt(sockfd, SOL_SOCKET, SO_ZEROCOPY, &enabled, &enabledLength) == 0 && enabled;
+    zeroCopyCalls = zeroCopyCompleted = 0;
+    if (socketOptions.any()) SocketOptions::report(sockfd, Mode::TCP, std::cerr);
+    return true;
+}
 
-    // create a buffer for the current message, since I am using stream on socket, meaning messges can be split
-    currentMessage.reserve(BUFFER_SIZE); 
-
-    // set the socket to non-blocking mode because I am using poll
-    setNonBlocking(sockfd);
+// Method to replace the socket after the connection broke
+void ChatTCP::resetConnection() {
+    if (sockfd >= 0) close(sockfd);
+    sockfd = -1; // openConnection creates the next one
+
+    // a half-received frame (and an unsent batch) belongs to the old connection
+    currentMessage.clear();
+    outPending.clear();
+    unsent.clear();
+    unsentOffset = 0;
+    unsentInputNs = 0;
+    batching = false;
+    zeroCopyInFlight.clear(); // closed with its socket, the kernel keeps its own references to the pages
 }
 
 // Method to read an incoming message from the server
 void ChatTCP::readMessageFromServer() {
 
     // get the server response
-    std::string response = backendGetServerResponse();
+    ingest(receive());
+}
+
+// Method to frame and handle a raw chunk from the server
+void ChatTCP::ingest(std::string_view response) {
 
     /*
-    Basically here, i know that each message is terminated by \r\n
-    so once a messgae comes in, I will parse it, if i find \r\n, I will
-    add the message to the buffer and clear the current message
-    if the message is not terminated, I will just add it to the current message
+    Each message is terminated by \r\n. Frames that are complete in the
+    chunk are parsed right where recv() put them, only the tail of a frame
+    that continues in the next chunk is kept in currentMessage.
     */
-    char currentChar = '\0';
-    char prevChar = (currentMessage.empty()) ? '\0' : currentMessage.back();
-    for (unsigned i = 0; i < response.size(); i++) {
-        currentChar = response[i];
-        currentMessage += currentChar;
-
-        // we have a complete message
-        if (currentChar == '\n' && prevChar == '\r') {
-            msgBuffer->addMessage(currentMessage);
-            currentMessage.clear();
+    std::size_t start = 0, frames = 0;
+
+    // finish the frame started by an earlier chunk
+    if (!currentMessage.empty()) {
+        // the \r\n can be split between the chunks too
+        bool splitEnd = currentMessage.back() == '\r' && !response.empty() && response[0] == '\n';
+        std::size_t end = splitEnd ? 0 : response.find("\r\n");
+        if (end == std::string_view::npos) {
+            currentMessage.append(response);
+            return;
         }
-        
-        prevChar = currentChar;
+        start = splitEnd ? 1 : end + 2;
+        currentMessage.append(response.substr(0, start));
+        frames++;
+        handleFrame(currentMessage);
+        currentMessage.clear();
     }
 
-    // handle incoming messages
-    while (!msgBuffer->isEmpty()) {
-        std::string message = msgBuffer->getMessage();
-        if (message.empty()) continue;
-
-        // parse the message
-        Message* msg = parseResponse(message);
-        // handle the message
-        handleIncommingMessage(msg);
+    // the complete frames
+    std::size_t end;
+    while ((end = response.find("\r\n", start)) != std::string_view::npos) {
+        frames++;
+        handleFrame(response.substr(start, end + 2 - start));
+        start = end + 2;
     }
+    currentMessage.append(response.substr(start));
+
+    Counters::local().queue(frames);
+}
+
+// Method to parse and handle one frame
+void ChatTCP::handleFrame(std::string_view frame) {
+    // parse the message
+    MessagePtr msg = parseResponse(frame);
+    // handle the message
+    handleIncommingMessage(msg.get());
 }
 
 // Method to handle an incoming message
@@ -92,7 +202,7 @@ void ChatTCP::handleIncommingMessage(Message* message) {
     // if the message is nullptr, it means that we dont understand the message or it is malformed
     if (message == nullptr) {
         std::cout << "ERROR: invalid message/malformed message\n" << std::flush;
-        handleDisconnect(new MessageError(0, client.displayName, "invalid message/malformed message"));
+        handleDisconnect(messages.make<MessageError>(0, client.displayName, "invalid message/malformed message"));
     }
 
     // if the message is an error message, print it and disconnect
@@ -111,7 +221,7 @@ void ChatTCP::handleIncommingMessage(Message* message) {
         } else if (state == FSMState::OPEN) {
             errMsg = "Invalid message, expected MESSAGE but got REPLY";
         }
-        handleDisconnect(new MessageError(0, client.displayName, "Invalid message type for current state"));
+        handleDisconnect(messages.make<MessageError>(0, client.displayName, "Invalid message type for current state"));
         return;
     } 
     
@@ -127,6 +237,9 @@ void ChatTCP::handleIncommingMessage(Message* message) {
 
 // Destructor for ChatTCP (closing the sockets)
 void ChatTCP::destruct() {
+    drainUnsent(); // a BYE (or the end of a replay) waits behind what the socket did not take yet
+    dumpDiagnostics();
+    messageLog.close();
     deleteBuffer();
     if (sockfd >= 0) {
         shutdown(sockfd, SHUT_RDWR); // to not invoke the RST msg on the server
@@ -141,15 +254,22 @@ ChatTCP::~ChatTCP() {
 }
 
 // method for sending message to server
-void ChatTCP::sendMessage(std::string userInput) {
-
+void ChatTCP::sendMessage(std::string_view userInput) {
     // parse the user input
-    Command* command = handleUserInput(userInput);
+    CommandPtr command = handleUserInput(userInput);
+    sendCommand(command);
+}
+
+// method for sending a parsed command to the server
+void ChatTCP::sendCommand(CommandPtr& command) {
     // invalid user input
     if (command == nullptr) return; 
 
     // create the message, form the user Command
-    Message* message = tcpFactory->convertCommandToMessage(command);
+    MessagePtr message = tcpFactory.convertCommandToMessage(command.get());
+
+    // over the rate limit the command waits in the queue (the FSM sees it when it is sent)
+    if (message != nullptr && throttle(command, wireSize(message.get()))) return;
 
     // check if the message is valid
     if (message == nullptr || !msgTypeValidForStateSent(message->getType())) {
@@ -162,46 +282,73 @@ void ChatTCP::sendMessage(std::string userInput) {
         return;
     }
 
-    // send the message to the server
-    backendSendMessage(message->getTCPMsg());
+    // send the message to the server, a large content goes out without building the frame
+    MessageType msgType = message->getType();
+    MessageMsg* msgMsg = msgType == MessageType::MSG ? dynamic_cast<MessageMsg*>(message.get()) : nullptr;
+    Message* sent = message.get(); // a zero-copy send takes the message over, it stays alive until it completes
+    if (msgMsg != nullptr && msgMsg->getContent().size() >= TCP_GATHER_SIZE) backendSendLarge(message);
+    else {
+        Pooled<std::string> frame = takeBuffer();
+        message->appendTCPMsg(*frame);
+        backendSendMessage(*frame);
+    }
+    logSentMessage(sent);
 
     // if we sent an auth message or join message, we need to wait for a reply
-    MessageType msgType = message->getType();
     if (msgType != MessageType::AUTH && msgType != MessageType::JOIN) return;
+    requestSentNs = monotonicNs();
 
     // wait for a reply
     waitForResponseWithTimeout();
 }
 
+// method to get the size of the frame of a message (only if the byte rate needs it)
+std::size_t ChatTCP::wireSize(Message* message) {
+    if (!limiter.countsBytes()) return 0;
+    // "MSG FROM {DisplayName} IS {Content}\r\n" without building a large frame
+    MessageMsg* msg = message->getType() == MessageType::MSG ? dynamic_cast<MessageMsg*>(message) : nullptr;
+    if (msg != nullptr) return sizeof("MSG FROM  IS \r\n") - 1 + msg->getDisplayName().size() + msg->getContent().size();
+    Pooled<std::string> frame = takeBuffer();
+    message->appendTCPMsg(*frame);
+    return frame->size();
+}
+
 void ChatTCP::waitForResponseWithTimeout() {
 
+    // the REPLY can share a chunk with the frames after it (or be split), the chunks go through the framing
+    // until it is handled (printing it clears requestSentNs), an empty wake-up is a zero-copy completion
     int timeLeft = timeout_ms;
-    std::string responseOut = waitForResponse(&timeLeft);
+    while (requestSentNs != 0 && timeLeft > 0 && sockfd >= 0) {
+        std::string_view responseOut = waitForResponse(&timeLeft);
+        if (!responseOut.empty()) ingest(responseOut);
+    }
 
     // no response -> timeout
-    if (responseOut.empty()) {
+    if (requestSentNs != 0) {
+        Trace::emit(TraceKind::TIMEOUT, state, MessageType::UNKNOWN, 0, 0);
         std::cout << "ERROR: timeout on message recv\n" << std::flush;
-        handleDisconnect(new MessageError(0, client.displayName, "timeout on message recv"));
-        return;
+        connectionLost("timeout on message recv", messages.make<MessageError>(0, client.displayName, "timeout on message recv"));
     }
-
-    // parse the response
-    Message* msg = parseResponse(responseOut);
-    // handle the response
-    handleIncommingMessage(msg); 
 }
 
 // method for parsing the server response
-Message* ChatTCP::parseResponse(std::string response) {
-    return tcpFactory->readResponse(response);
+MessagePtr ChatTCP::parseResponse(std::string_view response) {
+    // every frame counts, like every datagram of UDP (UNKNOWN if its keyword is not known), failures are parse-failures
+    Counters::local().frameIn(TCPMessages::peekType(response), response.size());
+    MessagePtr msg = tcpFactory.readResponse(response);
+    recordSinceArrival(latency.rxToParse, arrivalNs);
+    return msg;
 }
 
 // method for handling disconnection
-void ChatTCP::handleDisconnect(Message* exitMsg) {
+void ChatTCP::handleDisconnect(MessagePtr exitMsg) {
+    closing = true; // a failing BYE must not reconnect
 
     if (exitMsg != nullptr) {
         // send the message to the server
-        backendSendMessage(exitMsg->getTCPMsg());
+        Pooled<std::string> frame = takeBuffer();
+        exitMsg->appendTCPMsg(*frame);
+        backendSendMessage(*frame);
     }
 
     destruct(); // close connection and free resources
@@ -209,31 +356,270 @@ void ChatTCP::handleDisconnect(Message* exitMsg) {
 }
 
 // method for receiving server response
-std::string ChatTCP::backendGetServerResponse() {
-    // Clear the buffer first
-    memset(this->buffer, 0, BUFFER_SIZE);
+std::string_view ChatTCP::backendGetServerResponse() {
+    return receive();
+}
+
+// method for receiving a chunk into the receive buffer
+std::string_view ChatTCP::receive() {
+    // completions of zero-copy sends wake the poll too (POLLERR)
+    if (!zeroCopyInFlight.empty()) reapCompletions();
 
     // Receive the message from the server
-    int bytes_received = recv(sockfd, this->buffer, BUFFER_SIZE - 1, 0);
+    int bytes_received = SocketOptions::receive(sockfd, buffer.get(), BUFFER_SIZE, nullptr, arrivalNs);
+
+    // an earlier wait already consumed the data poll reported
+    if (bytes_received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return {};
+
+    if (bytes_received > 0) Capture::record(false, buffer.get(), bytes_received);
+    socketOptions.rearm(sockfd);
+
     if (bytes_received < 0 || bytes_received == 0) {
+        Trace::emit(TraceKind::DROP, state, MessageType::UNKNOWN, 0, 0);
         std::cout << "ERROR: receiving message or connection closed\n" << std::flush;        
-        handleDisconnect(nullptr);
+        connectionLost(bytes_received == 0 ? "connection closed" : strerror(errno), nullptr);
+        return {};
     }
-    return std::string(this->buffer, bytes_received);
+    CounterBlock::add(Counters::local().rawBytesIn, bytes_received);
+    std::string_view response(buffer.get(), bytes_received);
+    Trace::emit(TraceKind::RECV, state, TCPMessages::peekType(response), 0, bytes_received);
+    return response;
 }
 
 // method for sending message to server
-void ChatTCP::backendSendMessage(std::string message) {
-    size_t total_sent = 0;
-    size_t message_length = message.size();
+void ChatTCP::backendSendMessage(std::string_view message) {
+    if (offline) return; // replaying a capture, the server is not there
+
+    MessageType type = TCPMessages::peekType(message);
+    Counters::local().frameOut(type, message.size());
+    Trace::emit(TraceKind::SEND, state, type, 0, message.size());
+    outPending += message;
+
+    // a batch of MSGs goes out in one write, anything else (and a full buffer) right away
+    if (!batching || type != MessageType::MSG || outPending.size() >= BUFFER_SIZE) flushPending();
+}
+
+// method for sending a large MSG straight from the message
+void ChatTCP::backendSendLarge(MessagePtr& message) {
+    if (offline) return; // replaying a capture, the server is not there
+
+    // the header joins the pending frames, the content is not copied
+    MessageMsg* msgMsg = static_cast<MessageMsg*>(message.get());
+    const std::string& content = msgMsg->getContent();
+    std::size_t pending = outPending.size();
+    msgMsg->appendTCPHeader(outPending);
+    std::size_t size = outPending.size() - pending + content.size() + 2;
+    Counters::local().frameOut(MessageType::MSG, size);
+    Trace::emit(TraceKind::SEND, state, MessageType::MSG, 0, size);
+
+    // below the threshold (or with too many sends unfinished, or behind queued bytes) the kernel copies it
+    if (zeroCopy && zeroCopyInFlight.size() >= ZEROCOPY_MAX_IN_FLIGHT) reapCompletions();
+    if (!zeroCopy || !unsent.empty() || content.size() < static_cast<std::size_t>(socketOptions.zeroCopy) || zeroCopyInFlight.size() >= ZEROCOPY_MAX_IN_FLIGHT) {
+        flushPending(content);
+        return;
+    }
+
+    // the pages are read while the data is on its way, the frames and the message must stay where they are
+    ZeroCopySend& held = zeroCopyInFlight.emplace_back();
+    held.frames.swap(outPending);
+    held.message = std::move(message);
+    flushPending(content, &held);
+
+    // every part was copied after all (no room for notifications), the message goes back
+    if (!held.pinned) {
+        message = std::move(held.message);
+        zeroCopyInFlight.pop_back();
+    }
+}
+
+/*
+Every sendmsg() with MSG_ZEROCOPY gets the next number of a 32 bit
+counter, a completion on the error queue covers a range of them. A TCP
+socket completes them in order, so the sends are released from the front
+up to the end of the range, once they were written completely. If the kernel had to copy the data anyway
+(loopback, a device without scatter-gather) zero-copy only adds the
+pinning and the notifications, the socket goes back to regular sends.
+*/
+int ChatTCP::reapCompletions() {
+    int reaped = 0;
+    while (true) {
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(sock_extended_err) + sizeof(sockaddr_in6))];
+        msghdr header{};
+        header.msg_control = control;
+        header.msg_controllen = sizeof(control);
+        if (recvmsg(sockfd, &header, MSG_ERRQUEUE) == -1) break;
+
+        for (cmsghdr* message = CMSG_FIRSTHDR(&header); message != nullptr; message = CMSG_NXTHDR(&header, message)) {
+            bool recvErr = (message->cmsg_level == SOL_IP && message->cmsg_type == IP_RECVERR)
+                || (message->cmsg_level == SOL_IPV6 && message->cmsg_type == IPV6_RECVERR);
+            if (!recvErr) continue;
+            sock_extended_err error;
+            memcpy(&error, CMSG_DATA(message), sizeof(error));
+            if (error.ee_origin != SO_EE_ORIGIN_ZEROCOPY || error.ee_errno != 0) continue;
+
+            // ee_info..ee_data is the range of completed calls
+            ++reaped;
+            if (error.ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+                CounterBlock::add(Counters::local().zeroCopyCopied, error.ee_data - error.ee_info + 1);
+                zeroCopy = socketOptions.zeroCopyForce;
+            }
+            if (static_cast<int32_t>(error.ee_data + 1 - zeroCopyCompleted) > 0) zeroCopyCompleted = error.ee_data + 1;
+        }
+    }
+
+    while (!zeroCopyInFlight.empty()) {
+        ZeroCopySend& oldest = zeroCopyInFlight.front();
+        if (!oldest.written || static_cast<int32_t>(zeroCopyCompleted - oldest.lastCall) <= 0) break;
+        zeroCopyInFlight.pop_front();
+    }
+    return reaped;
+}
+
+// method for writing the pending frames to the socket
+void ChatTCP::flushPending(std::string_view content, ZeroCopySend* held) {
+    // the pending frames, then the content of a large MSG and its \r\n, in one gather write
+    static char lineEnd[] = "\r\n";
+    std::string& frames = held != nullptr ? held->frames : outPending;
+    int flags = MSG_NOSIGNAL | (held != nullptr ? MSG_ZEROCOPY : 0);
+    struct iovec parts[3] = {
+        {frames.data(), frames.size()},
+        {const_cast<char*>(content.data()), content.size()},
+        {lineEnd, content.empty() ? 0 : sizeof(lineEnd) - 1},
+    };
+    struct msghdr header{};
+    header.msg_iov = parts;
+    header.msg_iovlen = 3;
+    size_t left = parts[0].iov_len + parts[1].iov_len + parts[2].iov_len;
+
+    if (!frames.empty()) Capture::record(true, frames.data(), frames.size());
+    if (!content.empty()) {
+        Capture::record(true, content.data(), content.size());
+        Capture::record(true, lineEnd, sizeof(lineEnd) - 1);
+    }
+
+    // earlier bytes still wait for the socket, these go behind them
+    if (!unsent.empty()) left = 0;
 
     // Send the message in chunks
-    while (total_sent < message_length) {
-        ssize_t bytes_sent = send(sockfd, message.c_str() + total_sent, message_length - total_sent, 0);
+    while (left > 0) {
+        ssize_t bytes_sent = sendmsg(sockfd, &header, flags);
+        if (bytes_sent < 0 && errno == EINTR) continue; // a signal is not an error of the socket
+        // no room for the completion notification (optmem_max), this part is copied
+        if (bytes_sent < 0 && errno == ENOBUFS && (flags & MSG_ZEROCOPY)) {
+            flags &= ~MSG_ZEROCOPY;
+            continue;
+        }
+        // the socket buffer is full (bulk sending), the rest waits for POLLOUT in the event loop
+        if (bytes_sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if (bytes_sent < 0) {
+            outPending.clear();
+            std::cout << "Error sending message\n" << std::flush;
+            connectionLost(strerror(errno), nullptr);
+            return;
+        }
+        left -= bytes_sent;
+        if (flags & MSG_ZEROCOPY) {
+            CounterBlock::add(Counters::local().zeroCopySends);
+            held->lastCall = zeroCopyCalls++;
+            held->pinned = true;
+        }
+
+        // skip the written parts
+        size_t written = bytes_sent;
+        while (header.msg_iovlen > 0 && written >= header.msg_iov->iov_len) {
+            written -= header.msg_iov->iov_len;
+            header.msg_iov++;
+            header.msg_iovlen--;
+        }
+        if (header.msg_iovlen > 0) {
+            header.msg_iov->iov_base = static_cast<char*>(header.msg_iov->iov_base) + written;
+            header.msg_iov->iov_len -= written;
+        }
+    }
+
+    // what the socket did not take is copied, the caller may reuse the frames and the content
+    for (size_t i = 0; i < header.msg_iovlen; ++i) {
+        unsent.append(static_cast<char*>(header.msg_iov[i].iov_base), header.msg_iov[i].iov_len);
+    }
+    outPending.clear();
+    if (held != nullptr) held->written = true;
+
+    // first write caused by a stdin line (it is on the wire once unsent drains)
+    if (inputStartNs != 0 && !unsent.empty()) {
+        if (unsentInputNs == 0) unsentInputNs = inputStartNs;
+        inputStartNs = 0;
+    }
+    if (inputStartNs != 0) {
+        latency.inputToWire.record(monotonicNs() - inputStartNs);
+        inputStartNs = 0;
+    }
+    if (!unsent.empty()) writeUnsent();
+}
+
+// method for writing what the socket did not take earlier
+void ChatTCP::writeUnsent() {
+    while (unsentOffset < unsent.size()) {
+        ssize_t bytes_sent = send(sockfd, unsent.data() + unsentOffset, unsent.size() - unsentOffset, MSG_NOSIGNAL);
+        if (bytes_sent < 0 && errno == EINTR) continue;
+        if (bytes_sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            // the written front is dropped once it outgrows the rest, appending stays cheap
+            if (unsentOffset >= BUFFER_SIZE && unsentOffset * 2 >= unsent.size()) {
+                unsent.erase(0, unsentOffset);
+                unsentOffset = 0;
+            }
+            return;
+        }
         if (bytes_sent < 0) {
+            unsent.clear();
+            unsentOffset = 0;
+            unsentInputNs = 0;
             std::cout << "Error sending message\n" << std::flush;
-            handleDisconnect(nullptr);
+            connectionLost(strerror(errno), nullptr);
+            return;
         }
-        total_sent += bytes_sent;
+        unsentOffset += bytes_sent;
+    }
+    unsent.clear();
+    unsentOffset = 0;
+    if (unsentInputNs != 0) {
+        latency.inputToWire.record(monotonicNs() - unsentInputNs);
+        unsentInputNs = 0;
+    }
+}
+
+// method for writing the queued bytes once the socket has room
+void ChatTCP::writable() {
+    // the error queue of zero-copy sends raises POLLERR too, it would not stop
+    if (!zeroCopyInFlight.empty()) reapCompletions();
+    writeUnsent();
+}
+
+// method for writing the queued bytes before the client exits
+void ChatTCP::drainUnsent() {
+    uint64_t deadline = monotonicNs() + static_cast<uint64_t>(timeout_ms) * 1000000;
+    while (!unsent.empty() && sockfd >= 0) {
+        uint64_t now = monotonicNs();
+        if (now >= deadline) break; // the server does not read, the rest is lost with the connection
+        struct pollfd pfd = {sockfd, POLLOUT, 0};
+        int ready = poll(&pfd, 1, static_cast<int>((deadline - now + 999999) / 1000000));
+        if (ready < 0 && errno == EINTR) continue;
+        if (ready <= 0 || (pfd.revents & POLLHUP)) break;
+        if (!zeroCopyInFlight.empty() && (pfd.revents & POLLERR)) reapCompletions();
+        if (!(pfd.revents & POLLOUT)) continue;
+        writeUnsent();
     }
 }
+
+// Method to start coalescing MSG frames
+void ChatTCP::beginBatch() {
+    batching = true;
+}
+
+// Method to write the coalesced frames
+void ChatTCP::endBatch() {
+    batching = false;
+    if (!outPending.empty()) flushPending();
+}
+
+// the core instantiated for this transport
+template class Chat<ChatTCP>;
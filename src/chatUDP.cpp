@@ -14,8 +14,27 @@
 #include <poll.h>
 #include <csignal>
 #include <sys/socket.h>
+#include <sys/eventfd.h>
+#include <netinet/udp.h>
+#include <pthread.h>
+#include <sched.h>
 #include <cstring>
-#include "chat.hpp"
+#include "chatImpl.hpp"
+
+// function to pin a thread to a CPU (-1 leaves it where it is)
+static void pinThread(pthread_t thread, int cpu) {
+    if (cpu < 0) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (pthread_setaffinity_np(thread, sizeof(set), &set) != 0) std::cerr << "ERROR: cannot pin a thread to CPU " << cpu << "\n" << std::flush;
+}
+
+// function to get the message ID of a datagram (0 if it is too short)
+static uint16_t datagramId(std::string_view datagram) {
+    if (datagram.size() < 3) return 0;
+    return static_cast<uint16_t>(static_cast<uint8_t>(datagram[1])) << 8 | static_cast<uint16_t>(static_cast<uint8_t>(datagram[2]));
+}
 
 // Constructor for ChatUDP
 ChatUDP::ChatUDP(NetworkAdress& receiver, int retransmissions, int timeout) : Chat(receiver) {
@@ -25,19 +44,7 @@ ChatUDP::ChatUDP(NetworkAdress& receiver, int retransmissions, int timeout) : Ch
     this->retransmissions = retransmissions;
     this->timeout = timeout;
 
-    // create the udp factory
-    udpFactory = new UDPMessages(&client);
-
-    // setup socket
-    sockfd = socket(AF_INET, SOCK_DGRAM, 0); 
-    if (sockfd < 0) {
-        std::cout << "ERROR: faild to create a socket\n" << std::flush;
-        destruct();
-        exit(1);
-    }
-
-    // Set the socket to non-blocking mode since I am using poll
-    setNonBlocking(sockfd);
+    // the socket is created by openConnection, its family depends on the server address
 }
 
 // Destructor for ChatUDP
@@ -47,7 +54,15 @@ ChatUDP::~ChatUDP() {
 
 // method for ending the communication with the server
 void ChatUDP::destruct() {
+    stopReceiver();
+    dumpDiagnostics();
+    messageLog.close();
     deleteBuffer(); // free memory
+    if (wakeFd >= 0) {
+        close(wakeFd);
+        close(stopFd);
+        wakeFd = stopFd = -1;
+    }
     if (sockfd >= 0) { // close socket
         shutdown(sockfd, SHUT_RDWR);
         close(sockfd);
@@ -55,33 +70,328 @@ void ChatUDP::destruct() {
     }
 }
 
+// Method to connect to the server (connectionless, the server learns our port from AUTH)
+bool ChatUDP::openConnection() {
+    if (!resolveServer()) return false;
+
+    // the first message goes to the first address, retransmissions move on until one confirms
+    addressChosen = false;
+    return useAddress(0);
+}
+
+// Method to send to one of the resolved addresses (a new socket if the family changes)
+bool ChatUDP::useAddress(std::size_t index) {
+    if (sockfd < 0 || receiver.ss_family != addresses[index].ss_family) {
+        stopReceiver();
+        if (sockfd >= 0) close(sockfd);
+        sockfd = socket(addresses[index].ss_family, SOCK_DGRAM, 0);
+        if (sockfd < 0) {
+            std::cout << "ERROR: faild to create a socket\n" << std::flush;
+            return false;
+        }
+        // Set the socket to non-blocking mode since I am using poll
+        setNonBlocking(sockfd);
+        connected.store(false, std::memory_order_relaxed);
+        if (!socketOptions.apply(sockfd, addresses[index].ss_family, Mode::UDP)) {
+            std::cout << "ERROR: cannot bind the socket: " << strerror(errno) << "\n" << std::flush;
+            close(sockfd);
+            sockfd = -1;
+            return false;
+        }
+        if (socketOptions.any()) SocketOptions::report(sockfd, Mode::UDP, std::cerr);
+        startReceiver();
+    }
+    addressIndex = index;
+    receiver = addresses[index];
+    return true;
+}
+
+/*
+The REPLY to AUTH is the first datagram from the port the server keeps for
+this session (the CONFIRM of AUTH still comes from the welcome port). Once
+the socket is connected to it the kernel drops datagrams of anyone else and
+a send no longer looks up the route. If the server answered from another
+address than the one we send to, the socket stays unconnected.
+*/
+void ChatUDP::connectServer() {
+    if (connected.load(std::memory_order_relaxed) || offline || sockfd < 0) return;
+    if (sender_addr.ss_family != receiver.ss_family) return;
+    bool sameHost = receiver.ss_family == AF_INET6
+        ? memcmp(&reinterpret_cast<sockaddr_in6&>(sender_addr).sin6_addr, &reinterpret_cast<sockaddr_in6&>(receiver).sin6_addr, sizeof(in6_addr)) == 0
+        : reinterpret_cast<sockaddr_in&>(sender_addr).sin_addr.s_addr == reinterpret_cast<sockaddr_in&>(receiver).sin_addr.s_addr;
+    if (!sameHost) return;
+
+    Resolver::setPort(receiver, Resolver::port(sender_addr));
+    if (connect(sockfd, (struct sockaddr*)&receiver, Resolver::length(receiver)) == -1) {
+        std::cout << "ERROR: cannot connect the UDP socket: " << strerror(errno) << "\n" << std::flush;
+        return;
+    }
+    connected.store(true, std::memory_order_relaxed);
+}
+
+// Method to start over with a new socket (and a new source port) after the connection broke
+void ChatUDP::resetConnection() {
+    stopReceiver();
+    if (sockfd >= 0) close(sockfd);
+    sockfd = -1; // openConnection creates the next one and restores the original port
+    connected.store(false, std::memory_order_relaxed);
+
+    // the new session starts counting from 0
+    lastShownServerMsgID = 0;
+    confirmedAtLeastOneMessage = false;
+}
+
 // method for reading a message from the server
 void ChatUDP::readMessageFromServer() {
-    // 1. get the server response
-    std::string response = backendGetServerResponse();
+    // pipelined, a batch of the queued datagrams (the wake descriptor stays readable while there are more)
+    int batch = pipeline ? PIPELINE_BATCH : 1;
+    for (int i = 0; i < batch; ++i) {
+        // 1. get the server response
+        std::string_view response = receive();
+        if (response.empty()) return;
+        ingest(response);
+    }
+}
+
+// Method to enable the network thread
+void ChatUDP::setPipeline(int networkCpu, int protocolCpu) {
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeFd < 0 || stopFd < 0) {
+        std::cout << "ERROR: failed to create the pipeline eventfds\n" << std::flush;
+        exit(1);
+    }
+    inbound.reset(new SpscRing<Datagram>(PIPELINE_RING_SIZE));
+    pipeline = true;
+    this->networkCpu = networkCpu;
+    pinThread(pthread_self(), protocolCpu);
+}
+
+// Method to start the network thread
+void ChatUDP::startReceiver() {
+    if (!pipeline || networkThread.joinable() || sockfd < 0) return;
+    // bursts may come in coalesced, the network thread splits them (a kernel without UDP_GRO delivers them one by one)
+    int one = 1;
+    setsockopt(sockfd, SOL_UDP, UDP_GRO, &one, sizeof(one));
+    networkThread = std::thread(&ChatUDP::receiveLoop, this);
+    pinThread(networkThread.native_handle(), networkCpu);
+}
+
+// Method to stop the network thread
+void ChatUDP::stopReceiver() {
+    if (!networkThread.joinable()) return;
+    uint64_t one = 1;
+    if (write(stopFd, &one, sizeof(one)) == -1) perror("write");
+    networkThread.join();
+    if (read(stopFd, &one, sizeof(one)) == -1) perror("read");
+
+    // what it queued belongs to the old socket
+    if (holding) inbound->pop();
+    holding = false;
+    while (inbound->front() != nullptr) inbound->pop();
+    if (read(wakeFd, &one, sizeof(one)) == -1 && errno != EAGAIN) perror("read");
+}
+
+/*
+The network thread drains up to PIPELINE_BATCH datagrams per wake-up. A
+UDP_GRO receive may hold several of them, each gets a slot of its own.
+The CONFIRMs of the batch are collected and sent together once the socket
+has nothing more (or the ring no room), then the slots are handed over.
+*/
+void ChatUDP::receiveLoop() {
+    std::unique_ptr<char[]> data(new char[BUFFER_SIZE]);
+    std::string confirms;
+    sockaddr_storage confirmTo{};
+    struct pollfd fds[2] = {{sockfd, POLLIN, 0}, {stopFd, POLLIN, 0}};
+    uint64_t one = 1;
+    std::size_t pending = 0;
+
+    // confirms what was collected and hands the filled slots to the protocol thread
+    auto handOver = [&]() {
+        sendConfirms(confirms, confirmTo);
+        uint64_t confirmed = 0;
+        for (std::size_t i = 0; i < pending; ++i) {
+            Datagram* slot = inbound->claim(i);
+            if (slot->arrivalNs == 0 || slot->data.size() < 3 || slot->data[0] == 0x00) continue;
+            if (confirmed == 0) confirmed = realtimeNs();
+            slot->confirmedNs = confirmed;
+        }
+        if (pending == 0) return true;
+        inbound->publish(pending);
+        pending = 0;
+        return write(wakeFd, &one, sizeof(one)) != -1;
+    };
+
+    while (true) {
+        if (poll(fds, 2, -1) == -1 && errno != EINTR) return;
+        if (fds[1].revents & POLLIN) return;
+
+        bool failed = false;
+        while (!failed && pending < PIPELINE_BATCH) {
+            sockaddr_storage from;
+            uint64_t arrival;
+            int segment;
+            ssize_t length = SocketOptions::receive(sockfd, data.get(), BUFFER_SIZE, &from, arrival, &segment);
+            // a connected socket reports the ICMP error of an earlier send, the retransmissions deal with it
+            if (length < 0 && (errno == EINTR || errno == ECONNREFUSED)) continue;
+            if (length < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            int error = length < 0 ? errno : 0;
+            failed = error != 0;
+            if (failed) length = 0;
+            if (segment <= 0 || segment >= length) segment = length;
+            else CounterBlock::add(Counters::local().groReceives);
+
+            ssize_t offset = 0;
+            do {
+                std::string_view datagram(data.get() + offset, std::min<ssize_t>(segment, length - offset));
+                offset += segment;
+
+                // confirmed with the batch, a duplicate or a ping goes no further (CONFIRMs are for the protocol thread)
+                if (datagram.size() >= 3 && static_cast<uint8_t>(datagram[0]) != 0x00) {
+                    uint16_t msgID = datagramId(datagram);
+                    bool duplicate = isDuplicate(msgID);
+                    bool otherPeer = !connected.load(std::memory_order_relaxed) && memcmp(&confirmTo, &from, Resolver::length(from)) != 0;
+                    if (otherPeer || confirms.size() >= PIPELINE_BATCH * 3) sendConfirms(confirms, confirmTo);
+                    confirmTo = from;
+                    MessageConfirm(msgID).appendUDPMsg(confirms);
+                    if (duplicate || static_cast<uint8_t>(datagram[0]) == 0xFD) {
+                        // counted here, the protocol thread counts only what it gets
+                        CounterBlock& counters = Counters::local();
+                        CounterBlock::add(counters.rawBytesIn, datagram.size());
+                        counters.frameIn(UDPMessages::peekType(datagram), datagram.size());
+                        continue;
+                    }
+                }
+
+                // with the ring full the batch is handed over and the datagram has to wait (and so does the socket)
+                Datagram* slot = inbound->claim(pending);
+                if (slot == nullptr) {
+                    if (!handOver()) return;
+                    while ((slot = inbound->claim()) == nullptr) {
+                        CounterBlock::add(Counters::local().pipelineStalls);
+                        if (poll(&fds[1], 1, 1) > 0) return;
+                    }
+                }
+                slot->data.assign(datagram);
+                slot->from = from;
+                slot->error = error;
+                slot->arrivalNs = arrival;
+                slot->confirmedNs = 0;
+                ++pending;
+            } while (offset < length);
+        }
+        if (!handOver()) return;
+        if (failed) return;
+    }
+}
+
+// Method to send the CONFIRMs of the network thread
+void ChatUDP::sendConfirms(std::string& batch, const sockaddr_storage& to) {
+    if (batch.empty()) return;
+    bool isConnected = connected.load(std::memory_order_relaxed);
+    iovec vector{batch.data(), batch.size()};
+    msghdr header{};
+    header.msg_name = isConnected ? nullptr : const_cast<sockaddr_storage*>(&to);
+    header.msg_namelen = isConnected ? 0 : Resolver::length(to);
+    header.msg_iov = &vector;
+    header.msg_iovlen = 1;
+
+    // one call, the kernel cuts it into 3 byte datagrams (GSO)
+    std::size_t count = batch.size() / 3;
+    bool batched = false;
+    if (segmentation && count > 1) {
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(uint16_t))] = {};
+        header.msg_control = control;
+        header.msg_controllen = sizeof(control);
+        cmsghdr* message = CMSG_FIRSTHDR(&header);
+        message->cmsg_level = SOL_UDP;
+        message->cmsg_type = UDP_SEGMENT;
+        message->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+        uint16_t size = 3;
+        memcpy(CMSG_DATA(message), &size, sizeof(size));
+        batched = sendmsg(sockfd, &header, 0) >= 0;
+        if (batched) CounterBlock::add(Counters::local().confirmBatches);
+        // the kernel (or the device) cannot segment, one datagram per call from now on
+        else if (errno == EIO || errno == EINVAL || errno == ENOPROTOOPT || errno == EOPNOTSUPP) segmentation = false;
+        header.msg_control = nullptr;
+        header.msg_controllen = 0;
+    }
+
+    // one by one, unless the batch went out
+    CounterBlock& counters = Counters::local();
+    for (std::size_t i = 0; i < count; ++i) {
+        vector.iov_base = batch.data() + i * 3;
+        vector.iov_len = 3;
+        if (!batched && sendmsg(sockfd, &header, 0) <= 0) continue;
+        Capture::record(true, batch.data() + i * 3, 3);
+        counters.frameOut(MessageType::CONFIRM, 3);
+    }
+    batch.clear();
+}
+
+// Method to drop duplicates (lastShownServerMsgID belongs to the thread that receives)
+bool ChatUDP::isDuplicate(uint16_t msgID) {
+    if (msgID <= lastShownServerMsgID && confirmedAtLeastOneMessage) {
+        CounterBlock::add(Counters::local().duplicates);
+        return true;
+    }
+    lastShownServerMsgID = msgID;
+    confirmedAtLeastOneMessage = true;
+    return false;
+}
+
+// Method to take the next datagram queued by the network thread
+ChatUDP::Datagram* ChatUDP::takeDatagram() {
+    if (holding) inbound->pop();
+    holding = false;
+
+    // the wake descriptor is cleared only once the ring is empty, then checked again (nothing is missed)
+    Datagram* slot = inbound->front();
+    if (slot == nullptr) {
+        uint64_t count;
+        if (read(wakeFd, &count, sizeof(count)) == -1 && errno != EAGAIN) perror("read");
+        slot = inbound->front();
+        if (slot == nullptr) return nullptr;
+    }
+    holding = true;
+    return slot;
+}
+
+// method for handling a raw datagram from the server
+void ChatUDP::ingest(std::string_view response) {
+    if (response.empty()) return;
     // 2. handle confirmation/ping or exit on bye
     if (!handleConfirmation(response)) return;
     // 3. parse the response
-    Message* message = parseResponse(response);
+    MessagePtr message = parseResponse(response);
     // 4. handle the message
-    handleIncommingMessage(message);
+    handleIncommingMessage(message.get());
 }
 
 // method for parsing the server response
-Message* ChatUDP::parseResponse(std::string response) {
+MessagePtr ChatUDP::parseResponse(std::string_view response) {
     // parse the response and return the message object
-    return udpFactory->readResponse(response);
+    MessagePtr message = udpFactory.readResponse(response);
+    recordSinceArrival(latency.rxToParse, arrivalNs);
+    return message;
 }
 
 // method for sending a message to the server
-void ChatUDP::sendMessage(std::string userInput) {
-
+void ChatUDP::sendMessage(std::string_view userInput) {
     // parse the user input
-    Command* command = handleUserInput(userInput);
+    CommandPtr command = handleUserInput(userInput);
+    sendCommand(command);
+}
+
+// method for sending a parsed command to the server
+void ChatUDP::sendCommand(CommandPtr& command) {
     if (command == nullptr) return; // invalid user input
 
     // create the message, form the user Command
-    Message* msg = udpFactory->convertCommandToMessage(msgCount, command);
+    MessagePtr msg = udpFactory.convertCommandToMessage(msgCount, command.get());
+
+    // over the rate limit the command waits in the queue (it gets its message ID when it is sent)
+    if (msg != nullptr && throttle(command, wireSize(msg.get()))) return;
 
     // check if the message is good with the FSM
     if (msg == nullptr || !msgTypeValidForStateSent(msg->getType())) {
@@ -94,37 +404,76 @@ void ChatUDP::sendMessage(std::string userInput) {
     }
 
     // send the message
-    transmitMessage(msg);
+    logSentMessage(msg.get());
+    transmitMessage(msg.get());
+}
+
+// method to get the size of the datagram of a message (only if the byte rate needs it)
+std::size_t ChatUDP::wireSize(Message* message) {
+    if (!limiter.countsBytes()) return 0;
+    Pooled<std::string> datagram = takeBuffer();
+    message->appendUDPMsg(*datagram);
+    return datagram->size();
 }
 
 // method for sending a message to the server
 void ChatUDP::transmitMessage(Message* msg) {
 
     MessageType type = msg->getType();
+    bool expectsReply = type == MessageType::AUTH || type == MessageType::JOIN;
     
+    // built once, every retransmission sends the same datagram
+    Pooled<std::string> datagram = takeBuffer();
+    msg->appendUDPMsg(*datagram);
+
+    // until an address confirmed, every attempt goes to the next one (each gets at least one)
+    int attempts = addressChosen ? retransmissions : std::max(retransmissions, static_cast<int>(addresses.size()));
+
     // handle retransmitions
-    for (int attempt = 0; attempt < retransmissions; ++attempt) {
+    for (int attempt = 0; attempt < attempts; ++attempt) {
+        if (attempt > 0 && !addressChosen && addresses.size() > 1 && !useAddress((addressIndex + 1) % addresses.size())) break;
         // send the message
-        backendSendMessage(msg->getUDPMsg());
+        uint64_t sentNs = monotonicNs();
+        if (attempt == 0 && expectsReply) requestSentNs = sentNs;
+        if (attempt > 0) {
+            CounterBlock::add(Counters::local().retransmits);
+            Trace::emit(TraceKind::RETRANSMIT, state, type, msg->getId(), attempt);
+        }
+        backendSendMessage(*datagram);
         
         // wait for a confirmation, oterwise retransmit
         if (waitForConfirmation(msg)) {
+            Trace::emit(TraceKind::CONFIRM, state, type, msg->getId(), attempt);
+            latency.confirmRtt.record(monotonicNs() - sentNs);
+            latency.retransmits.record(attempt);
+            addressChosen = true;
             msgCount++;
             // if we are not expecting a reply, we can return
-            if (type != MessageType::AUTH && type != MessageType::JOIN) return;
+            if (!expectsReply) return;
             // expecting a reply msg, wait for it
             waitForResponseWithTimeout(msg);
             return;
         };
+        Trace::emit(TraceKind::TIMEOUT, state, type, msg->getId(), attempt);
     }
     
+    // none of the cached addresses answered, start over with what the name resolves to now
+    if (!addressChosen && refreshServer()) {
+        if (useAddress(0)) {
+            transmitMessage(msg);
+            return;
+        }
+    }
+
     // no response -> timeout
+    Trace::emit(TraceKind::DROP, state, type, msg->getId(), attempts);
+    latency.retransmits.record(attempts);
     std::cout << "ERROR: connection dropped\n" << std::flush;
-    handleDisconnect(nullptr);
+    connectionLost("no confirmation", nullptr);
 };
 
 // method to handle confirming messages (should be run, after i get a response form the server)
-bool ChatUDP::handleConfirmation(std::string message) {
+bool ChatUDP::handleConfirmation(std::string_view message) {
 
     bool ignore = false;
 
@@ -133,21 +482,18 @@ bool ChatUDP::handleConfirmation(std::string message) {
     // firstly, need to extract the first byte, to determin, what messsage it si
     uint8_t msgType = message[0];
     // get the msgId
-    uint16_t msgID = static_cast<uint16_t>(message[1]) << 8 | static_cast<uint16_t>(message[2]);
+    uint16_t msgID = datagramId(message);
 
     // in case we got a comfirmation message we just return
     if (msgType == 0x00) return false;
 
-    // update last seen mesasge ID
-    if (msgID <= lastShownServerMsgID && confirmedAtLeastOneMessage) {
-        ignore = true;
-    } else {
-        lastShownServerMsgID = msgID;
-        confirmedAtLeastOneMessage = true;
-    }
+    // update last seen mesasge ID (pipelined, the network thread did and confirmed it)
+    if (!pipeline) ignore = isDuplicate(msgID);
 
     // create a confirm message and send it to the server
-    MessageConfirm* msg = new MessageConfirm(msgID);
+    MessageConfirm confirm(msgID);
+    Pooled<std::string> datagram = takeBuffer();
+    confirm.appendUDPMsg(*datagram);
 
     // bye message or err msg, this mean we need to wait up to n times for a retransmit, each time send a confirm
     if (msgType == 0xFF || msgType == 0xFE) {
@@ -156,7 +502,8 @@ bool ChatUDP::handleConfirmation(std::string message) {
             // got a bye message, need to disconnect
             std::cout << "ERROR: server disconnected\n" << std::flush;
         } else {
-            MessageError* errMsg = dynamic_cast<MessageError*>(udpFactory->readResponse(message));
+            MessagePtr parsed = udpFactory.readResponse(message);
+            MessageError* errMsg = dynamic_cast<MessageError*>(parsed.get());
             std::cout << "ERROR FROM " << errMsg->getDisplayName() << ": " << errMsg->getContent() << std::endl << std::flush;
         }
 
@@ -165,16 +512,19 @@ bool ChatUDP::handleConfirmation(std::string message) {
         for (int attempt = 0; attempt < retransmissions; ++attempt) {
             timeout = this->timeout;
             // send the confirm
-            backendSendMessage(msg->getUDPMsg());
+            if (!pipeline) backendSendMessage(*datagram);
             // wait for a response
-            std::string serverResponse = waitForResponse(&timeout);
+            std::string_view serverResponse = waitForResponse(&timeout);
             if (serverResponse.empty()) break; // no new message sent, break the loop
         }
       
         destruct();
         exit(0);
     }
-    backendSendMessage(msg->getUDPMsg());
+    if (!pipeline) {
+        backendSendMessage(*datagram);
+        recordSinceArrival(latency.rxToConfirm, arrivalNs);
+    }
 
     // if we got a ping message, we dont need futher action
     return msgType == 0xFD ? false : !ignore;
@@ -190,19 +540,20 @@ bool ChatUDP::waitForConfirmation(Message* msg) {
     // if there is time left
     while (timeLeft > 0) {
         // get a response
-        std::string responseOut = waitForResponse(&timeLeft);
+        std::string_view responseOut = waitForResponse(&timeLeft);
 
         // not tome left -> timeout
         if (responseOut.empty() && timeLeft <= 0) {
             return false;
         }
+        if (responseOut.empty()) continue; // woken, but the datagram was already taken
 
         // parse the message
-        Message* message = parseResponse(responseOut);
+        MessagePtr message = parseResponse(responseOut);
 
         // messages other than confirm/ping need to be handled
         if (handleConfirmation(responseOut)) {
-            handleIncommingMessage(message);
+            handleIncommingMessage(message.get());
             continue;
         }
 
@@ -228,58 +579,62 @@ void ChatUDP::waitForResponseWithTimeout(Message* msg) {
     while (timeLeft > 0) {
 
         // read form server
-        std::string responseOut = waitForResponse(&timeLeft);
+        std::string_view responseOut = waitForResponse(&timeLeft);
 
         // ping and confirmation are handled here
         if (!handleConfirmation(responseOut)) continue; 
 
         // timeout
         if (responseOut.empty() && timeLeft <= 0) {
+            Trace::emit(TraceKind::TIMEOUT, state, msg->getType(), msgID, 0);
             std::cout << "ERROR: timeout on message recv\n" << std::flush;
-            handleDisconnect(new MessageError(msgCount, client.displayName, "timeout on message recv"));
+            connectionLost("timeout on message recv", messages.make<MessageError>(msgCount, client.displayName, "timeout on message recv"));
         }
+        if (responseOut.empty()) continue; // woken, but the datagram was already taken
 
         // parse response
-        Message* message = parseResponse(responseOut);
+        MessagePtr message = parseResponse(responseOut);
 
         // not a valid response
         if (message == nullptr) {
             std::cout << "ERROR: invalid message/malformed message\n" << std::flush;
-            handleDisconnect(new MessageError(msgCount, client.displayName, "invalid message/malformed message received"));
+            handleDisconnect(messages.make<MessageError>(msgCount, client.displayName, "invalid message/malformed message received"));
         }
         
         MessageType type = message->getType();
         
         // not a reply message, need to handle it
         if (type != MessageType::pREPLY && type != MessageType::nREPLY) {
-            handleIncommingMessage(message);
+            handleIncommingMessage(message.get());
             continue;
         }
             
-        MessageReply* rplyMsg = dynamic_cast<MessageReply*>(message);
+        MessageReply* rplyMsg = dynamic_cast<MessageReply*>(message.get());
         // bad reply 
         if (msgID != rplyMsg->getRefMsgID()) continue;
         
         // need to call the msgTypeValid for advancing the FSM
         if (!msgTypeValidForStateReceived(type)) {
             std::cout << "ERROR: invalid message type, expected REPLY but got MESSAGE\n" << std::flush;
-            handleDisconnect(new MessageError(msgCount, client.displayName, "invalid message type received for curretn state"));
+            handleDisconnect(messages.make<MessageError>(msgCount, client.displayName, "invalid message type received for curretn state"));
         }
 
         // Repaly
-        printStatusMessage(message);
+        printStatusMessage(message.get());
+        if (msg->getType() == MessageType::AUTH && state == FSMState::OPEN) connectServer();
         return;
     }
 
+    Trace::emit(TraceKind::DROP, state, msg->getType(), msgID, 0);
     std::cout << "ERROR: connection to server dropped\n" << std::flush;
-    handleDisconnect(nullptr);
+    connectionLost("no reply", nullptr);
 };
 
 // method for handling incoming messages
 void ChatUDP::handleIncommingMessage(Message* message) {
     if (message == nullptr) {
         std::cout << "ERROR: invalid message/malformed message\n" << std::flush;
-        handleDisconnect(new MessageError(msgCount, client.displayName, "invalid message/malformed message"));
+        handleDisconnect(messages.make<MessageError>(msgCount, client.displayName, "invalid message/malformed message"));
     };
 
     // second, check if the response is allowed
@@ -291,7 +646,7 @@ void ChatUDP::handleIncommingMessage(Message* message) {
             errMsg = "Invalid message, expected MESSAGE but got REPLY";
         }
         std::cout << "ERROR: " << errMsg << std::endl << std::flush;
-        handleDisconnect(new MessageError(msgCount, client.displayName, "Message did not conform to the FSM"));
+        handleDisconnect(messages.make<MessageError>(msgCount, client.displayName, "Message did not conform to the FSM"));
     }
 
     // user Message
@@ -302,10 +657,11 @@ void ChatUDP::handleIncommingMessage(Message* message) {
 }
 
 // send the bye message and closes stuff
-void ChatUDP::handleDisconnect(Message* exitMsg) {
+void ChatUDP::handleDisconnect(MessagePtr exitMsg) {
+    closing = true; // an unconfirmed BYE must not reconnect
 
     // need to wait for a possible retransmit ...
-    if (exitMsg != nullptr) transmitMessage(exitMsg);
+    if (exitMsg != nullptr) transmitMessage(exitMsg.get());
 
     // close the socket
     destruct();
@@ -315,48 +671,83 @@ void ChatUDP::handleDisconnect(Message* exitMsg) {
 };
 
 // simple send message to the server
-void ChatUDP::backendSendMessage(std::string message) {
-    ssize_t bytes_sent = sendto(
-        sockfd,
-        message.c_str(),
-        message.size(),
-        0,
-        (struct sockaddr*)&receiver,
-        sizeof(receiver)
-    );
+void ChatUDP::backendSendMessage(std::string_view message) {
+    if (offline) return; // replaying a capture, the server is not there
+
+    // connected, the kernel knows where it goes
+    ssize_t bytes_sent = connected.load(std::memory_order_relaxed)
+        ? send(sockfd, message.data(), message.size(), 0)
+        : sendto(sockfd, message.data(), message.size(), 0, (struct sockaddr*)&receiver, Resolver::length(receiver));
+
+    // the ICMP error of an earlier datagram, this one is retransmitted if it is lost too
+    if (bytes_sent < 0 && errno == ECONNREFUSED) return;
 
     if (bytes_sent < 0) {
         perror("sendto");
         std::cout << "Error: failed to send a udp message\n" << std::flush;
-        exit(1);
+        connectionLost(strerror(errno), nullptr);
+        return;
+    }
+    Capture::record(true, message.data(), bytes_sent);
+
+    MessageType type = UDPMessages::peekType(message);
+    Counters::local().frameOut(type, bytes_sent);
+    Trace::emit(TraceKind::SEND, state, type, datagramId(message), bytes_sent);
+
+    // first datagram caused by a stdin line
+    if (inputStartNs != 0) {
+        latency.inputToWire.record(monotonicNs() - inputStartNs);
+        inputStartNs = 0;
     }
 }
 
 // method for receiving server response 
-std::string ChatUDP::backendGetServerResponse() {
-    socklen_t sender_len = sizeof(sender_addr);
+std::string_view ChatUDP::backendGetServerResponse() {
+    return receive();
+}
 
-    // Clear the buffer first
-    memset(this->buffer, 0, BUFFER_SIZE);
+// method for receiving a datagram into the receive buffer
+std::string_view ChatUDP::receive() {
+    const char* data = buffer.get();
+    int bytes_received;
+
+    // pipelined, the network thread already received (and confirmed) it
+    if (pipeline) {
+        Datagram* slot = takeDatagram();
+        if (slot == nullptr) return {};
+        sender_addr = slot->from;
+        arrivalNs = slot->arrivalNs;
+        if (arrivalNs != 0 && slot->confirmedNs >= arrivalNs) latency.rxToConfirm.record(slot->confirmedNs - arrivalNs);
+        data = slot->data.data();
+        bytes_received = slot->error != 0 ? -1 : static_cast<int>(slot->data.size());
+        errno = slot->error;
+    } else {
+        bytes_received = SocketOptions::receive(sockfd, buffer.get(), BUFFER_SIZE, &sender_addr, arrivalNs);
+    }
 
-    int bytes_received = recvfrom(
-        sockfd,
-        this->buffer,
-        BUFFER_SIZE - 1,
-        0,
-        (struct sockaddr*)&sender_addr,
-        &sender_len
-    );
+    // an earlier wait already consumed the datagram poll reported (or it was an ICMP error of a connected socket)
+    if (bytes_received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == ECONNREFUSED)) return {};
 
     if (bytes_received < 0) {
         perror("recvfrom");
         std::cout << "ERROR: receiving UDP message\n" << std::flush;
-        handleDisconnect(new MessageError(msgCount, client.displayName, "internal client error"));
+        connectionLost(strerror(errno), messages.make<MessageError>(msgCount, client.displayName, "internal client error"));
+        return {};
     }
 
-    // handle dynmic port switch
-    receiver.sin_port = sender_addr.sin_port; 
-    
-    return std::string(this->buffer, bytes_received);
+    Capture::record(false, data, bytes_received);
+
+    // handle dynmic port switch (a connected socket only gets datagrams of the session port)
+    if (!connected.load(std::memory_order_relaxed)) Resolver::setPort(receiver, Resolver::port(sender_addr));
+
+    std::string_view response(data, bytes_received);
+    CounterBlock& counters = Counters::local();
+    CounterBlock::add(counters.rawBytesIn, bytes_received);
+    MessageType type = UDPMessages::peekType(response);
+    counters.frameIn(type, bytes_received);
+    Trace::emit(TraceKind::RECV, state, type, datagramId(response), bytes_received);
+    return response;
 }
 
+// the core instantiated for this transport
+template class Chat<ChatUDP>;
@@ -9,21 +9,28 @@
 #include <string>
 #include <regex>
 #include <stdexcept>
+#include <typeinfo>
 #include "command.hpp"
 
 // factory method to creating a command form user input
-Command* Command::createCommand(std::string userInput) {
+CommandPtr Command::createCommand(std::string_view userInput, Pool<CommandMessage>* pool) {
     // check if the userInput is empty
     if (userInput.empty()) return nullptr;
 
     try {
         // Check if the userInput starts with a '/'
-        if (userInput.find("/") == 0) {
+        if (userInput.front() == '/') {
             // Match specific commands
-            if (userInput.find("/auth") == 0) return new CommandAuth(userInput);
-            if (userInput.find("/join") == 0) return new CommandJoin(userInput);
-            if (userInput.find("/rename") == 0) return new CommandRename(userInput);
-            if (userInput.find("/help") == 0) {
+            std::string command(userInput);
+            if (command.find("/auth") == 0) return CommandPtr(new CommandAuth(command));
+            if (command.find("/join") == 0) return CommandPtr(new CommandJoin(command));
+            if (command.find("/rename") == 0) return CommandPtr(new CommandRename(command));
+            if (command.find("/latency") == 0) return CommandPtr(new CommandLatency(command));
+            if (command.find("/stats") == 0) return CommandPtr(new CommandStats(command));
+            if (command.find("/search") == 0) return CommandPtr(new CommandSearch(command));
+            if (command.find("/scrollback") == 0) return CommandPtr(new CommandScrollback(command));
+            if (command.find("/sendfile") == 0) return CommandPtr(new CommandSendFile(command));
+            if (command.find("/help") == 0) {
                 printHelp();
                 return nullptr;
             }
@@ -37,7 +44,20 @@ Command* Command::createCommand(std::string userInput) {
         return nullptr;
     }
     // If the input does not start with '/', treat it as a message
-    return new CommandMessage(userInput);
+    return createMessage(userInput, pool);
+}
+
+// Method to create a message command
+CommandPtr Command::createMessage(std::string_view content, Pool<CommandMessage>* pool) {
+    CommandMessage* message = pool != nullptr ? pool->take() : new CommandMessage();
+    message->assign(content);
+    return CommandPtr(message, CommandReturn{pool});
+}
+
+// Method to give a message command back to its pool
+void CommandReturn::operator()(Command* command) const {
+    if (pool != nullptr && typeid(*command) == typeid(CommandMessage)) pool->give(static_cast<CommandMessage*>(command));
+    else delete command;
 }
 
 // help
@@ -48,6 +68,11 @@ void Command::printHelp() const {
     std::cout << "| /auth    | {Username} {Secret} {DisplayName}| Authenticate user with credentials       |\n";
     std::cout << "| /join    | {ChannelID}                      | Join a specific channel                  |\n";
     std::cout << "| /rename  | {DisplayName}                    | Change the display name                  |\n";
+    std::cout << "| /latency |                                  | Display the latency histograms           |\n";
+    std::cout << "| /stats   |                                  | Display the message and byte counters    |\n";
+    std::cout << "| /search  | {Terms} [from:{DisplayName}]     | Search the received messages             |\n";
+    std::cout << "| /scrollback| [Count] [Minutes]              | Display messages from the log            |\n";
+    std::cout << "| /sendfile| {Path} [Messages/s]              | Send the lines of a file as messages     |\n";
     std::cout << "| /help    |                                  | Display the list of available commands   |\n";
     std::cout << "+----------+----------------------------------+------------------------------------------+\n" << std::flush;;
 }
@@ -139,11 +164,11 @@ void CommandRename::represent() {
 }
 
 // constructor for command message
-CommandMessage::CommandMessage(std::string userInput) {
+CommandMessage::CommandMessage(std::string_view userInput) {
     if (userInput.empty()) {
         std::cout <<"ERROR: Empty message.\n" << std::flush;;
     }
-    // Define a regex pattern to match the message command
+    // borrowed, the Message sent copies it
     message = userInput;
 }
 
@@ -151,4 +176,85 @@ CommandMessage::CommandMessage(std::string userInput) {
 void CommandMessage::represent() {
     std::cout << "Command: MESSAGE\n";
     std::cout << "Message: " << message << "\n" << std::flush;;
-}
\ No newline at end of file
+}
+
+// constructor for command latency
+CommandLatency::CommandLatency(std::string userInput) {
+    std::regex pattern(R"(^\s*/latency\s*$)");
+    if (!std::regex_match(userInput, pattern)) {
+        std::cout <<"ERROR: /latency does not take any arguments.\n" << std::flush;
+    }
+}
+
+// represent for debug
+void CommandLatency::represent() {
+    std::cout << "Command: LATENCY\n" << std::flush;
+}
+
+// constructor for command stats
+CommandStats::CommandStats(std::string userInput) {
+    std::regex pattern(R"(^\s*/stats\s*$)");
+    if (!std::regex_match(userInput, pattern)) {
+        std::cout <<"ERROR: /stats does not take any arguments.\n" << std::flush;
+    }
+}
+
+// represent for debug
+void CommandStats::represent() {
+    std::cout << "Command: STATS\n" << std::flush;
+}
+
+// constructor for command search
+CommandSearch::CommandSearch(std::string userInput) {
+    std::regex pattern(R"(^\s*/search\s+(\S.*?)\s*$)");
+    std::smatch matches;
+    if (std::regex_match(userInput, matches, pattern)) {
+        terms = matches[1].str();
+        return;
+    }
+    std::cout <<"ERROR: Invalid format for /search command.\n" << std::flush;
+}
+
+// represent for debug
+void CommandSearch::represent() {
+    std::cout << "Command: SEARCH\n";
+    std::cout << "Terms: " << terms << "\n" << std::flush;
+}
+
+// constructor for command scrollback
+CommandScrollback::CommandScrollback(std::string userInput) {
+    std::regex pattern(R"(^\s*/scrollback(?:\s+(\d{1,9}))?(?:\s+(\d{1,9}))?\s*$)");
+    std::smatch matches;
+    if (std::regex_match(userInput, matches, pattern)) {
+        if (matches[1].matched) count = std::stoul(matches[1].str());
+        if (matches[2].matched) minutes = std::stoi(matches[2].str());
+        return;
+    }
+    throw std::invalid_argument("ERROR: Invalid format for /scrollback command. Expected: /scrollback [count] [minutes]");
+}
+
+// represent for debug
+void CommandScrollback::represent() {
+    std::cout << "Command: SCROLLBACK\n";
+    std::cout << "Count: " << count << "\n";
+    std::cout << "Minutes: " << minutes << "\n" << std::flush;
+}
+
+// constructor for command sendfile
+CommandSendFile::CommandSendFile(std::string userInput) {
+    std::regex pattern(R"(^\s*/sendfile\s+(\S+)(?:\s+(\d{1,9}))?\s*$)");
+    std::smatch matches;
+    if (std::regex_match(userInput, matches, pattern)) {
+        path = matches[1].str();
+        if (matches[2].matched) rate = std::stoi(matches[2].str());
+        return;
+    }
+    throw std::invalid_argument("ERROR: Invalid format for /sendfile command. Expected: /sendfile {path} [messages per second]");
+}
+
+// represent for debug
+void CommandSendFile::represent() {
+    std::cout << "Command: SENDFILE\n";
+    std::cout << "Path: " << path << "\n";
+    std::cout << "Rate: " << rate << "\n" << std::flush;
+}
@@ -0,0 +1,111 @@
+/**
+ * @file counters.cpp
+ * @brief Implementation of the Counters registry
+ * @author Martin Mendl <x247581>
+ * @date 18.4.2025
+*/
+
+#include <mutex>
+#include <vector>
+#include <iomanip>
+#include "counters.hpp"
+
+// registry of every block ever created, blocks outlive their threads so totals are kept
+static std::mutex registryMutex;
+static std::vector<CounterBlock*> registry;
+
+// function to get a printable name of a message type
+static const char* typeName(std::size_t type) {
+    static const char* names[MESSAGE_TYPES] = {
+        "AUTH", "BYE", "CONFIRM", "ERR", "JOIN", "MSG", "PING", "REPLY OK", "REPLY NOK", "UNKNOWN"
+    };
+    return names[type];
+}
+
+// Method to get the block of the calling thread
+CounterBlock& Counters::local() {
+    thread_local CounterBlock* block = nullptr;
+    if (block == nullptr) {
+        block = new CounterBlock();
+        std::lock_guard<std::mutex> lock(registryMutex);
+        registry.push_back(block);
+    }
+    return *block;
+}
+
+// Method to print the totals
+void Counters::print(std::ostream& out) {
+    uint64_t framesIn[MESSAGE_TYPES] = {}, bytesIn[MESSAGE_TYPES] = {};
+    uint64_t framesOut[MESSAGE_TYPES] = {}, bytesOut[MESSAGE_TYPES] = {};
+    uint64_t rawBytesIn = 0, retransmits = 0, duplicates = 0, rejectedSent = 0, rejectedReceived = 0;
+    uint64_t parseFailures = 0, queueDepth = 0, queueDepthMax = 0, reconnects = 0, poolMisses = 0;
+    uint64_t names = 0, nameOverflows = 0, framesDrawn = 0, linesSkipped = 0;
+    uint64_t displayDropped = 0, displaySuppressed = 0, pipelineStalls = 0;
+    uint64_t confirmBatches = 0, groReceives = 0, zeroCopySends = 0, zeroCopyCopied = 0, throttled = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (CounterBlock* block : registry) {
+            for (std::size_t i = 0; i < MESSAGE_TYPES; ++i) {
+                framesIn[i] += block->framesIn[i].load(std::memory_order_relaxed);
+                bytesIn[i] += block->bytesIn[i].load(std::memory_order_relaxed);
+                framesOut[i] += block->framesOut[i].load(std::memory_order_relaxed);
+                bytesOut[i] += block->bytesOut[i].load(std::memory_order_relaxed);
+            }
+            rawBytesIn += block->rawBytesIn.load(std::memory_order_relaxed);
+            retransmits += block->retransmits.load(std::memory_order_relaxed);
+            duplicates += block->duplicates.load(std::memory_order_relaxed);
+            rejectedSent += block->fsmRejectedSent.load(std::memory_order_relaxed);
+            rejectedReceived += block->fsmRejectedReceived.load(std::memory_order_relaxed);
+            parseFailures += block->parseFailures.load(std::memory_order_relaxed);
+            queueDepth += block->queueDepth.load(std::memory_order_relaxed);
+            reconnects += block->reconnects.load(std::memory_order_relaxed);
+            poolMisses += block->poolMisses.load(std::memory_order_relaxed);
+            names += block->names.load(std::memory_order_relaxed);
+            nameOverflows += block->nameOverflows.load(std::memory_order_relaxed);
+            framesDrawn += block->framesDrawn.load(std::memory_order_relaxed);
+            linesSkipped += block->linesSkipped.load(std::memory_order_relaxed);
+            displayDropped += block->displayDropped.load(std::memory_order_relaxed);
+            displaySuppressed += block->displaySuppressed.load(std::memory_order_relaxed);
+            pipelineStalls += block->pipelineStalls.load(std::memory_order_relaxed);
+            confirmBatches += block->confirmBatches.load(std::memory_order_relaxed);
+            groReceives += block->groReceives.load(std::memory_order_relaxed);
+            zeroCopySends += block->zeroCopySends.load(std::memory_order_relaxed);
+            zeroCopyCopied += block->zeroCopyCopied.load(std::memory_order_relaxed);
+            throttled += block->throttled.load(std::memory_order_relaxed);
+            queueDepthMax = std::max(queueDepthMax, block->queueDepthMax.load(std::memory_order_relaxed));
+        }
+    }
+
+    out << std::left << std::setw(10) << "type" << std::right
+        << std::setw(12) << "frames-in" << std::setw(14) << "bytes-in"
+        << std::setw(12) << "frames-out" << std::setw(14) << "bytes-out" << "\n";
+    for (std::size_t i = 0; i < MESSAGE_TYPES; ++i) {
+        if (framesIn[i] == 0 && framesOut[i] == 0) continue;
+        out << std::left << std::setw(10) << typeName(i) << std::right
+            << std::setw(12) << framesIn[i] << std::setw(14) << bytesIn[i]
+            << std::setw(12) << framesOut[i] << std::setw(14) << bytesOut[i] << "\n";
+    }
+    out << "socket-bytes-in=" << rawBytesIn
+        << " retransmits=" << retransmits
+        << " duplicates-dropped=" << duplicates
+        << " fsm-rejected-sent=" << rejectedSent
+        << " fsm-rejected-received=" << rejectedReceived
+        << " parse-failures=" << parseFailures
+        << " queue-depth=" << queueDepth
+        << " queue-depth-max=" << queueDepthMax
+        << " reconnects=" << reconnects
+        << " pool-misses=" << poolMisses
+        << " names=" << names
+        << " name-overflows=" << nameOverflows
+        << " frames-drawn=" << framesDrawn
+        << " lines-skipped=" << linesSkipped
+        << " display-dropped=" << displayDropped
+        << " display-suppressed=" << displaySuppressed
+        << " pipeline-stalls=" << pipelineStalls
+        << " confirm-batches=" << confirmBatches
+        << " gro-receives=" << groReceives
+        << " zerocopy-sends=" << zeroCopySends
+        << " zerocopy-copied=" << zeroCopyCopied
+        << " throttled=" << throttled << "\n" << std::flush;
+}
@@ -0,0 +1,276 @@
+/**
+ * @file history.cpp
+ * @brief Implementation of the History class
+ * @author Martin Mendl <x247581>
+ * @date 18.4.2025
+*/
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdint>
+#include <chrono>
+#include <iomanip>
+#include "history.hpp"
+#include "latency.hpp"
+
+// rough per-object overheads used by the memory estimate
+#define ENTRY_OVERHEAD (sizeof(HistoryEntry) + 16)
+#define KEY_OVERHEAD (sizeof(std::vector<uint32_t>) + 48)
+
+// function to get the table of word bytes (letters, digits and non-ASCII), lowercased, 0 for separators
+static const std::array<char, 256>& wordBytes() {
+    static const std::array<char, 256> table = [] {
+        std::array<char, 256> bytes{};
+        for (int byte = 0; byte < 256; ++byte) {
+            if (std::isalnum(byte) || byte >= 0x80) bytes[byte] = static_cast<char>(std::tolower(byte));
+        }
+        return bytes;
+    }();
+    return table;
+}
+
+// function to split a text into lowercase words (runs of letters, digits and non-ASCII bytes)
+static std::vector<std::string> tokenize(std::string_view text) {
+    const std::array<char, 256>& bytes = wordBytes();
+    std::vector<std::string> tokens;
+    std::size_t pos = 0, size = text.size();
+    while (pos < size) {
+        // skip the separators, then find the end of the word
+        while (pos < size && bytes[static_cast<unsigned char>(text[pos])] == 0) pos++;
+        std::size_t start = pos;
+        while (pos < size && bytes[static_cast<unsigned char>(text[pos])] != 0) pos++;
+
+        // words over HISTORY_MAX_WORD are skipped, not built
+        if (pos == start || pos - start > HISTORY_MAX_WORD) continue;
+        std::string token(pos - start, '\0');
+        for (std::size_t i = start; i < pos; ++i) token[i - start] = bytes[static_cast<unsigned char>(text[i])];
+        tokens.push_back(std::move(token));
+    }
+    return tokens;
+}
+
+// function to get the index key of a sender
+static std::string senderKey(std::string_view sender) {
+    std::string key = "@";
+    for (char c : sender) key += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return key;
+}
+
+// function to estimate the memory of a stored message (an interned sender is shared)
+static std::size_t entryBytes(const HistoryEntry& entry) {
+    return ENTRY_OVERHEAD + (entry.sender.get().getId() != 0 ? 0 : entry.sender.view().size()) + entry.content.size();
+}
+
+// Method to change the budget
+void History::setBudget(std::size_t bytes) {
+    budget = bytes;
+    evict("");
+}
+
+// Method to store a message
+void History::append(const std::string& channelName, const Name& sender, const std::string& content) {
+    auto found = channels.find(channelName);
+    if (found == channels.end()) {
+        found = channels.emplace(channelName, HistoryChannel()).first;
+        lru.push_front(channelName);
+        found->second.lru = lru.begin();
+    }
+    HistoryChannel& channel = found->second;
+    touch(channel);
+
+    uint64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    channel.messages.emplace_back();
+    HistoryEntry& entry = channel.messages.back();
+    entry.timeNs = now;
+    entry.sender.assign(sender);
+    entry.content = content;
+
+    std::size_t bytes = entryBytes(entry);
+    channel.bytes += bytes;
+    used += bytes;
+    stored++;
+    unindexed++;
+
+    if (used > budget) evict(channelName);
+}
+
+// Method to index a single message
+void History::indexMessage(HistoryChannel& channel, uint32_t seq) {
+    const HistoryEntry& entry = channel.messages[seq - channel.firstSeq];
+
+    std::vector<std::string> keys = tokenize(entry.content);
+    std::vector<std::string> senderTokens = tokenize(entry.sender.view());
+    keys.insert(keys.end(), senderTokens.begin(), senderTokens.end());
+    keys.push_back(senderKey(entry.sender.view()));
+
+    for (const std::string& key : keys) {
+        auto [posting, inserted] = channel.index.try_emplace(key);
+        std::size_t bytes = inserted ? KEY_OVERHEAD + key.size() : 0;
+        // a word repeated in one message is posted once
+        if (posting->second.empty() || posting->second.back() != seq) {
+            posting->second.push_back(seq);
+            bytes += sizeof(uint32_t);
+        }
+        channel.bytes += bytes;
+        used += bytes;
+    }
+}
+
+// Method to index pending messages
+void History::indexSome(std::size_t limit) {
+    for (auto& [name, channel] : channels) {
+        while (limit > 0 && channel.indexedSeq < channel.endSeq()) {
+            indexMessage(channel, channel.indexedSeq++);
+            unindexed--;
+            limit--;
+        }
+        if (limit == 0) break;
+    }
+    if (used > budget) evict("");
+}
+
+// Method to move a channel to the front of the LRU list
+void History::touch(HistoryChannel& channel) {
+    lru.splice(lru.begin(), lru, channel.lru);
+}
+
+// Method to drop the oldest messages of a channel
+void History::dropOldest(HistoryChannel& channel, std::size_t count) {
+    count = std::min(count, channel.messages.size());
+    for (std::size_t i = 0; i < count; ++i) {
+        const HistoryEntry& entry = channel.messages.front();
+        std::size_t bytes = entryBytes(entry);
+        channel.bytes -= bytes;
+        used -= bytes;
+        channel.messages.pop_front();
+        channel.firstSeq++;
+    }
+    stored -= count;
+
+    // dropped before the indexer got to them
+    if (channel.indexedSeq < channel.firstSeq) {
+        unindexed -= channel.firstSeq - channel.indexedSeq;
+        channel.indexedSeq = channel.firstSeq;
+    }
+
+    // postings are ascending, the dropped ones are a prefix
+    for (auto it = channel.index.begin(); it != channel.index.end();) {
+        std::vector<uint32_t>& posting = it->second;
+        auto keep = std::lower_bound(posting.begin(), posting.end(), channel.firstSeq);
+        std::size_t bytes = (keep - posting.begin()) * sizeof(uint32_t);
+        posting.erase(posting.begin(), keep);
+        if (posting.empty()) {
+            bytes += KEY_OVERHEAD + it->first.size();
+            it = channel.index.erase(it);
+        } else {
+            ++it;
+        }
+        channel.bytes -= bytes;
+        used -= bytes;
+    }
+}
+
+// Method to evict until the budget is met
+void History::evict(const std::string& keep) {
+    while (used > budget && !lru.empty()) {
+        const std::string& victim = lru.back();
+
+        // the last channel left (or the one being written to) loses its oldest eighth
+        if (lru.size() == 1 || victim == keep) {
+            HistoryChannel& channel = channels[victim];
+            if (channel.messages.empty()) break;
+            dropOldest(channel, std::max<std::size_t>(1, channel.messages.size() / 8));
+            continue;
+        }
+
+        HistoryChannel& channel = channels[victim];
+        used -= channel.bytes;
+        stored -= channel.messages.size();
+        unindexed -= channel.endSeq() - channel.indexedSeq;
+        channels.erase(victim);
+        lru.pop_back();
+    }
+}
+
+// Method to search the history
+void History::search(const std::string& terms, std::ostream& out) {
+    uint64_t start = monotonicNs();
+
+    // the index has to be complete before it is queried
+    while (pending()) indexSome(SIZE_MAX);
+
+    // "from:name" only matches the sender, other words are tokenized like the content
+    std::vector<std::string> keys;
+    std::string word;
+    std::size_t pos = 0;
+    while (pos < terms.size()) {
+        std::size_t end = terms.find_first_of(" \t", pos);
+        if (end == std::string::npos) end = terms.size();
+        word = terms.substr(pos, end - pos);
+        pos = end + 1;
+        if (word.empty()) continue;
+        if (word.rfind("from:", 0) == 0 && word.size() > 5) {
+            keys.push_back(senderKey(word.substr(5)));
+            continue;
+        }
+        std::vector<std::string> tokens = tokenize(word);
+        keys.insert(keys.end(), tokens.begin(), tokens.end());
+    }
+    if (keys.empty()) {
+        out << "ERROR: nothing to search for\n" << std::flush;
+        return;
+    }
+
+    struct Hit {
+        uint64_t timeNs;
+        const std::string* channel;
+        const HistoryEntry* entry;
+    };
+    std::vector<Hit> hits;
+    std::size_t matches = 0;
+
+    for (auto& [name, channel] : channels) {
+        // every key has to be present, the shortest posting list drives the intersection
+        std::vector<const std::vector<uint32_t>*> postings;
+        for (const std::string& key : keys) {
+            auto found = channel.index.find(key);
+            if (found == channel.index.end()) break;
+            postings.push_back(&found->second);
+        }
+        if (postings.size() != keys.size()) continue;
+        std::sort(postings.begin(), postings.end(), [](auto a, auto b) { return a->size() < b->size(); });
+
+        bool hit = false;
+        const std::vector<uint32_t>& driver = *postings.front();
+        // newest first, only the newest HISTORY_MAX_RESULTS per channel are kept
+        std::size_t kept = 0;
+        for (auto seq = driver.rbegin(); seq != driver.rend(); ++seq) {
+            bool all = true;
+            for (std::size_t i = 1; i < postings.size() && all; ++i) {
+                all = std::binary_search(postings[i]->begin(), postings[i]->end(), *seq);
+            }
+            if (!all) continue;
+            matches++;
+            hit = true;
+            if (kept++ < HISTORY_MAX_RESULTS) {
+                const HistoryEntry& entry = channel.messages[*seq - channel.firstSeq];
+                hits.push_back(Hit{entry.timeNs, &name, &entry});
+            }
+        }
+        if (hit) touch(channel);
+    }
+
+    // newest results overall, printed oldest to newest like a chat
+    std::sort(hits.begin(), hits.end(), [](const Hit& a, const Hit& b) { return a.timeNs > b.timeNs; });
+    if (hits.size() > HISTORY_MAX_RESULTS) hits.resize(HISTORY_MAX_RESULTS);
+    for (auto hit = hits.rbegin(); hit != hits.rend(); ++hit) {
+        out << "[" << *hit->channel << "] " << hit->entry->sender.view() << ": " << hit->entry->content << "\n";
+    }
+
+    double elapsedMs = (monotonicNs() - start) / 1e6;
+    out << matches << " match(es) in " << stored << " stored message(s), showing " << hits.size()
+        << " (" << std::fixed << std::setprecision(3) << elapsedMs << " ms)\n" << std::flush;
+    out.unsetf(std::ios::fixed);
+}
@@ -0,0 +1,116 @@
+/**
+ * @file latency.cpp
+ * @brief Implementation of the LatencyHistogram class
+ * @author Martin Mendl <x247581>
+ * @date 18.4.2025
+*/
+
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include "latency.hpp"
+
+#define SUB_COUNT (1u << HISTOGRAM_SUB_BITS)
+#define HALF_SUB_COUNT (SUB_COUNT >> 1)
+
+// function to get the monotonic time in nanoseconds
+uint64_t monotonicNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// function to get the wall clock time in nanoseconds
+uint64_t realtimeNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Constructor
+LatencyHistogram::LatencyHistogram(const char* name, bool isTime) : name(name), isTime(isTime) {
+    memset(counts, 0, sizeof(counts));
+}
+
+/*
+Values below SUB_COUNT get a counter each. Above that, every power of two
+is split into HALF_SUB_COUNT linear buckets, the shift (exponent) selects
+the group and the top bits of the value select the bucket inside it.
+*/
+unsigned LatencyHistogram::indexOf(uint64_t value) {
+    if (value < SUB_COUNT) return static_cast<unsigned>(value);
+    unsigned msb = 63 - __builtin_clzll(value);
+    unsigned shift = msb - HISTOGRAM_SUB_BITS + 1;
+    return (shift << (HISTOGRAM_SUB_BITS - 1)) + static_cast<unsigned>(value >> shift);
+}
+
+// Method to get the highest value of a counter (inverse of indexOf)
+uint64_t LatencyHistogram::highestOf(unsigned index) {
+    if (index < SUB_COUNT) return index;
+    unsigned shift = (index >> (HISTOGRAM_SUB_BITS - 1)) - 1;
+    uint64_t mantissa = index - (static_cast<uint64_t>(shift) << (HISTOGRAM_SUB_BITS - 1));
+    return ((mantissa + 1) << shift) - 1;
+}
+
+// Method to record a value
+void LatencyHistogram::record(uint64_t value) {
+    counts[indexOf(value)]++;
+    count++;
+    sum += value;
+    if (value < min) min = value;
+    if (value > max) max = value;
+}
+
+// Method to get a percentile
+uint64_t LatencyHistogram::percentile(double percentile) const {
+    if (count == 0) return 0;
+
+    uint64_t target = static_cast<uint64_t>(percentile / 100.0 * count + 0.5);
+    if (target == 0) target = 1;
+
+    uint64_t seen = 0;
+    for (unsigned i = 0; i < HISTOGRAM_SLOTS; ++i) {
+        seen += counts[i];
+        if (seen >= target) return std::min(highestOf(i), max);
+    }
+    return max;
+}
+
+// Method to clear the histogram
+void LatencyHistogram::reset() {
+    memset(counts, 0, sizeof(counts));
+    count = 0;
+    sum = 0;
+    min = UINT64_MAX;
+    max = 0;
+}
+
+// Method to print the histogram summary
+void LatencyHistogram::print(std::ostream& out) const {
+    // time values are kept in nanoseconds, microseconds are easier to read
+    double scale = isTime ? 1000.0 : 1.0;
+    const char* unit = isTime ? "us" : "";
+
+    out << std::left << std::setw(14) << name << std::right
+        << " count=" << count << std::fixed << std::setprecision(1)
+        << " min=" << getMin() / scale << unit
+        << " mean=" << getMean() / scale << unit
+        << " p50=" << percentile(50.0) / scale << unit
+        << " p90=" << percentile(90.0) / scale << unit
+        << " p99=" << percentile(99.0) / scale << unit
+        << " p99.9=" << percentile(99.9) / scale << unit
+        << " max=" << getMax() / scale << unit << "\n";
+    out.unsetf(std::ios::fixed);
+}
+
+// Method to print all non-empty histograms
+void LatencyStats::print(std::ostream& out) const {
+    const LatencyHistogram* all[] = {&confirmRtt, &replyLatency, &retransmits, &inputToWire, &recovery, &firstAuth,
+                                     &rxToParse, &rxToConfirm, &rxToDisplay, &rateLimit};
+    bool any = false;
+    for (const LatencyHistogram* histogram : all) {
+        if (histogram->getCount() == 0) continue;
+        histogram->print(out);
+        any = true;
+    }
+    if (!any) out << "no latency samples recorded yet\n";
+    out << std::flush;
+}
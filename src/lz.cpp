@@ -0,0 +1,212 @@
+/**
+ * @file lz.cpp
+ * @brief Implementation of the LZ class
+ * @author Martin Mendl <x247581>
+ * @date 18.4.2025
+*/
+
+#include <cstdint>
+#include <cstring>
+#include "lz.hpp"
+
+#define MIN_MATCH 4
+#define MAX_OFFSET 65535
+#define HASH_LOG 14
+// the last bytes of a block are always literals (the final sequence has no match)
+#define LAST_LITERALS 5
+#define MATCH_LIMIT 12
+
+// function to load 4 bytes
+static inline uint32_t read32(const uint8_t* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+// function to load 8 bytes
+static inline uint64_t read64(const uint8_t* p) {
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+// function to hash 4 bytes into the match table
+static inline uint32_t hash(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - HASH_LOG);
+}
+
+// function to write a length continuation (runs of 255)
+static inline uint8_t* writeLength(uint8_t* op, std::size_t length) {
+    while (length >= 255) {
+        *op++ = 255;
+        length -= 255;
+    }
+    *op++ = static_cast<uint8_t>(length);
+    return op;
+}
+
+// function to write a sequence, match length 0 means literals only
+static uint8_t* writeSequence(uint8_t* op, const uint8_t* literals, std::size_t literalLength, uint16_t offset, std::size_t matchLength) {
+    uint8_t* token = op++;
+    std::size_t extraMatch = matchLength ? matchLength - MIN_MATCH : 0;
+
+    *token = static_cast<uint8_t>((literalLength >= 15 ? 15 : literalLength) << 4);
+    if (literalLength >= 15) op = writeLength(op, literalLength - 15);
+    if (literalLength > 0) memcpy(op, literals, literalLength);
+    op += literalLength;
+    if (matchLength == 0) return op;
+
+    *op++ = static_cast<uint8_t>(offset);
+    *op++ = static_cast<uint8_t>(offset >> 8);
+    *token |= static_cast<uint8_t>(extraMatch >= 15 ? 15 : extraMatch);
+    if (extraMatch >= 15) op = writeLength(op, extraMatch - 15);
+    return op;
+}
+
+// Method to compress a block
+std::size_t LZ::compress(const char* source, std::size_t length, char* destination) {
+    const uint8_t* src = reinterpret_cast<const uint8_t*>(source);
+    uint8_t* op = reinterpret_cast<uint8_t*>(destination);
+    const uint8_t* anchor = src;
+    const uint8_t* end = src + length;
+
+    if (length >= MATCH_LIMIT) {
+        uint32_t table[1 << HASH_LOG] = {};
+        const uint8_t* matchLimit = end - LAST_LITERALS;
+        const uint8_t* ip = src + 1;
+
+        while (ip + MIN_MATCH <= matchLimit) {
+            uint32_t sequence = read32(ip);
+            uint32_t slot = hash(sequence);
+            const uint8_t* ref = src + table[slot];
+            table[slot] = static_cast<uint32_t>(ip - src);
+
+            if (ref >= ip || ip - ref > MAX_OFFSET || read32(ref) != sequence) {
+                // the longer nothing matches, the bigger the steps (incompressible data stays fast)
+                ip += 1 + ((ip - anchor) >> 6);
+                continue;
+            }
+
+            // extend the match forwards, 8 bytes at a time
+            const uint8_t* scan = ip + MIN_MATCH;
+            const uint8_t* match = ref + MIN_MATCH;
+            while (scan + 8 <= matchLimit) {
+                uint64_t diff = read64(scan) ^ read64(match);
+                if (diff) {
+                    scan += __builtin_ctzll(diff) >> 3;
+                    goto extended;
+                }
+                scan += 8;
+                match += 8;
+            }
+            while (scan < matchLimit && *scan == *match) {
+                scan++;
+                match++;
+            }
+        extended:
+            // and backwards into the pending literals
+            while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+                ip--;
+                ref--;
+            }
+
+            op = writeSequence(op, anchor, ip - anchor, static_cast<uint16_t>(ip - ref), scan - ip);
+            ip = scan;
+            anchor = ip;
+            // position before the next search, so repeats right after a match are found
+            if (ip - 2 > src) table[hash(read32(ip - 2))] = static_cast<uint32_t>(ip - 2 - src);
+        }
+    }
+
+    op = writeSequence(op, anchor, end - anchor, 0, 0);
+    return op - reinterpret_cast<uint8_t*>(destination);
+}
+
+// Method to decompress a block
+bool LZ::decompress(const char* source, std::size_t length, char* destination, std::size_t rawLength) {
+    const uint8_t* ip = reinterpret_cast<const uint8_t*>(source);
+    const uint8_t* iend = ip + length;
+    uint8_t* dst = reinterpret_cast<uint8_t*>(destination);
+    uint8_t* op = dst;
+    uint8_t* oend = dst + rawLength;
+
+    while (ip < iend) {
+        uint8_t token = *ip++;
+        std::size_t literalLength = token >> 4;
+        std::size_t matchLength = token & 15;
+        std::size_t offset;
+
+        // short sequence far from both ends (most of a chat log): fixed-size copies, no loops
+        if (literalLength != 15 && iend - ip >= 18 && oend - op >= 32) {
+            memcpy(op, ip, 16);
+            op += literalLength;
+            ip += literalLength;
+            // 18 bytes were left and at most 14 were literals, so this is not the last sequence
+            offset = ip[0] | (ip[1] << 8);
+            ip += 2;
+            if (offset == 0 || offset > static_cast<std::size_t>(op - dst)) return false;
+            if (matchLength != 15 && offset >= 8) {
+                const uint8_t* match = op - offset;
+                memcpy(op, match, 8);
+                memcpy(op + 8, match + 8, 8);
+                memcpy(op + 16, match + 16, 2);
+                op += matchLength + MIN_MATCH;
+                continue;
+            }
+        } else {
+            // literals
+            if (literalLength == 15) {
+                uint8_t byte;
+                do {
+                    if (ip >= iend) return false;
+                    byte = *ip++;
+                    literalLength += byte;
+                } while (byte == 255);
+            }
+            if (literalLength > static_cast<std::size_t>(iend - ip) || literalLength > static_cast<std::size_t>(oend - op)) return false;
+            memcpy(op, ip, literalLength);
+            op += literalLength;
+            ip += literalLength;
+            if (ip == iend) break; // last sequence
+
+            if (iend - ip < 2) return false;
+            offset = ip[0] | (ip[1] << 8);
+            ip += 2;
+            if (offset == 0 || offset > static_cast<std::size_t>(op - dst)) return false;
+        }
+
+        // match
+        if (matchLength == 15) {
+            uint8_t byte;
+            do {
+                if (ip >= iend) return false;
+                byte = *ip++;
+                matchLength += byte;
+            } while (byte == 255);
+        }
+        matchLength += MIN_MATCH;
+        if (matchLength > static_cast<std::size_t>(oend - op)) return false;
+
+        const uint8_t* match = op - offset;
+        uint8_t* copyEnd = op + matchLength;
+        if (offset >= 16 && oend - copyEnd >= 16) {
+            // 16 byte copies may run up to 15 bytes past the match, which is still inside the output
+            do {
+                memcpy(op, match, 16);
+                op += 16;
+                match += 16;
+            } while (op < copyEnd);
+        } else if (offset >= 8 && oend - copyEnd >= 8) {
+            do {
+                memcpy(op, match, 8);
+                op += 8;
+                match += 8;
+            } while (op < copyEnd);
+        } else {
+            // overlapping (a repeated short pattern) or at the very end
+            while (op < copyEnd) *op++ = *match++;
+        }
+        op = copyEnd;
+    }
+    return op == oend;
+}
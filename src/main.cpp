@@ -9,8 +9,32 @@
 #include "settings.hpp"
 #include "chat.hpp"
 #include "utils.hpp"
+#include "trace.hpp"
+#include "capture.hpp"
+#include "renderer.hpp"
+
+// function to open the message log if one was requested
+template <typename ChatT>
+static bool openLog(ChatT& chat, const Settings& settings) {
+    if (settings.getLogDir().empty()) return true;
+    std::string error = chat.openMessageLog(settings.getLogDir(), settings.getLogSync(), settings.getLogSyncInterval());
+    if (error.empty()) return true;
+    std::cerr << "Error: cannot open message log: " << error << "\n";
+    return false;
+}
+
+// function to open the -f script if one was given
+template <typename ChatT>
+static bool openScript(ChatT& chat, const Settings& settings) {
+    if (settings.getScriptFile().empty()) return true;
+    std::string error = chat.openScript(settings.getScriptFile());
+    if (error.empty()) return true;
+    std::cerr << "Error: cannot open script " << settings.getScriptFile() << ": " << error << "\n";
+    return false;
+}
 
 int main(int argc, char* argv[]) {
+    uint64_t startNs = monotonicNs(); // start of the time-to-first-AUTH
 
     // parse arguments
     Settings settings(argc, argv);
@@ -18,6 +42,7 @@ int main(int argc, char* argv[]) {
 
     Mode mode = settings.getMode();
     NetworkAdress server = settings.getServer();
+    Trace::setOutput(settings.getTraceFile());
 
     // no mode err
     if (mode == Mode::NONE) {
@@ -25,16 +50,45 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
+    // raw traffic capture
+    if (!settings.getCaptureFile().empty() && !Capture::open(settings.getCaptureFile(), mode)) {
+        std::cerr << "Error: cannot open capture file " << settings.getCaptureFile() << "\n";
+        return 1;
+    }
+    bool replay = !settings.getReplayFile().empty();
+
+    // scrollback and input line on a terminal, plain lines otherwise, both behind the bounded display queue
+    if (!replay) Renderer::start(settings.getFps(), !settings.getPlain(), settings.getDisplayQueue(), settings.getDisplayPolicy());
+
     // tcp
     if (settings.getMode() == Mode::TCP) {
         ChatTCP chat(server);    
-        chat.eventLoop();
+        chat.setHistoryBudget(settings.getHistoryBudget());
+        chat.setPoolSize(settings.getPoolSize());
+        chat.setSocketOptions(settings.getSocketOptions());
+        chat.setRateLimit(settings.getRateLimit());
+        if (!openLog(chat, settings) || !openScript(chat, settings)) return 1;
+        chat.setReconnect(settings.getReconnectAttempts());
+        chat.setStartTime(startNs);
+        if (replay) chat.replay(settings.getReplayFile(), settings.getReplaySpeed());
+        else chat.eventLoop();
     }
 
     // udp
     if (settings.getMode() == Mode::UDP) {
         ChatUDP chat(server, settings.getMaxUdpRetransmissions(), settings.getUdpTimeoutConfirmation());
-        chat.eventLoop();
+        chat.setHistoryBudget(settings.getHistoryBudget());
+        chat.setPoolSize(settings.getPoolSize());
+        chat.setSocketOptions(settings.getSocketOptions());
+        chat.setRateLimit(settings.getRateLimit());
+        if (!openLog(chat, settings) || !openScript(chat, settings)) return 1;
+        chat.setReconnect(settings.getReconnectAttempts());
+        chat.setStartTime(startNs);
+        if (replay) chat.replay(settings.getReplayFile(), settings.getReplaySpeed());
+        else {
+            if (settings.getPipeline()) chat.setPipeline(settings.getPinNetwork(), settings.getPinProtocol());
+            chat.eventLoop();
+        }
     }
 
     return 0;
@@ -4,117 +4,192 @@
  * @author Martin Mendl <x247581>
  * @date 18.4.2025
  */
-#include <regex>
+#include <cstring>
 #include <iostream>
+#include <utility>
 #include "message.hpp"
+#include "counters.hpp"
 
 // function to findt out if a string starts with a prefix
-bool startsWith(const std::string& str, const std::string& prefix) {
-    return str.rfind(prefix, 0) == 0;  // Check if found at position 0
+bool startsWith(std::string_view str, std::string_view prefix) {
+    return str.substr(0, prefix.size()) == prefix;
 }
 
-// TCP factory method, to read a response
-Message* TCPMessages::readResponse(const std::string &resopnse) {
-    if (startsWith(resopnse, "REPLY")) {
-        std::regex pattern(R"(^\s*REPLY\s+(\S+)\s+IS\s+(.*)\r\n$)");
-        std::smatch matches;
-        if (std::regex_match(resopnse, matches, pattern)) {
-            std::string result = matches[1].str();
-            std::string content = matches[2].str();
-            bool isOk = (result == "OK");
-            return new MessageReply(0, isOk, 0, content);
-        }
-        return nullptr;
+/*
+The TCP grammar is matched by hand, a std::regex is compiled for every
+frame and its backtracking recursion overflows the stack on a 60 000 byte
+content. Each helper consumes one piece of a pattern from the front of the
+frame, e.g. MSG FROM is ^MSG\s+FROM\s+(\S+)\s+IS\s+(.*)\r\n$.
+*/
+
+// function to check for a \s character
+static inline bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+
+// function to consume \s+
+static bool spaces(std::string_view& rest) {
+    std::size_t n = 0;
+    while (n < rest.size() && isSpace(rest[n])) n++;
+    rest.remove_prefix(n);
+    return n > 0;
+}
+
+// function to consume a keyword followed by \s+
+static bool keyword(std::string_view& rest, std::string_view word) {
+    if (!startsWith(rest, word)) return false;
+    rest.remove_prefix(word.size());
+    return spaces(rest);
+}
+
+// function to consume \S+
+static bool token(std::string_view& rest, std::string_view& value) {
+    std::size_t n = 0;
+    while (n < rest.size() && !isSpace(rest[n])) n++;
+    value = rest.substr(0, n);
+    rest.remove_prefix(n);
+    return n > 0;
+}
+
+// function to consume \S+ followed by \s+
+static bool field(std::string_view& rest, std::string_view& value) {
+    return token(rest, value) && spaces(rest);
+}
+
+// function to check the (.*) at the end of a frame, it does not match line breaks
+static bool content(std::string_view rest) {
+    return memchr(rest.data(), '\r', rest.size()) == nullptr && memchr(rest.data(), '\n', rest.size()) == nullptr;
+}
+
+// function to take a message from the pool (a new one without a pool) and fill it
+template <typename T, typename... Args>
+static MessagePtr build(MessagePool* pool, Args&&... args) {
+    if (pool != nullptr) return pool->make<T>(std::forward<Args>(args)...);
+    T* message = new T();
+    message->assign(std::forward<Args>(args)...);
+    return MessagePtr(message);
+}
+
+// function to parse a TCP message, nullptr if it is not understood
+static MessagePtr parseTCP(MessagePool* pool, std::string_view frame) {
+    if (frame.size() < 2 || frame.substr(frame.size() - 2) != "\r\n") return nullptr;
+    std::string_view rest = frame.substr(0, frame.size() - 2);
+    std::string_view first, second;
+
+    // REPLY {"OK"|"NOK"} IS {MessageContent}
+    if (startsWith(rest, "REPLY")) {
+        if (!keyword(rest, "REPLY") || !field(rest, first) || !keyword(rest, "IS") || !content(rest)) return nullptr;
+        return build<MessageReply>(pool, 0, first == "OK", 0, rest);
     }
 
-    if (startsWith(resopnse, "ERR FROM")) {
-        std::regex pattern(R"(^\s*ERR\s+FROM\s+(\S+)\s+IS\s+(.*)\r\n$)");
-        std::smatch matches;
-        if (std::regex_match(resopnse, matches, pattern)) {
-            std::string displayName = matches[1].str();
-            std::string content = matches[2].str();
-            return new MessageError(0, displayName, content);
-        }
-        return nullptr;
+    // ERR FROM {DisplayName} IS {MessageContent}
+    if (startsWith(rest, "ERR FROM")) {
+        if (!keyword(rest, "ERR") || !keyword(rest, "FROM") || !field(rest, first) || !keyword(rest, "IS") || !content(rest)) return nullptr;
+        return build<MessageError>(pool, 0, first, rest);
     }
 
-    if (startsWith(resopnse, "AUTH")) {
-        std::regex pattern(R"(^\s*AUTH\s+(\S+)\s+AS\s+(\S+)\s+USING\s+(.*)\r\n$)");
-        std::smatch matches;
-        if (std::regex_match(resopnse, matches, pattern)) {
-            std::string username = matches[1].str();
-            std::string displayName = matches[2].str();
-            std::string secret = matches[3].str();
-            return new MessageAuth(0, username, displayName, secret);
-        }
-        return nullptr;
+    // AUTH {Username} AS {DisplayName} USING {Secret}
+    if (startsWith(rest, "AUTH")) {
+        if (!keyword(rest, "AUTH") || !field(rest, first) || !keyword(rest, "AS") || !field(rest, second) || !keyword(rest, "USING") || !content(rest)) return nullptr;
+        return build<MessageAuth>(pool, 0, first, second, rest);
     }
 
-    if (startsWith(resopnse, "JOIN")) {
-        std::regex pattern(R"(^\s*JOIN\s+(\S+)\s+AS\s+(\S+)\r\n$)");
-        std::smatch matches;
-        if (std::regex_match(resopnse, matches, pattern)) {
-            std::string channelId = matches[1].str();
-            std::string displayName = matches[2].str();
-            return new MessageJoin(0, channelId, displayName);
-        }
-        return nullptr;
+    // JOIN {ChannelID} AS {DisplayName}
+    if (startsWith(rest, "JOIN")) {
+        if (!keyword(rest, "JOIN") || !field(rest, first) || !keyword(rest, "AS") || !token(rest, second) || !rest.empty()) return nullptr;
+        return build<MessageJoin>(pool, 0, first, second);
     }
 
-    if (startsWith(resopnse, "MSG FROM")) {
-        std::regex pattern(R"(^\s*MSG\s+FROM\s+(\S+)\s+IS\s+(.*)\r\n$)");
-        std::smatch matches;
-        if (std::regex_match(resopnse, matches, pattern)) {
-            std::string displayName = matches[1].str();
-            std::string content = matches[2].str();
-            return new MessageMsg(0, displayName, content);
-        }
-        return nullptr;
+    // MSG FROM {DisplayName} IS {MessageContent}
+    if (startsWith(rest, "MSG FROM")) {
+        if (!keyword(rest, "MSG") || !keyword(rest, "FROM") || !field(rest, first) || !keyword(rest, "IS") || !content(rest)) return nullptr;
+        return build<MessageMsg>(pool, 0, first, rest);
     }
 
-    if (startsWith(resopnse, "BYE FROM")) {
-        std::regex pattern(R"(^\s*BYE\s+FROM\s+(\S+)\r\n$)");
-        std::smatch matches;
-        if (std::regex_match(resopnse, matches, pattern)) {
-            std::string displayName = matches[1].str();
-            return new MessageBye(0, displayName);
-        }
-        return nullptr;
+    // BYE FROM {DisplayName}
+    if (startsWith(rest, "BYE FROM")) {
+        if (!keyword(rest, "BYE") || !keyword(rest, "FROM") || !token(rest, first) || !rest.empty()) return nullptr;
+        return build<MessageBye>(pool, 0, first);
     }
     return nullptr; // Unknown message type
 }
 
+// TCP factory method, to read a response
+MessagePtr TCPMessages::readResponse(std::string_view resopnse) {
+    MessagePtr msg = parseTCP(pool, resopnse);
+    if (msg == nullptr) CounterBlock::add(Counters::local().parseFailures);
+    return msg;
+}
+
+// method to guess the type of a serialized TCP message from its first word
+MessageType TCPMessages::peekType(std::string_view message) {
+    if (startsWith(message, "MSG")) return MessageType::MSG;
+    if (startsWith(message, "REPLY OK")) return MessageType::pREPLY;
+    if (startsWith(message, "REPLY")) return MessageType::nREPLY;
+    if (startsWith(message, "AUTH")) return MessageType::AUTH;
+    if (startsWith(message, "JOIN")) return MessageType::JOIN;
+    if (startsWith(message, "ERR")) return MessageType::ERR;
+    if (startsWith(message, "BYE")) return MessageType::BYE;
+    return MessageType::UNKNOWN;
+}
+
+// method to get the type of a datagram from its first byte
+MessageType UDPMessages::peekType(std::string_view message) {
+    if (message.empty()) return MessageType::UNKNOWN;
+    switch (static_cast<uint8_t>(message[0])) {
+        case 0x00: return MessageType::CONFIRM;
+        case 0x01: return (message.size() > 3 && message[3]) ? MessageType::pREPLY : MessageType::nREPLY;
+        case 0x02: return MessageType::AUTH;
+        case 0x03: return MessageType::JOIN;
+        case 0x04: return MessageType::MSG;
+        case 0xFD: return MessageType::PING;
+        case 0xFE: return MessageType::ERR;
+        case 0xFF: return MessageType::BYE;
+        default: return MessageType::UNKNOWN;
+    }
+}
+
 // method to get the next index of a x00 byte in a string
-std::size_t UDPMessages::getNextZeroIdx(const std::string& message, std::size_t startIdx) {
+std::size_t UDPMessages::getNextZeroIdx(std::string_view message, std::size_t startIdx) {
     std::size_t idx = message.find('\0', startIdx);
-    if (idx == std::string::npos) {
+    if (idx == std::string_view::npos) {
         return message.size();
     }
     return idx;
 }
 
 // factory method for udp (converting packets to Message objects)
-Message* UDPMessages::readResponse(const std::string& resopnse) {
+MessagePtr UDPMessages::readResponse(std::string_view resopnse) {
+    MessagePtr msg = parseUDP(resopnse);
+    if (msg == nullptr) CounterBlock::add(Counters::local().parseFailures);
+    return msg;
+}
+
+// function to parse a datagram, nullptr if it is not understood
+MessagePtr UDPMessages::parseUDP(std::string_view resopnse) {
+    // shorter than the header, nothing to parse
+    if (resopnse.size() < 3) return nullptr;
 
     // need to read the first byte to determine the message type
     uint8_t msgType = static_cast<uint8_t>(resopnse[0]);
-    uint16_t msgID1 = (static_cast<uint16_t>(resopnse[1]) << 8) | static_cast<uint16_t>(resopnse[2]);
+    uint16_t msgID1 = (static_cast<uint16_t>(static_cast<uint8_t>(resopnse[1])) << 8) | static_cast<uint16_t>(static_cast<uint8_t>(resopnse[2]));
     // print out mesage type and msgID
     std::size_t idx1, idx2, idx3;
     try {
         switch (msgType) {
             case 0x00: // CONFIRM
-                return new MessageConfirm(msgID1); 
+                return build<MessageConfirm>(pool, msgID1);
             case 0x01: // REPLY
-                return new MessageReply(msgID1, static_cast<bool>(resopnse[3]), 
-                    (static_cast<uint16_t>(resopnse[4]) << 8) | static_cast<uint16_t>(resopnse[5]),
+                if (resopnse.size() < 6) return nullptr;
+                return build<MessageReply>(pool, msgID1, static_cast<bool>(resopnse[3]),
+                    (static_cast<uint16_t>(static_cast<uint8_t>(resopnse[4])) << 8) | static_cast<uint16_t>(static_cast<uint8_t>(resopnse[5])),
                     resopnse.substr(6, getNextZeroIdx(resopnse, 6) - 6));
             case 0x02: // AUTH
                 idx1 = getNextZeroIdx(resopnse, 3);
                 idx2 = getNextZeroIdx(resopnse, idx1 + 1);
                 idx3 = getNextZeroIdx(resopnse, idx2 + 1);
-                return new MessageAuth(
-                    msgID1, 
+                return build<MessageAuth>(pool,
+                    msgID1,
                     resopnse.substr(3, idx1 - 3),
                     resopnse.substr(idx1 + 1, idx2 - idx1 - 1),
                     resopnse.substr(idx2 + 1, idx3 - idx2 - 1)
@@ -122,33 +197,33 @@ Message* UDPMessages::readResponse(const std::string& resopnse) {
             case 0x03: // JOIN
                 idx1 = getNextZeroIdx(resopnse, 3);
                 idx2 = getNextZeroIdx(resopnse, idx1 + 1);
-                return new MessageJoin(
-                    msgID1, 
+                return build<MessageJoin>(pool,
+                    msgID1,
                     resopnse.substr(3, idx1 - 3),
                     resopnse.substr(idx1 + 1, idx2 - idx1 - 1)
                 );
             case 0x04: // MSG
                 idx1 = getNextZeroIdx(resopnse, 3);
                 idx2 = getNextZeroIdx(resopnse, idx1 + 1);
-                return new MessageMsg(
-                    msgID1, 
+                return build<MessageMsg>(pool,
+                    msgID1,
                     resopnse.substr(3, idx1 - 3),
                     resopnse.substr(idx1 + 1, idx2 - idx1 - 1)
                 );
             case 0xFD: // PING
-                return new MessagePing(msgID1);
+                return build<MessagePing>(pool, msgID1);
             case 0xFE: // ERR
                 idx1 = getNextZeroIdx(resopnse, 3);
                 idx2 = getNextZeroIdx(resopnse, idx1 + 1);
-                return new MessageError(
-                    msgID1, 
+                return build<MessageError>(pool,
+                    msgID1,
                     resopnse.substr(3, idx1 - 3),
                     resopnse.substr(idx1 + 1, idx2 - idx1 - 1)
                 );
             case 0xFF: // BYE
                 idx1 = getNextZeroIdx(resopnse, 3);
-                return new MessageBye(
-                    msgID1, 
+                return build<MessageBye>(pool,
+                    msgID1,
                     resopnse.substr(3, idx1 - 3)
                 );
             default:
@@ -162,7 +237,7 @@ Message* UDPMessages::readResponse(const std::string& resopnse) {
 }
 
 // Factory method for creating a message based on a user cmd udp
-Message* UDPMessages::convertCommandToMessage(uint16_t messageID, Command* command) {
+MessagePtr UDPMessages::convertCommandToMessage(uint16_t messageID, Command* command) {
 
     // auth
     if (typeid(*command) == typeid(CommandAuth)) {
@@ -170,27 +245,27 @@ Message* UDPMessages::convertCommandToMessage(uint16_t messageID, Command* comma
         client->displayName = authCmd->getDisplayName();
         client->username = authCmd->getUsername();
         client->secret = authCmd->getSecret();
-        return new MessageAuth(messageID, client->username, client->displayName, client->secret);
+        return build<MessageAuth>(pool, messageID, client->username, client->displayName, client->secret);
     }
 
     // join
     if (typeid(*command) == typeid(CommandJoin)) {
         CommandJoin* joinCmd = dynamic_cast<CommandJoin*>(command);
         client->currentChannel = joinCmd->getChannelId();
-        return new MessageJoin(messageID, client->currentChannel, client->displayName);
+        return build<MessageJoin>(pool, messageID, client->currentChannel, client->displayName);
     }
 
     // msg
     if (typeid(*command) == typeid(CommandMessage)) {
         CommandMessage* msgCmd = dynamic_cast<CommandMessage*>(command);
-        return new MessageMsg(messageID, client->displayName, msgCmd->getMessage());
+        return build<MessageMsg>(pool, messageID, client->displayName, msgCmd->getMessage());
     }
 
     return nullptr; // not a valid cmd
 }
 
 // Factory method for creating a message based on a user cmd tcp
-Message* TCPMessages::convertCommandToMessage(Command* command) {
+MessagePtr TCPMessages::convertCommandToMessage(Command* command) {
 
     // auth
     if (typeid(*command) == typeid(CommandAuth)) {
@@ -198,31 +273,59 @@ Message* TCPMessages::convertCommandToMessage(Command* command) {
         client->displayName = authCmd->getDisplayName();
         client->username = authCmd->getUsername();
         client->secret = authCmd->getSecret();
-        return new MessageAuth(0, client->username, client->displayName, client->secret);
+        return build<MessageAuth>(pool, 0, client->username, client->displayName, client->secret);
     }
 
     // join
     if (typeid(*command) == typeid(CommandJoin)) {
         CommandJoin* joinCmd = dynamic_cast<CommandJoin*>(command);
         client->currentChannel = joinCmd->getChannelId();
-        return new MessageJoin(0, client->currentChannel, client->displayName);
+        return build<MessageJoin>(pool, 0, client->currentChannel, client->displayName);
     }
 
     // message
     if (typeid(*command) == typeid(CommandMessage)) {
         CommandMessage* msgCmd = dynamic_cast<CommandMessage*>(command);
-        return new MessageMsg(0, client->displayName, msgCmd->getMessage());
+        return build<MessageMsg>(pool, 0, client->displayName, msgCmd->getMessage());
     }
 
     return nullptr; // not a valid command to generate
 }
 
+// Method to give a message back to its pool
+void MessageReturn::operator()(Message* message) const {
+    if (pool != nullptr) pool->release(message);
+    else delete message;
+}
+
+// Method to give a message back to the pool of its type
+void MessagePool::release(Message* message) {
+    switch (message->getType()) {
+        case MessageType::ERR: std::get<Pool<MessageError>>(pools).give(static_cast<MessageError*>(message)); return;
+        case MessageType::pREPLY:
+        case MessageType::nREPLY: std::get<Pool<MessageReply>>(pools).give(static_cast<MessageReply*>(message)); return;
+        case MessageType::AUTH: std::get<Pool<MessageAuth>>(pools).give(static_cast<MessageAuth*>(message)); return;
+        case MessageType::JOIN: std::get<Pool<MessageJoin>>(pools).give(static_cast<MessageJoin*>(message)); return;
+        case MessageType::MSG: std::get<Pool<MessageMsg>>(pools).give(static_cast<MessageMsg*>(message)); return;
+        case MessageType::BYE: std::get<Pool<MessageBye>>(pools).give(static_cast<MessageBye*>(message)); return;
+        case MessageType::CONFIRM: std::get<Pool<MessageConfirm>>(pools).give(static_cast<MessageConfirm*>(message)); return;
+        case MessageType::PING: std::get<Pool<MessagePing>>(pools).give(static_cast<MessagePing*>(message)); return;
+        default: delete message;
+    }
+}
+
 // ERR message
-MessageError::MessageError(uint16_t msgID, const std::string& displayName, const std::string& content) : Message(msgID) {
-    this->displayName = displayName;
-    this->content = content;
+MessageError::MessageError(uint16_t msgID, std::string displayName, std::string content) : Message(msgID) {
+    this->displayName.assign(displayName, nameTable());
+    this->content = std::move(content);
 }
 
+// Method to refill a pooled ERR message
+void MessageError::assign(uint16_t msgID, std::string_view displayName, std::string_view content) {
+    this->msgID = msgID;
+    this->displayName.assign(displayName, nameTable());
+    this->content.assign(content);
+}
 
 /*
   1 byte       2 bytes
@@ -230,41 +333,45 @@ MessageError::MessageError(uint16_t msgID, const std::string& displayName, const
 |  0xFE  |    MessageID    |  DisplayName  | 0 |  MessageContents  | 0 |
 +--------+--------+--------+-------~~------+---+--------~~---------+---+
 */
-std::string MessageError::getUDPMsg() {
-    std::string message;
-    message.reserve(1 + 1 + displayName.size() + 1 + content.size() + 1); // Preallocate
+void MessageError::appendUDPMsg(std::string& message) const {
+    message.reserve(message.size() + 1 + 1 + displayName.view().size() + 1 + content.size() + 1); // Preallocate
     message.push_back(static_cast<char>(0xFE));  // Protocol identifier
     message.push_back(static_cast<char>((msgID >> 8) & 0xFF)); // High byte of msgID
     message.push_back(static_cast<char>(msgID & 0xFF));        // Low byte of msgID
-    message.append(displayName);
+    message.append(displayName.view());
     message.push_back('\0'); // Null-terminate display name
     message.append(content);
     message.push_back('\0'); // Null-terminate content
-    return message;
 }
 
 // ERR FROM {DisplayName} IS {MessageContent}\r\n
-std::string MessageError::getTCPMsg() {
-    std::string message = "ERR FROM " + displayName + " IS " + content + "\r\n";
-    return message;
+void MessageError::appendTCPMsg(std::string& message) const {
+    message.append("ERR FROM ").append(displayName.view()).append(" IS ").append(content).append("\r\n");
 }
 
 // REPLY message
-MessageReply::MessageReply(uint16_t msgID, bool isOk, uint16_t refID, const std::string& content) : Message(msgID) {
+MessageReply::MessageReply(uint16_t msgID, bool isOk, uint16_t refID, std::string content) : Message(msgID) {
     this->isOk = isOk;
-    this->content = content;
+    this->content = std::move(content);
     this->refMsgID = refID;
 }
 
+// Method to refill a pooled REPLY message
+void MessageReply::assign(uint16_t msgID, bool isOk, uint16_t refID, std::string_view content) {
+    this->msgID = msgID;
+    this->isOk = isOk;
+    this->refMsgID = refID;
+    this->content.assign(content);
+}
+
 /*
   1 byte       2 bytes       1 byte       2 bytes      
 +--------+--------+--------+--------+--------+--------+--------~~---------+---+
 |  0x01  |    MessageID    | Result |  Ref_MessageID  |  MessageContents  | 0 |
 +--------+--------+--------+--------+--------+--------+--------~~---------+---+
 */
-std::string MessageReply::getUDPMsg() {
-    std::string message;
-    message.reserve(1 + 2 + 1 + 2 + content.size() + 1); // Preallocate
+void MessageReply::appendUDPMsg(std::string& message) const {
+    message.reserve(message.size() + 1 + 2 + 1 + 2 + content.size() + 1); // Preallocate
     message.push_back(static_cast<char>(0x01));  // Protocol identifier
     message.push_back(static_cast<char>((msgID >> 8) & 0xFF)); // High byte of msgID
     message.push_back(static_cast<char>(msgID & 0xFF));        // Low byte of msgID
@@ -273,20 +380,26 @@ std::string MessageReply::getUDPMsg() {
     message.push_back(static_cast<char>(refMsgID & 0xFF));        // Low byte of msgID
     message.append(content);
     message.push_back('\0'); // Null-terminate content
-    return message;
 }
 
 // REPLY {"OK"|"NOK"} IS {MessageContent}\r\n
-std::string MessageReply::getTCPMsg() {
-    std::string message = "REPLY " + std::string(isOk ? "OK" : "NOK") + " IS " + content + "\r\n";
-    return message;
+void MessageReply::appendTCPMsg(std::string& message) const {
+    message.append("REPLY ").append(isOk ? "OK" : "NOK").append(" IS ").append(content).append("\r\n");
 }
 
 // AUTH message
-MessageAuth::MessageAuth(uint16_t msgID, const std::string& username, const std::string& displayName, const std::string& secret) : Message(msgID) {
-    this->username = username;
-    this->secret = secret;
-    this->displayName = displayName;
+MessageAuth::MessageAuth(uint16_t msgID, std::string username, std::string displayName, std::string secret) : Message(msgID) {
+    this->username = std::move(username);
+    this->secret = std::move(secret);
+    this->displayName.assign(displayName, nameTable());
+}
+
+// Method to refill a pooled AUTH message
+void MessageAuth::assign(uint16_t msgID, std::string_view username, std::string_view displayName, std::string_view secret) {
+    this->msgID = msgID;
+    this->username.assign(username);
+    this->displayName.assign(displayName, nameTable());
+    this->secret.assign(secret);
 }
 
 /*
@@ -295,31 +408,35 @@ MessageAuth::MessageAuth(uint16_t msgID, const std::string& username, const std:
 |  0x02  |    MessageID    |  Username  | 0 |  DisplayName  | 0 |  Secret  | 0 |
 +--------+--------+--------+-----~~-----+---+-------~~------+---+----~~----+---+
 */
-std::string MessageAuth::getUDPMsg() {
-    std::string message;
-    message.reserve(1 + 2 + username.size() + 1 + displayName.size() + 1 + secret.size() + 1); // Preallocate
+void MessageAuth::appendUDPMsg(std::string& message) const {
+    message.reserve(message.size() + 1 + 2 + username.size() + 1 + displayName.view().size() + 1 + secret.size() + 1); // Preallocate
     message.push_back(static_cast<char>(0x02));  // Protocol identifier
     message.push_back(static_cast<char>((msgID >> 8) & 0xFF)); // High byte of msgID
     message.push_back(static_cast<char>(msgID & 0xFF));        // Low byte of msgID
     message.append(username);
     message.push_back('\0'); // Null-terminate username
-    message.append(displayName);
+    message.append(displayName.view());
     message.push_back('\0'); // Null-terminate display name
     message.append(secret);
     message.push_back('\0'); // Null-terminate secret
-    return message;
 }
 
 // AUTH {Username} AS {DisplayName} USING {Secret}\r\n
-std::string MessageAuth::getTCPMsg() {
-    std::string message = "AUTH " + username + " AS " + displayName + " USING " + secret + "\r\n";
-    return message;
+void MessageAuth::appendTCPMsg(std::string& message) const {
+    message.append("AUTH ").append(username).append(" AS ").append(displayName.view()).append(" USING ").append(secret).append("\r\n");
 }
 
 // JOIN message
-MessageJoin::MessageJoin(uint16_t msgID, const std::string& channelId, const std::string& displayName) : Message(msgID) {
-    this->channelId = channelId;
-    this->displayName = displayName;
+MessageJoin::MessageJoin(uint16_t msgID, std::string channelId, std::string displayName) : Message(msgID) {
+    this->channelId.assign(channelId, nameTable());
+    this->displayName.assign(displayName, nameTable());
+}
+
+// Method to refill a pooled JOIN message
+void MessageJoin::assign(uint16_t msgID, std::string_view channelId, std::string_view displayName) {
+    this->msgID = msgID;
+    this->channelId.assign(channelId, nameTable());
+    this->displayName.assign(displayName, nameTable());
 }
 
 /*
@@ -328,29 +445,33 @@ MessageJoin::MessageJoin(uint16_t msgID, const std::string& channelId, const std
 |  0x03  |    MessageID    |  ChannelID | 0 |  DisplayName  | 0 |
 +--------+--------+--------+-----~~-----+---+-------~~------+---+
 */
-std::string MessageJoin::getUDPMsg() {
-    std::string message;
-    message.reserve(1 + 2 + channelId.size() + 1 + displayName.size() + 1); // Preallocate
+void MessageJoin::appendUDPMsg(std::string& message) const {
+    message.reserve(message.size() + 1 + 2 + channelId.view().size() + 1 + displayName.view().size() + 1); // Preallocate
     message.push_back(static_cast<char>(0x03));  // Protocol identifier
     message.push_back(static_cast<char>((msgID >> 8) & 0xFF)); // High byte of msgID
     message.push_back(static_cast<char>(msgID & 0xFF));        // Low byte of msgID
-    message.append(channelId);
+    message.append(channelId.view());
     message.push_back('\0'); // Null-terminate channel ID
-    message.append(displayName);
+    message.append(displayName.view());
     message.push_back('\0'); // Null-terminate display name
-    return message;
 }
 
 // JOIN {ChannelID} AS {DisplayName}\r\n
-std::string MessageJoin::getTCPMsg() {
-    std::string message = "JOIN " + channelId + " AS " + displayName + "\r\n";
-    return message;
-}   
+void MessageJoin::appendTCPMsg(std::string& message) const {
+    message.append("JOIN ").append(channelId.view()).append(" AS ").append(displayName.view()).append("\r\n");
+}
 
 // MSG message
-MessageMsg::MessageMsg(uint16_t msgID, const std::string& displayName, const std::string& content) : Message(msgID) {
-    this->displayName = displayName;
-    this->content = content;
+MessageMsg::MessageMsg(uint16_t msgID, std::string displayName, std::string content) : Message(msgID) {
+    this->displayName.assign(displayName, nameTable());
+    this->content = std::move(content);
+}
+
+// Method to refill a pooled MSG message
+void MessageMsg::assign(uint16_t msgID, std::string_view displayName, std::string_view content) {
+    this->msgID = msgID;
+    this->displayName.assign(displayName, nameTable());
+    this->content.assign(content);
 }
 
 /*
@@ -359,28 +480,38 @@ MessageMsg::MessageMsg(uint16_t msgID, const std::string& displayName, const std
 |  0x04  |    MessageID    |  DisplayName  | 0 |  MessageContents  | 0 |
 +--------+--------+--------+-------~~------+---+--------~~---------+---+
 */
-std::string MessageMsg::getUDPMsg() {
-    std::string message;
-    message.reserve(1 + 2 + displayName.size() + 1 + content.size() + 1); // Preallocate
+void MessageMsg::appendUDPMsg(std::string& message) const {
+    message.reserve(message.size() + 1 + 2 + displayName.view().size() + 1 + content.size() + 1); // Preallocate
     message.push_back(static_cast<char>(0x04));  // Protocol identifier
     message.push_back(static_cast<char>((msgID >> 8) & 0xFF)); // High byte of msgID
     message.push_back(static_cast<char>(msgID & 0xFF));        // Low byte of msgID
-    message.append(displayName);
+    message.append(displayName.view());
     message.push_back('\0'); // Null-terminate display name
     message.append(content);
     message.push_back('\0'); // Null-terminate content
-    return message;
 }
 
 // MSG FROM {DisplayName} IS {MessageContent}\r\n
-std::string MessageMsg::getTCPMsg() {
-    std::string message = "MSG FROM " + displayName + " IS " + content + "\r\n";
-    return message;
+void MessageMsg::appendTCPMsg(std::string& message) const {
+    appendTCPHeader(message);
+    message.append(content);
+    message.append("\r\n");
+}
+
+// MSG FROM {DisplayName} IS 
+void MessageMsg::appendTCPHeader(std::string& message) const {
+    message.append("MSG FROM ").append(displayName.view()).append(" IS ");
 }
 
 // BYE message
-MessageBye::MessageBye(uint16_t msgId, const std::string& displayName) : Message(msgId) {
-    this->displayName = displayName;
+MessageBye::MessageBye(uint16_t msgId, std::string displayName) : Message(msgId) {
+    this->displayName.assign(displayName, nameTable());
+}
+
+// Method to refill a pooled BYE message
+void MessageBye::assign(uint16_t msgID, std::string_view displayName) {
+    this->msgID = msgID;
+    this->displayName.assign(displayName, nameTable());
 }
 
 /*
@@ -389,21 +520,18 @@ MessageBye::MessageBye(uint16_t msgId, const std::string& displayName) : Message
 |  0xFF  |    MessageID    |  DisplayName  | 0 |
 +--------+--------+--------+-------~~------+---+
 */
-std::string MessageBye::getUDPMsg() {
-    std::string message;
-    message.reserve(1 + 2 + displayName.size() + 1); // Preallocate
+void MessageBye::appendUDPMsg(std::string& message) const {
+    message.reserve(message.size() + 1 + 2 + displayName.view().size() + 1); // Preallocate
     message.push_back(static_cast<char>(0xFF));  // Protocol identifier
     message.push_back(static_cast<char>((msgID >> 8) & 0xFF)); // High byte of msgID
     message.push_back(static_cast<char>(msgID & 0xFF));        // Low byte of msgID
-    message.append(displayName);
+    message.append(displayName.view());
     message.push_back('\0'); // Null-terminate display name
-    return message;
 }
 
 // BYE FROM {DisplayName}\r\n
-std::string MessageBye::getTCPMsg() {
-    std::string message = "BYE FROM " + displayName + "\r\n";
-    return message;
+void MessageBye::appendTCPMsg(std::string& message) const {
+    message.append("BYE FROM ").append(displayName.view()).append("\r\n");
 }
 
 /*
@@ -412,13 +540,10 @@ std::string MessageBye::getTCPMsg() {
 |  0x00  |  Ref_MessageID  |
 +--------+--------+--------+
 */
-std::string MessageConfirm::getUDPMsg() {
-    std::string message;
-    message.reserve(1 + 2); // Preallocate
+void MessageConfirm::appendUDPMsg(std::string& message) const {
     message.push_back(static_cast<char>(0x00));  // Protocol identifier
     message.push_back(static_cast<char>((msgID >> 8) & 0xFF)); // High byte of msgID
     message.push_back(static_cast<char>(msgID & 0xFF));        // Low byte of msgID
-    return message;
 }
 
 /*
@@ -427,11 +552,8 @@ std::string MessageConfirm::getUDPMsg() {
 |  0xFD  |    MessageID    |
 +--------+--------+--------+
 */
-std::string MessagePing::getUDPMsg() {
-    std::string message;
-    message.reserve(1 + 2); // Preallocate
+void MessagePing::appendUDPMsg(std::string& message) const {
     message.push_back(static_cast<char>(0xFD));  // Protocol identifier
     message.push_back(static_cast<char>((msgID >> 8) & 0xFF)); // High byte of msgID
     message.push_back(static_cast<char>(msgID & 0xFF));        // Low byte of msgID
-    return message;
-}
\ No newline at end of file
+}
@@ -0,0 +1,579 @@
+/**
+ * @file messageLog.cpp
+ * @brief Implementation of the MessageLog class
+ * @author Martin Mendl <x247581>
+ * @date 18.4.2025
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <cerrno>
+#include <iostream>
+#include <map>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "messageLog.hpp"
+#include "latency.hpp"
+#include "lz.hpp"
+
+#define NOT_INDEXED UINT64_MAX
+#define PAGE_MASK (~static_cast<uint64_t>(sysconf(_SC_PAGESIZE) - 1))
+
+// function to round a record size up to 8 bytes
+static uint32_t padded(std::size_t length) {
+    return static_cast<uint32_t>((length + 7) & ~static_cast<std::size_t>(7));
+}
+
+// function to get the path of a segment's index
+static std::string indexPath(const std::string& segmentPath) {
+    return segmentPath.substr(0, segmentPath.size() - 4) + ".idx";
+}
+
+// function to get the path of a segment's archive
+static std::string archivePath(const std::string& segmentPath) {
+    return segmentPath.substr(0, segmentPath.size() - 4) + ".lza";
+}
+
+// function to get the wall clock time in nanoseconds
+static uint64_t wallClockNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// function to read the record at an offset, message may be nullptr if only the time is needed
+static bool readRecord(const char* data, uint64_t size, uint64_t offset, LogMessage* message, uint64_t& timeNs, uint64_t& next) {
+    if (offset + sizeof(LogRecordHeader) > size) return false;
+
+    LogRecordHeader header;
+    memcpy(&header, data + offset, sizeof(header));
+    uint64_t payload = static_cast<uint64_t>(header.channelLength) + header.senderLength + header.contentLength;
+    // zero length is the end, anything inconsistent is a torn write
+    if (header.length == 0 || header.length < sizeof(header) + payload || offset + header.length > size) return false;
+
+    timeNs = header.timeNs;
+    next = offset + header.length;
+    if (message == nullptr) return true;
+
+    const char* fields = data + offset + sizeof(header);
+    message->timeNs = header.timeNs;
+    message->outgoing = header.outgoing != 0;
+    message->channel.assign(fields, header.channelLength);
+    message->sender.assign(fields + header.channelLength, header.senderLength);
+    message->content.assign(fields + header.channelLength + header.senderLength, header.contentLength);
+    return true;
+}
+
+// function to find the end of the records, scanning from a known record
+static uint64_t scanEnd(const char* data, uint64_t size, uint64_t offset) {
+    uint64_t timeNs, next;
+    while (readRecord(data, size, offset, nullptr, timeNs, next)) offset = next;
+    return offset;
+}
+
+// function to load a segment's sparse index, chunk 0 always starts at offset 0
+static std::vector<LogIndexEntry> loadIndex(const std::string& path, uint64_t size, uint64_t firstTimeNs) {
+    std::vector<LogIndexEntry> index;
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        LogIndexEntry entry;
+        while (read(fd, &entry, sizeof(entry)) == sizeof(entry)) {
+            // an entry written before a crash may point past the records, ascending offsets only
+            if (entry.offset >= size || (!index.empty() && entry.offset <= index.back().offset)) break;
+            index.push_back(entry);
+        }
+        ::close(fd);
+    }
+    if (index.empty() || index.front().offset != 0) index.insert(index.begin(), LogIndexEntry{firstTimeNs, 0});
+    return index;
+}
+
+// Destructor
+MessageLog::~MessageLog() {
+    close();
+}
+
+// Method to open the log
+std::string MessageLog::open(const std::string& dir, LogSync sync, int interval) {
+    if (mkdir(dir.c_str(), 0755) < 0 && errno != EEXIST) return "cannot create " + dir + ": " + strerror(errno);
+
+    DIR* handle = opendir(dir.c_str());
+    if (handle == nullptr) return "cannot open " + dir + ": " + strerror(errno);
+
+    // only the names are read, segments are mapped when needed; stem -> archived
+    std::map<std::string, bool> stems;
+    while (dirent* entry = readdir(handle)) {
+        std::string name = entry->d_name;
+        if (name.size() != 24 || name.find_first_not_of("0123456789") != 20) continue;
+        std::string stem = name.substr(0, 20), extension = name.substr(20);
+        if (extension == ".lza") {
+            stems[stem] = true;
+        } else if (extension == ".log" && !stems.count(stem)) {
+            stems[stem] = false;
+        }
+    }
+    closedir(handle);
+
+    directory = dir;
+    syncPolicy = sync;
+    intervalMs = interval;
+    lastSyncNs = monotonicNs();
+    stopping = false;
+    for (const auto& [stem, archived] : stems) {
+        LogSegment segment;
+        segment.path = dir + "/" + stem + ".log";
+        segment.firstTimeNs = std::stoull(stem);
+        segment.archived = archived;
+        // archived, but the archiver stopped before removing the segment
+        if (archived) {
+            unlink(segment.path.c_str());
+            unlink(indexPath(segment.path).c_str());
+        }
+        segments.push_back(segment);
+    }
+
+    // the newest segment is appended to, unless it is already archived
+    if (!segments.empty() && !segments.back().archived) {
+        LogSegment& newest = segments.back();
+        if (!map(newest, true)) {
+            std::string error = "cannot map " + newest.path;
+            segments.clear();
+            directory.clear();
+            return error;
+        }
+        indexFd = ::open(indexPath(newest.path).c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        lastIndexed = newest.index.back().offset;
+        synced = newest.end;
+        active = true;
+    }
+
+    // sealed segments a previous run did not get to
+    for (std::size_t i = 0; i + 1 < segments.size(); ++i) {
+        if (!segments[i].archived) enqueueArchive(segments[i].path);
+    }
+    return "";
+}
+
+// Method to map a segment
+bool MessageLog::map(LogSegment& segment, bool writable) {
+    if (segment.data != nullptr) return true;
+
+    if (!segment.archived) {
+        int fd = ::open(segment.path.c_str(), writable ? O_RDWR : O_RDONLY);
+        // the archiver may have replaced it in the meantime
+        if (fd < 0 && (writable || errno != ENOENT)) return false;
+        if (fd >= 0) {
+            struct stat info;
+            if (fstat(fd, &info) < 0 || info.st_size < static_cast<off_t>(sizeof(LogRecordHeader))) {
+                ::close(fd);
+                return false;
+            }
+            segment.size = info.st_size;
+            void* data = mmap(nullptr, segment.size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if (data == MAP_FAILED) return false;
+            segment.data = static_cast<char*>(data);
+
+            // the end is found by scanning from the last index entry, at most LOG_INDEX_INTERVAL bytes
+            segment.index = loadIndex(indexPath(segment.path), segment.size, segment.firstTimeNs);
+            segment.end = scanEnd(segment.data, segment.size, segment.index.back().offset);
+            return true;
+        }
+        segment.archived = true;
+    }
+
+    // archived segment, only the header and the block index are read here
+    int fd = ::open(archivePath(segment.path).c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) < 0 || info.st_size < static_cast<off_t>(sizeof(LogArchiveHeader))) {
+        ::close(fd);
+        return false;
+    }
+    void* data = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) return false;
+
+    LogArchiveHeader header;
+    memcpy(&header, data, sizeof(header));
+    uint64_t size = info.st_size;
+    if (memcmp(header.magic, LOG_ARCHIVE_MAGIC, sizeof(header.magic)) != 0 || header.indexOffset > size
+        || header.blocks > (size - header.indexOffset) / sizeof(LogArchiveBlock)) {
+        munmap(data, size);
+        return false;
+    }
+    segment.data = static_cast<char*>(data);
+    segment.size = size;
+    segment.end = header.rawSize;
+    segment.blocks.resize(header.blocks);
+    memcpy(segment.blocks.data(), segment.data + header.indexOffset, header.blocks * sizeof(LogArchiveBlock));
+    segment.index.clear();
+    for (const LogArchiveBlock& block : segment.blocks) segment.index.push_back(LogIndexEntry{block.timeNs, block.rawOffset});
+    return true;
+}
+
+// Method to get the records of a chunk
+bool MessageLog::chunk(std::size_t segment, std::size_t index, const char*& data, uint64_t& length) {
+    LogSegment& current = segments[segment];
+    if (!current.archived) {
+        uint64_t start = std::min(current.index[index].offset, current.end);
+        uint64_t stop = index + 1 < current.index.size() ? std::min(current.index[index + 1].offset, current.end) : current.end;
+        data = current.data + start;
+        length = stop - start;
+        return true;
+    }
+
+    // a scan reads the records of a block one after another, the last block is kept
+    if (chunkSegment != segment || chunkIndex != index) {
+        const LogArchiveBlock& block = current.blocks[index];
+        if (block.offset > current.size || block.size > current.size - block.offset) return false;
+        chunkBuffer.resize(block.rawSize);
+        const char* stored = current.data + block.offset;
+        if (block.size == block.rawSize) {
+            memcpy(chunkBuffer.data(), stored, block.size);
+        } else if (!LZ::decompress(stored, block.size, chunkBuffer.data(), block.rawSize)) {
+            std::cout << "ERROR: corrupt block " << index << " in " << archivePath(current.path) << "\n" << std::flush;
+            return false;
+        }
+        chunkSegment = segment;
+        chunkIndex = index;
+    }
+    data = chunkBuffer.data();
+    length = chunkBuffer.size();
+    return true;
+}
+
+// Method to queue a message
+void MessageLog::append(const std::string& channel, std::string_view sender, const std::string& content, bool outgoing) {
+    if (!isOpen()) return;
+
+    LogRecordHeader header{};
+    header.channelLength = static_cast<uint16_t>(std::min<std::size_t>(channel.size(), UINT16_MAX));
+    header.senderLength = static_cast<uint16_t>(std::min<std::size_t>(sender.size(), UINT16_MAX));
+    header.contentLength = static_cast<uint32_t>(content.size());
+    header.length = padded(sizeof(header) + header.channelLength + header.senderLength + header.contentLength);
+    header.timeNs = wallClockNs();
+    header.outgoing = outgoing ? 1 : 0;
+
+    batchTimes.push_back(header.timeNs);
+    batchOffsets.push_back(static_cast<uint32_t>(batch.size()));
+    batch.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    batch.append(channel, 0, header.channelLength);
+    batch.append(sender, 0, header.senderLength);
+    batch.append(content);
+    batch.resize(batchOffsets.back() + header.length, '\0');
+}
+
+// Method to start a new segment
+bool MessageLog::rotate(uint64_t timeNs) {
+    // seal the full segment, the archiver takes it from here
+    if (active) {
+        if (syncPolicy != LogSync::NEVER) sync();
+        LogSegment& sealed = segments.back();
+        munmap(sealed.data, sealed.size);
+        sealed.data = nullptr;
+        active = false;
+        enqueueArchive(sealed.path);
+    }
+    if (indexFd >= 0) ::close(indexFd);
+    indexFd = -1;
+
+    // named by the first record, bumped if two segments would share a nanosecond
+    uint64_t name = std::max(timeNs, segments.empty() ? 0 : segments.back().firstTimeNs + 1);
+    char file[32];
+    snprintf(file, sizeof(file), "%020llu.log", static_cast<unsigned long long>(name));
+
+    LogSegment segment;
+    segment.path = directory + "/" + file;
+    segment.firstTimeNs = name;
+    int fd = ::open(segment.path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0) return false;
+    if (ftruncate(fd, LOG_SEGMENT_SIZE) < 0) {
+        ::close(fd);
+        unlink(segment.path.c_str());
+        return false;
+    }
+    void* data = mmap(nullptr, LOG_SEGMENT_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        unlink(segment.path.c_str());
+        return false;
+    }
+    segment.data = static_cast<char*>(data);
+    segment.size = LOG_SEGMENT_SIZE;
+
+    indexFd = ::open(indexPath(segment.path).c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    segments.push_back(segment);
+    lastIndexed = NOT_INDEXED;
+    synced = 0;
+    active = true;
+    return true;
+}
+
+// Method to write the queued messages
+void MessageLog::flush() {
+    if (!isOpen() || batchOffsets.empty()) return;
+
+    for (std::size_t i = 0; i < batchOffsets.size(); ++i) {
+        const char* record = batch.data() + batchOffsets[i];
+        uint32_t length;
+        memcpy(&length, record, sizeof(length));
+
+        if (!active || segments.back().end + length > segments.back().size) {
+            if (length > LOG_SEGMENT_SIZE || !rotate(batchTimes[i])) {
+                // out of disk or descriptors, keep the client running
+                continue;
+            }
+        }
+        LogSegment& current = segments.back();
+        memcpy(current.data + current.end, record, length);
+
+        // sparse index, the first record of a segment is always indexed
+        if (lastIndexed == NOT_INDEXED || current.end - lastIndexed >= LOG_INDEX_INTERVAL) {
+            LogIndexEntry entry{batchTimes[i], current.end};
+            if (indexFd >= 0 && write(indexFd, &entry, sizeof(entry)) == sizeof(entry)) current.index.push_back(entry);
+            lastIndexed = current.end;
+        }
+        current.end += length;
+    }
+    batch.clear();
+    batchTimes.clear();
+    batchOffsets.clear();
+
+    if (syncPolicy == LogSync::BATCH) sync();
+    if (syncPolicy == LogSync::INTERVAL && monotonicNs() - lastSyncNs >= static_cast<uint64_t>(intervalMs) * 1000000) sync();
+}
+
+// Method to sync the active segment
+void MessageLog::sync() {
+    lastSyncNs = monotonicNs();
+    if (!active) return;
+
+    LogSegment& current = segments.back();
+    if (current.end > synced) {
+        uint64_t start = synced & PAGE_MASK;
+        msync(current.data + start, current.end - start, MS_SYNC);
+        synced = current.end;
+    }
+    if (indexFd >= 0) fdatasync(indexFd);
+}
+
+// Method to close the log
+void MessageLog::close() {
+    if (!isOpen()) return;
+    flush();
+    if (syncPolicy != LogSync::NEVER) sync();
+
+    // a segment being compressed is finished, queued ones are picked up by the next open()
+    {
+        std::lock_guard<std::mutex> guard(archiveLock);
+        stopping = true;
+        archiveQueue.clear();
+    }
+    archiveWake.notify_one();
+    if (archiver.joinable()) archiver.join();
+
+    for (LogSegment& segment : segments) {
+        if (segment.data != nullptr) munmap(segment.data, segment.size);
+        segment.data = nullptr;
+    }
+    segments.clear();
+    if (indexFd >= 0) ::close(indexFd);
+    indexFd = -1;
+    active = false;
+    chunkSegment = chunkIndex = SIZE_MAX;
+    directory.clear();
+}
+
+// Method to queue a sealed segment for the archiver
+void MessageLog::enqueueArchive(const std::string& path) {
+    {
+        std::lock_guard<std::mutex> guard(archiveLock);
+        archiveQueue.push_back(path);
+    }
+    if (!archiver.joinable()) archiver = std::thread(&MessageLog::archiveLoop, this);
+    archiveWake.notify_one();
+}
+
+// Method run by the archiver thread
+void MessageLog::archiveLoop() {
+    while (true) {
+        std::string path;
+        {
+            std::unique_lock<std::mutex> guard(archiveLock);
+            archiveWake.wait(guard, [this] { return stopping || !archiveQueue.empty(); });
+            if (stopping) return;
+            path = archiveQueue.front();
+            archiveQueue.pop_front();
+        }
+        if (!archiveSegment(path)) std::cerr << "ERROR: cannot archive " << path << "\n" << std::flush;
+    }
+}
+
+// Method to compress a sealed segment
+bool MessageLog::archiveSegment(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) < 0 || info.st_size == 0 || path.size() < 24) {
+        ::close(fd);
+        return false;
+    }
+    uint64_t size = info.st_size;
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) return false;
+    const char* data = static_cast<const char*>(mapped);
+    madvise(mapped, size, MADV_SEQUENTIAL);
+
+    uint64_t firstTimeNs = std::strtoull(path.substr(path.size() - 24, 20).c_str(), nullptr, 10);
+    std::vector<LogIndexEntry> index = loadIndex(indexPath(path), size, firstTimeNs);
+    uint64_t end = scanEnd(data, size, index.back().offset);
+
+    // written under a temporary name, renamed only when complete
+    std::string target = archivePath(path);
+    std::string temporary = target + ".tmp";
+    FILE* out = fopen(temporary.c_str(), "wb");
+    if (out == nullptr) {
+        munmap(mapped, size);
+        return false;
+    }
+    setvbuf(out, nullptr, _IOFBF, 1 << 20);
+
+    LogArchiveHeader header{};
+    fwrite(&header, sizeof(header), 1, out);
+    uint64_t offset = sizeof(header);
+    std::vector<LogArchiveBlock> blocks;
+    std::vector<char> compressed;
+
+    // one block per index chunk, so every block starts with a record
+    for (std::size_t i = 0; i < index.size() && index[i].offset < end; ++i) {
+        uint64_t start = index[i].offset;
+        uint64_t stop = i + 1 < index.size() ? std::min(index[i + 1].offset, end) : end;
+        LogArchiveBlock block{index[i].timeNs, start, offset, 0, static_cast<uint32_t>(stop - start)};
+
+        compressed.resize(LZ::bound(block.rawSize));
+        std::size_t length = LZ::compress(data + start, block.rawSize, compressed.data());
+        // incompressible blocks are stored as they are
+        if (length >= block.rawSize) {
+            block.size = block.rawSize;
+            fwrite(data + start, 1, block.rawSize, out);
+        } else {
+            block.size = static_cast<uint32_t>(length);
+            fwrite(compressed.data(), 1, length, out);
+        }
+        offset += block.size;
+        blocks.push_back(block);
+    }
+    munmap(mapped, size);
+
+    memcpy(header.magic, LOG_ARCHIVE_MAGIC, sizeof(header.magic));
+    header.rawSize = end;
+    header.blocks = blocks.size();
+    header.indexOffset = offset;
+    fwrite(blocks.data(), sizeof(LogArchiveBlock), blocks.size(), out);
+    bool written = fseek(out, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, out) == 1 && fflush(out) == 0;
+    written = written && fdatasync(fileno(out)) == 0;
+    if (fclose(out) != 0 || !written || rename(temporary.c_str(), target.c_str()) < 0) {
+        unlink(temporary.c_str());
+        return false;
+    }
+    unlink(path.c_str());
+    unlink(indexPath(path).c_str());
+    return true;
+}
+
+// Method to find the first record at or after a time
+void MessageLog::seek(uint64_t timeNs, std::size_t& segment, std::size_t& chunkNumber, uint64_t& offset) {
+    // last segment starting at or before the time
+    auto after = std::upper_bound(segments.begin(), segments.end(), timeNs,
+        [](uint64_t time, const LogSegment& s) { return time < s.firstTimeNs; });
+    segment = after == segments.begin() ? 0 : (after - segments.begin()) - 1;
+
+    for (; segment < segments.size(); ++segment) {
+        LogSegment& current = segments[segment];
+        if (!map(current, false)) continue;
+
+        // last chunk starting at or before the time, then a short scan
+        auto entry = std::upper_bound(current.index.begin(), current.index.end(), timeNs,
+            [](uint64_t time, const LogIndexEntry& e) { return time < e.timeNs; });
+        chunkNumber = entry == current.index.begin() ? 0 : (entry - current.index.begin()) - 1;
+
+        for (; chunkNumber < current.index.size(); ++chunkNumber) {
+            const char* data;
+            uint64_t length, recordTime, next;
+            if (!chunk(segment, chunkNumber, data, length)) continue;
+            for (offset = 0; readRecord(data, length, offset, nullptr, recordTime, next); offset = next) {
+                if (recordTime >= timeNs) return;
+            }
+        }
+    }
+}
+
+// function to print one message
+static void printMessage(const LogMessage& message, std::ostream& out) {
+    time_t seconds = static_cast<time_t>(message.timeNs / 1000000000);
+    struct tm local;
+    localtime_r(&seconds, &local);
+    char stamp[32];
+    strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &local);
+    out << "[" << stamp << "] [" << message.channel << "] " << message.sender << ": " << message.content << "\n";
+}
+
+// Method to print messages since a time
+void MessageLog::printSince(uint64_t timeNs, std::size_t count, std::ostream& out) {
+    flush();
+    std::size_t segment, chunkNumber = 0;
+    uint64_t offset = 0;
+    seek(timeNs, segment, chunkNumber, offset);
+
+    LogMessage message;
+    uint64_t recordTime, next;
+    std::size_t printed = 0;
+    for (; segment < segments.size() && printed < count; ++segment, chunkNumber = 0) {
+        if (!map(segments[segment], false)) continue;
+        for (; chunkNumber < segments[segment].index.size() && printed < count; ++chunkNumber, offset = 0) {
+            const char* data;
+            uint64_t length;
+            if (!chunk(segment, chunkNumber, data, length)) continue;
+            for (; printed < count && readRecord(data, length, offset, &message, recordTime, next); offset = next) {
+                printMessage(message, out);
+                printed++;
+            }
+        }
+    }
+    if (printed == 0) out << "no logged messages in that range\n";
+    out << std::flush;
+}
+
+// Method to print the last messages
+void MessageLog::printLast(std::size_t count, std::ostream& out) {
+    flush();
+    std::vector<LogMessage> newest; // newest first
+
+    // chunks are read newest first, only as many as needed
+    for (std::size_t segment = segments.size(); segment-- > 0 && newest.size() < count;) {
+        if (!map(segments[segment], false)) continue;
+        for (std::size_t i = segments[segment].index.size(); i-- > 0 && newest.size() < count;) {
+            const char* data;
+            uint64_t length, recordTime, next;
+            if (!chunk(segment, i, data, length)) continue;
+
+            std::vector<LogMessage> records;
+            LogMessage message;
+            for (uint64_t offset = 0; readRecord(data, length, offset, &message, recordTime, next); offset = next) {
+                records.push_back(message);
+            }
+            newest.insert(newest.end(), records.rbegin(), records.rend());
+        }
+    }
+
+    if (newest.empty()) out << "no logged messages\n";
+    std::size_t shown = std::min(count, newest.size());
+    for (std::size_t i = shown; i-- > 0;) printMessage(newest[i], out);
+    out << std::flush;
+}
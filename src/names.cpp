@@ -0,0 +1,98 @@
+/**
+ * @file names.cpp
+ * @brief Implementation of the display name / channel ID interning table
+ * @author Martin Mendl <x247581>
+ * @date 18.4.2025
+ */
+#include <cstring>
+#include "names.hpp"
+#include "counters.hpp"
+
+// function to hash a name, eight bytes per multiply (names are short, a byte loop is slower than the lookup)
+static uint32_t hashName(std::string_view text) {
+    const uint64_t k = 0x9E3779B97F4A7C15ull;
+    const char* data = text.data();
+    std::size_t size = text.size();
+    uint64_t hash = size * k;
+    uint64_t word = 0;
+
+    if (size < 8) {
+        for (std::size_t i = 0; i < size; ++i) word |= static_cast<uint64_t>(static_cast<unsigned char>(data[i])) << (8 * i);
+        hash = (hash ^ word) * k;
+    } else {
+        for (std::size_t i = 0; i + 8 <= size; i += 8) {
+            memcpy(&word, data + i, 8);
+            hash = (hash ^ word) * k;
+            hash ^= hash >> 29;
+        }
+        // the last (overlapping) eight bytes
+        if (size % 8 != 0) {
+            memcpy(&word, data + size - 8, 8);
+            hash = (hash ^ word) * k;
+        }
+    }
+    // a product only carries input bits upwards, fold the high half back down
+    hash ^= hash >> 32;
+    hash *= k;
+    return static_cast<uint32_t>(hash ^ (hash >> 29));
+}
+
+// Method to intern a name
+Name NameTable::intern(std::string_view text) {
+    uint32_t hash = hashName(text);
+
+    // look the name up
+    std::size_t mask = slots.size() - 1;
+    std::size_t index = hash & mask;
+    while (!slots.empty() && slots[index].id != 0) {
+        const Slot& slot = slots[index];
+        if (slot.hash == hash && names[slot.id - 1].view() == text) return names[slot.id - 1];
+        index = (index + 1) & mask;
+    }
+
+    // not kept by the table, the caller keeps the text
+    if (text.empty() || text.size() > NAMES_MAX_LENGTH || used + NAMES_CHUNK_SIZE > budget) {
+        CounterBlock::add(Counters::local().nameOverflows);
+        return Name(text.data(), static_cast<uint32_t>(text.size()), 0, nullptr);
+    }
+
+    // copy the text to the arena
+    if (chunkUsed + text.size() > NAMES_CHUNK_SIZE) {
+        chunks.emplace_back(new char[NAMES_CHUNK_SIZE]);
+        chunkUsed = 0;
+        used += NAMES_CHUNK_SIZE;
+    }
+    char* stored = chunks.back().get() + chunkUsed;
+    memcpy(stored, text.data(), text.size());
+    chunkUsed += text.size();
+    used += NAMES_ENTRY_OVERHEAD;
+
+    names.push_back(Name(stored, static_cast<uint32_t>(text.size()), static_cast<uint32_t>(names.size() + 1), this));
+    if (names.size() * 2 > slots.size()) grow();
+    else slots[index] = Slot{hash, names.back().id};
+    CounterBlock::add(Counters::local().names);
+    return names.back();
+}
+
+// Method to double the lookup
+void NameTable::grow() {
+    std::size_t size = slots.empty() ? NAMES_INITIAL_SLOTS : slots.size() * 2;
+    slots.assign(size, Slot());
+    for (const Name& name : names) {
+        uint32_t hash = hashName(name.view());
+        std::size_t index = hash & (size - 1);
+        while (slots[index].id != 0) index = (index + 1) & (size - 1);
+        slots[index] = Slot{hash, name.id};
+    }
+}
+
+// Method to hash a name
+std::size_t NameHash::operator()(const Name& name) const {
+    return hashName(name.view());
+}
+
+// Method to get the table of the calling thread
+NameTable& NameTable::local() {
+    thread_local NameTable table;
+    return table;
+}
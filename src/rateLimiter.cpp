@@ -0,0 +1,56 @@
+/**
+ * @file rateLimiter.cpp
+ * @brief Implementation of the TokenBucket and RateLimiter classes
+ * @author Martin Mendl <x247581>
+ * @date 18.4.2025
+*/
+
+#include <algorithm>
+#include "rateLimiter.hpp"
+
+// Method to set the rate of the bucket
+void TokenBucket::configure(double rate, double burst) {
+    this->rate = rate;
+    capacity = burst > 0 ? burst : rate;
+    // a burst below one token would never let a message through
+    capacity = std::max(capacity, 1.0);
+    tokens = capacity;
+    refillNs = 0;
+}
+
+// Method to add the tokens earned since the last refill
+void TokenBucket::refill(uint64_t now) {
+    if (refillNs != 0 && now > refillNs) tokens = std::min(capacity, tokens + (now - refillNs) * rate / 1e9);
+    refillNs = std::max(refillNs, now);
+}
+
+// Method to get the time until the cost can be taken
+uint64_t TokenBucket::waitNs(double cost, uint64_t now) {
+    if (!enabled()) return 0;
+    refill(now);
+    // a cost the bucket cannot hold goes once it is full
+    double needed = std::min(cost, capacity);
+    if (tokens >= needed) return 0;
+    return static_cast<uint64_t>((needed - tokens) * 1e9 / rate) + 1;
+}
+
+// Method to set the limits
+void RateLimiter::configure(const RateLimit& limit) {
+    messages.configure(limit.messages, limit.messageBurst);
+    bytes.configure(limit.bytes, limit.byteBurst);
+}
+
+// Method to take a message from both buckets
+bool RateLimiter::take(std::size_t size, uint64_t now) {
+    // nothing is taken unless both have enough, a message never holds tokens of one bucket while it waits for the other
+    if (messages.waitNs(1, now) > 0 || bytes.waitNs(size, now) > 0) return false;
+    if (messages.enabled()) messages.take(1);
+    if (bytes.enabled()) bytes.take(size);
+    return true;
+}
+
+// Method to get the time until a message may go
+int RateLimiter::waitMs(std::size_t size, uint64_t now) {
+    uint64_t wait = std::max(messages.waitNs(1, now), bytes.waitNs(size, now));
+    return static_cast<int>((wait + 999999) / 1000000);
+}
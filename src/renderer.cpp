@@ -0,0 +1,417 @@
+/**
+ * @file renderer.cpp
+ * @brief Implementation of the Renderer class
+ * @author Martin Mendl <x247581>
+ * @date 18.4.2025
+*/
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "renderer.hpp"
+#include "counters.hpp"
+#include "latency.hpp"
+
+bool Renderer::running = false;
+bool Renderer::tty = false;
+Renderer::Buffer Renderer::buffer;
+std::streambuf* Renderer::coutBuf = nullptr;
+std::streambuf* Renderer::cerrBuf = nullptr;
+int Renderer::stdoutFlags = 0;
+std::vector<Renderer::Line> Renderer::lines;
+std::size_t Renderer::head = 0;
+std::size_t Renderer::count = 0;
+std::size_t Renderer::queued = 0;
+std::size_t Renderer::capacity = DISPLAY_DEFAULT_QUEUE;
+DisplayPolicy Renderer::policy = DisplayPolicy::BLOCK;
+std::string Renderer::partial;
+std::string Renderer::out;
+std::size_t Renderer::outOffset = 0;
+std::unordered_map<Name, uint64_t, NameHash> Renderer::suppressed;
+std::deque<KeptName> Renderer::suppressedNames;
+uint64_t Renderer::sampled = 0;
+uint64_t Renderer::summaryNs = 0;
+std::string Renderer::input;
+int Renderer::escape = 0;
+int Renderer::rows = 24;
+int Renderer::cols = 80;
+uint64_t Renderer::frameNs = 1000000000ull / RENDER_DEFAULT_FPS;
+uint64_t Renderer::lastFrameNs = 0;
+
+// terminal settings to restore
+static struct termios saved;
+
+// Method to take a character written to std::cout
+Renderer::Buffer::int_type Renderer::Buffer::overflow(int_type c) {
+    if (c == traits_type::eof()) return traits_type::not_eof(c);
+    if (c == '\n') push(false).swap(partial);
+    else partial.push_back(static_cast<char>(c));
+    return c;
+}
+
+// Method to take a block written to std::cout, every finished line is queued
+std::streamsize Renderer::Buffer::xsputn(const char* data, std::streamsize length) {
+    const char* end = data + length;
+    for (const char* lineEnd; (lineEnd = static_cast<const char*>(memchr(data, '\n', end - data))) != nullptr; data = lineEnd + 1) {
+        partial.append(data, lineEnd - data);
+        push(false).swap(partial);
+    }
+    partial.append(data, end - data);
+    return length;
+}
+
+// Method to take over stdout
+void Renderer::start(int fps, bool terminal, std::size_t capacity, DisplayPolicy policy) {
+    Renderer::capacity = capacity;
+    Renderer::policy = policy;
+
+    // keys arrive one by one and are not echoed, Ctrl+C still raises SIGINT
+    tty = terminal && isatty(STDIN_FILENO) && isatty(STDOUT_FILENO) && tcgetattr(STDIN_FILENO, &saved) == 0;
+    if (tty) {
+        struct termios raw = saved;
+        raw.c_lflag &= ~(ICANON | ECHO);
+        raw.c_cc[VMIN] = 1;
+        raw.c_cc[VTIME] = 0;
+        tty = tcsetattr(STDIN_FILENO, TCSANOW, &raw) == 0;
+    }
+
+    // stdout is written when poll() says so, a full terminal or pipe never blocks the event loop
+    stdoutFlags = fcntl(STDOUT_FILENO, F_GETFL);
+    if (stdoutFlags == -1 || fcntl(STDOUT_FILENO, F_SETFL, stdoutFlags | O_NONBLOCK) == -1) {
+        if (tty) tcsetattr(STDIN_FILENO, TCSANOW, &saved);
+        tty = false;
+        return;
+    }
+
+    frameNs = 1000000000ull / static_cast<uint64_t>(fps);
+    std::cout.flush();
+    std::cerr.flush();
+    coutBuf = std::cout.rdbuf(&buffer);
+
+    // stderr on the same terminal or pipe is non-blocking now as well, it goes through the queue
+    struct stat outStat, errStat;
+    if (fstat(STDOUT_FILENO, &outStat) == 0 && fstat(STDERR_FILENO, &errStat) == 0 &&
+        outStat.st_dev == errStat.st_dev && outStat.st_ino == errStat.st_ino) {
+        cerrBuf = std::cerr.rdbuf(&buffer);
+    }
+    running = true;
+    atexit(finish);
+
+    // a fresh line for the input, the output above stays
+    if (tty) {
+        out.push_back('\n');
+        resize();
+    }
+}
+
+// Method to append a line to the queue
+std::string& Renderer::push(bool received) {
+    // the ring doubles when it is full, the strings keep their capacity
+    if (count == lines.size()) {
+        std::vector<Line> grown(std::max<std::size_t>(64, lines.size() * 2));
+        for (std::size_t i = 0; i < count; ++i) grown[i] = std::move(lines[(head + i) % lines.size()]);
+        lines.swap(grown);
+        head = 0;
+    }
+    Line& line = lines[(head + count) % lines.size()];
+    count++;
+    line.text.clear();
+    line.received = received;
+    line.dropped = false;
+    if (received) queued++;
+    return line.text;
+}
+
+// Method to remove the first line of the queue
+void Renderer::pop() {
+    Line& line = lines[head];
+    if (line.received && !line.dropped) queued--;
+    head = (head + 1) % lines.size();
+    count--;
+}
+
+// Method to drop the oldest queued message
+void Renderer::dropOldest() {
+    while (count > 0 && lines[head].dropped) pop();
+    for (std::size_t i = 0; i < count; ++i) {
+        Line& line = lines[(head + i) % lines.size()];
+        if (!line.received || line.dropped) continue;
+        line.dropped = true;
+        queued--;
+        CounterBlock::add(Counters::local().displayDropped);
+        return;
+    }
+}
+
+// Method to display a received message
+void Renderer::message(const Name& sender, std::string_view content) {
+    if (queued >= capacity) {
+        switch (policy) {
+            case DisplayPolicy::BLOCK:
+                // the event loop stops reading the server until the queue drains
+                break;
+            case DisplayPolicy::DROP_OLDEST:
+                dropOldest();
+                break;
+            case DisplayPolicy::SAMPLE: {
+                // one of DISPLAY_SAMPLE_RATE messages still gets through, the rest are summarised per sender
+                if (sampled++ % DISPLAY_SAMPLE_RATE != 0) {
+                    // an interned handle outlives the message, the text of any other name goes away with it
+                    auto found = suppressed.find(sender);
+                    if (found == suppressed.end()) {
+                        Name key = sender;
+                        if (key.getId() == 0) {
+                            suppressedNames.emplace_back().assign(sender);
+                            key = suppressedNames.back().get();
+                        }
+                        found = suppressed.emplace(key, 0).first;
+                    }
+                    found->second++;
+                    CounterBlock::add(Counters::local().displaySuppressed);
+                    if (summaryNs == 0) summaryNs = monotonicNs() + DISPLAY_SUMMARY_MS * 1000000ull;
+                    return;
+                }
+                dropOldest();
+                break;
+            }
+        }
+    }
+    push(true).append(sender.view()).append(": ").append(content);
+}
+
+// Method to queue the suppressed summaries
+void Renderer::summarise() {
+    for (const auto& [sender, messages] : suppressed) {
+        push(false).append(std::to_string(messages)).append(" messages from ").append(sender.view()).append(" suppressed");
+    }
+    suppressed.clear();
+    suppressedNames.clear();
+    summaryNs = 0;
+}
+
+// Method to check if stdout has to be polled
+bool Renderer::wantsWrite() {
+    return running && (outOffset < out.size() || (!tty && count > 0));
+}
+
+// Method to write when stdout is writable
+void Renderer::writable() {
+    if (!running) return;
+    do {
+        if (!tty) fill();
+        flush();
+    } while (!tty && count > 0 && outOffset >= out.size());
+}
+
+// Method to move queued lines to the output
+void Renderer::fill() {
+    if (outOffset > 0) {
+        out.erase(0, outOffset);
+        outOffset = 0;
+    }
+    while (count > 0 && out.size() < DISPLAY_WRITE_SIZE) {
+        const Line& line = lines[head];
+        if (!line.dropped) out.append(line.text).push_back('\n');
+        pop();
+    }
+}
+
+// Method to edit the input line
+bool Renderer::type(const char* data, std::size_t length, std::deque<std::string>& lines) {
+    std::size_t echoFrom = input.size();
+    bool redraw = false, eof = false;
+
+    for (std::size_t i = 0; i < length; ++i) {
+        unsigned char c = static_cast<unsigned char>(data[i]);
+
+        // arrows and other special keys are not supported, their sequences are dropped
+        if (escape != 0) {
+            if (escape == 1) escape = c == '[' ? 2 : (c == 'O' ? 3 : 0);
+            else if (escape == 3 || (c >= 0x40 && c <= 0x7E)) escape = 0;
+            continue;
+        }
+
+        switch (c) {
+            case '\r':
+            case '\n':
+                // the sent line stays visible, like the terminal echo used to leave it
+                push(false).append(RENDER_PROMPT).append(input);
+                if (!input.empty()) lines.push_back(input);
+                input.clear();
+                redraw = true;
+                break;
+            case 0x7F: // backspace, a whole UTF-8 character
+            case 0x08:
+                while (!input.empty() && (static_cast<unsigned char>(input.back()) & 0xC0) == 0x80) input.pop_back();
+                if (!input.empty()) input.pop_back();
+                redraw = true;
+                break;
+            case 0x15: // Ctrl+U
+                input.clear();
+                redraw = true;
+                break;
+            case 0x04: // Ctrl+D
+                if (input.empty()) eof = true;
+                break;
+            case 0x1B:
+                escape = 1;
+                break;
+            case '\t':
+                input.push_back(' ');
+                break;
+            default:
+                if (c >= 0x20) input.push_back(static_cast<char>(c));
+        }
+    }
+
+    // typing at the end of a line that fits is echoed as is, anything else redraws the line
+    std::size_t width = cols - sizeof(RENDER_PROMPT);
+    if (redraw || input.size() > width) appendInput();
+    else if (input.size() > echoFrom) out.append(input, echoFrom, std::string::npos);
+    flush();
+    return !eof;
+}
+
+// Method to get the time until the next frame or summary
+int Renderer::timeoutMs() {
+    if (!running) return -1;
+    uint64_t due = summaryNs;
+
+    // a frame waits for the previous one to be written
+    if (tty && count > 0 && outOffset >= out.size()) {
+        uint64_t frameDue = lastFrameNs + frameNs;
+        due = due == 0 ? frameDue : std::min(due, frameDue);
+    }
+    if (due == 0) return -1;
+    uint64_t now = monotonicNs();
+    if (now >= due) return 0;
+    return static_cast<int>((due - now + 999999) / 1000000);
+}
+
+// Method to write the summaries and the queue
+void Renderer::frame() {
+    if (!running) return;
+    uint64_t now = monotonicNs();
+    if (summaryNs != 0 && now >= summaryNs) summarise();
+
+    if (!tty) {
+        fill();
+        flush();
+        return;
+    }
+    if (count == 0 || outOffset < out.size() || now < lastFrameNs + frameNs) return;
+    lastFrameNs = now;
+    draw();
+    flush();
+}
+
+// Method to draw the queued lines
+void Renderer::draw() {
+    // only the lines the region can show, the older ones would scroll out in this frame anyway
+    std::size_t region = static_cast<std::size_t>(rows - 1), kept = 0;
+    for (std::size_t i = 0; i < count; ++i) kept += !lines[(head + i) % lines.size()].dropped;
+    std::size_t skipped = kept > region ? kept - region : 0;
+    if (skipped > 0) CounterBlock::add(Counters::local().linesSkipped, skipped);
+
+    // each line scrolls the region by one (a long line wraps, it is cut at a screen)
+    std::size_t maxLine = static_cast<std::size_t>(cols) * region;
+    out.append("\x1b[").append(std::to_string(rows - 1)).append(";1H");
+    for (std::size_t drawn = 0; count > 0; pop()) {
+        const Line& line = lines[head];
+        if (line.dropped) continue;
+        if (drawn++ < skipped) continue;
+        out.push_back('\n');
+        out.append(line.text, 0, std::min(line.text.size(), maxLine));
+    }
+
+    out.append("\x1b[").append(std::to_string(rows)).append(";1H");
+    appendInput();
+    CounterBlock::add(Counters::local().framesDrawn);
+}
+
+// Method to append the input line to the output
+void Renderer::appendInput() {
+    out.append("\r\x1b[K").append(RENDER_PROMPT);
+
+    // the end of a long line, not cutting a UTF-8 character
+    std::size_t width = cols - sizeof(RENDER_PROMPT);
+    std::size_t start = input.size() > width ? input.size() - width : 0;
+    while (start < input.size() && (static_cast<unsigned char>(input[start]) & 0xC0) == 0x80) start++;
+    out.append(input, start, std::string::npos);
+}
+
+// Method to write the output until stdout would block
+void Renderer::flush() {
+    while (outOffset < out.size()) {
+        ssize_t n = ::write(STDOUT_FILENO, out.data() + outOffset, out.size() - outOffset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+        // nobody reads the output any more, it is not kept
+        if (n <= 0) break;
+        outOffset += static_cast<std::size_t>(n);
+    }
+    out.clear();
+    outOffset = 0;
+}
+
+// Method to write the output, waiting for stdout
+void Renderer::flushBlocking() {
+    while (outOffset < out.size()) {
+        flush();
+        if (outOffset >= out.size()) break;
+        struct pollfd pfd = {STDOUT_FILENO, POLLOUT, 0};
+        if (poll(&pfd, 1, -1) == -1 && errno != EINTR) break;
+    }
+    out.clear();
+    outOffset = 0;
+}
+
+// Method to adapt to the terminal size
+void Renderer::resize() {
+    if (!running || !tty) return;
+    struct winsize size;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 && size.ws_row >= 2 && size.ws_col >= sizeof(RENDER_PROMPT) + 1) {
+        rows = size.ws_row;
+        cols = size.ws_col;
+    }
+
+    // the scroll region is everything above the input line
+    out.append("\x1b[1;").append(std::to_string(rows - 1)).append("r");
+    out.append("\x1b[").append(std::to_string(rows)).append(";1H");
+    appendInput();
+    flush();
+}
+
+// Method to give stdout back
+void Renderer::finish() {
+    if (!running) return;
+    if (!partial.empty()) push(false).swap(partial);
+    if (!suppressed.empty()) summarise();
+
+    // everything left is written, even to a slow reader
+    if (tty) {
+        if (count > 0) draw();
+        // the whole screen scrolls again, the cursor ends on the emptied input line
+        out.append("\x1b[r\x1b[").append(std::to_string(rows)).append(";1H\x1b[K");
+        flushBlocking();
+        tcsetattr(STDIN_FILENO, TCSANOW, &saved);
+    } else {
+        do {
+            fill();
+            flushBlocking();
+        } while (count > 0);
+    }
+    fcntl(STDOUT_FILENO, F_SETFL, stdoutFlags);
+    running = false;
+
+    std::cout.rdbuf(coutBuf);
+    if (cerrBuf != nullptr) std::cerr.rdbuf(cerrBuf);
+}
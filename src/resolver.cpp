@@ -0,0 +1,200 @@
+/**
+ * @file resolver.cpp
+ * @brief Implementation of the Resolver class
+ * @author Martin Mendl <x247581>
+ * @date 18.4.2025
+*/
+
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+#include <netdb.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include "resolver.hpp"
+
+// function to check for an address literal (no lookup, not worth caching)
+static bool isLiteral(const std::string& host) {
+    struct in6_addr address;
+    return inet_pton(AF_INET, host.c_str(), &address) == 1 || inet_pton(AF_INET6, host.c_str(), &address) == 1;
+}
+
+// Destructor for Resolver
+Resolver::~Resolver() {
+    if (worker.joinable()) worker.join();
+}
+
+// Method to start the lookup
+void Resolver::start(const std::string& host, uint16_t port) {
+    if (worker.joinable()) worker.join();
+    this->host = host;
+    hostPort = port;
+    results.clear();
+    failure.clear();
+    cached.clear();
+    cacheHit = false;
+
+    bool expired = false;
+    if (!isLiteral(host) && !cachePath.empty() && readCache(cached, expired)) {
+        cacheHit = true;
+        if (!expired) return; // fresh entry, nothing to look up
+    }
+    // a miss is waited for, an expired hit is refreshed behind the connect
+    worker = std::thread(&Resolver::run, this);
+}
+
+// Method to wait for the lookup
+bool Resolver::wait(std::vector<sockaddr_storage>& addresses, std::string& error) {
+    if (cacheHit) {
+        addresses = cached;
+        error.clear();
+        return true;
+    }
+    if (worker.joinable()) worker.join();
+    addresses = results;
+    error = failure;
+    return !addresses.empty();
+}
+
+// Method to get fresh addresses after the cached ones failed
+bool Resolver::refresh(std::vector<sockaddr_storage>& addresses, std::string& error) {
+    if (!cacheHit) return false;
+    cacheHit = false;
+
+    // an expired entry is being refreshed already, a fresh one is looked up now
+    if (worker.joinable()) worker.join();
+    else run();
+    addresses = results;
+    error = failure;
+    return !addresses.empty();
+}
+
+// Method to resolve the name (lookup thread)
+void Resolver::run() {
+    struct addrinfo hints{}, *res;
+    hints.ai_family = AF_UNSPEC; // A and AAAA
+    // one entry per address (the transport does not matter); no AI_ADDRCONFIG, it drops
+    // loopback-only setups, a family without a route fails its attempt right away anyway
+    hints.ai_socktype = SOCK_STREAM;
+
+    int status = getaddrinfo(host.c_str(), nullptr, &hints, &res);
+    if (status != 0) {
+        failure = gai_strerror(status);
+        return;
+    }
+
+    // getaddrinfo sorted by RFC 6724, keep that order within each family
+    std::vector<sockaddr_storage> byFamily[2];
+    int firstFamily = res->ai_family;
+    for (struct addrinfo* p = res; p != nullptr; p = p->ai_next) {
+        if (p->ai_family != AF_INET && p->ai_family != AF_INET6) continue;
+        sockaddr_storage address{};
+        memcpy(&address, p->ai_addr, p->ai_addrlen);
+        setPort(address, hostPort);
+        byFamily[p->ai_family == firstFamily ? 0 : 1].push_back(address);
+    }
+    freeaddrinfo(res);
+
+    // interleave the families, so a broken one costs one attempt delay, not one per address
+    for (std::size_t i = 0; i < byFamily[0].size() || i < byFamily[1].size(); ++i) {
+        if (i < byFamily[0].size()) results.push_back(byFamily[0][i]);
+        if (i < byFamily[1].size()) results.push_back(byFamily[1][i]);
+    }
+    if (results.empty()) failure = "no IPv4 or IPv6 address";
+
+    // a failed lookup keeps the old entry, the cached addresses may still work next time
+    if (!isLiteral(host) && !cachePath.empty() && !results.empty()) writeCache(results);
+}
+
+/*
+The cache is a text file with one line per host name:
+    <host> <expires (unix seconds)> <address> [<address> ...]
+in connection order, without ports (the port comes from -p).
+*/
+
+// Method to read the host's entry from the cache
+bool Resolver::readCache(std::vector<sockaddr_storage>& entry, bool& expired) {
+    std::ifstream file(cachePath);
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream fields(line);
+        std::string name, ip;
+        long long expires;
+        if (!(fields >> name >> expires) || name != host) continue;
+
+        entry.clear();
+        while (fields >> ip) {
+            sockaddr_storage address{};
+            sockaddr_in* ipv4 = reinterpret_cast<sockaddr_in*>(&address);
+            sockaddr_in6* ipv6 = reinterpret_cast<sockaddr_in6*>(&address);
+            if (inet_pton(AF_INET, ip.c_str(), &ipv4->sin_addr) == 1) address.ss_family = AF_INET;
+            else if (inet_pton(AF_INET6, ip.c_str(), &ipv6->sin6_addr) == 1) address.ss_family = AF_INET6;
+            else continue;
+            setPort(address, hostPort);
+            entry.push_back(address);
+        }
+        expired = expires <= static_cast<long long>(time(nullptr));
+        return !entry.empty();
+    }
+    return false;
+}
+
+// Method to replace the host's entry in the cache
+void Resolver::writeCache(const std::vector<sockaddr_storage>& addresses) {
+    std::ostringstream content;
+
+    // other hosts stay as they are
+    std::ifstream old(cachePath);
+    std::string line, name;
+    while (std::getline(old, line)) {
+        std::istringstream fields(line);
+        if (fields >> name && name != host) content << line << "\n";
+    }
+    old.close();
+
+    content << host << " " << static_cast<long long>(time(nullptr)) + cacheTtl;
+    for (const sockaddr_storage& address : addresses) {
+        char ip[INET6_ADDRSTRLEN] = "";
+        if (address.ss_family == AF_INET6) inet_ntop(AF_INET6, &reinterpret_cast<const sockaddr_in6&>(address).sin6_addr, ip, sizeof(ip));
+        else inet_ntop(AF_INET, &reinterpret_cast<const sockaddr_in&>(address).sin_addr, ip, sizeof(ip));
+        content << " " << ip;
+    }
+    content << "\n";
+
+    // clients starting at the same time must never read a half-written file
+    std::string temporary = cachePath + "." + std::to_string(getpid());
+    std::ofstream file(temporary, std::ios::trunc);
+    file << content.str();
+    file.close();
+    if (!file || rename(temporary.c_str(), cachePath.c_str()) != 0) unlink(temporary.c_str());
+}
+
+// Method to get the size of an address
+socklen_t Resolver::length(const sockaddr_storage& address) {
+    return address.ss_family == AF_INET6 ? sizeof(sockaddr_in6) : sizeof(sockaddr_in);
+}
+
+// Method to get the port of an address
+uint16_t Resolver::port(const sockaddr_storage& address) {
+    if (address.ss_family == AF_INET6) return ntohs(reinterpret_cast<const sockaddr_in6&>(address).sin6_port);
+    return ntohs(reinterpret_cast<const sockaddr_in&>(address).sin_port);
+}
+
+// Method to set the port of an address
+void Resolver::setPort(sockaddr_storage& address, uint16_t port) {
+    if (address.ss_family == AF_INET6) reinterpret_cast<sockaddr_in6&>(address).sin6_port = htons(port);
+    else reinterpret_cast<sockaddr_in&>(address).sin_port = htons(port);
+}
+
+// Method to format an address
+std::string Resolver::toString(const sockaddr_storage& address) {
+    char ip[INET6_ADDRSTRLEN] = "";
+    if (address.ss_family == AF_INET6) {
+        inet_ntop(AF_INET6, &reinterpret_cast<const sockaddr_in6&>(address).sin6_addr, ip, sizeof(ip));
+        return "[" + std::string(ip) + "]:" + std::to_string(port(address));
+    }
+    inet_ntop(AF_INET, &reinterpret_cast<const sockaddr_in&>(address).sin_addr, ip, sizeof(ip));
+    return std::string(ip) + ":" + std::to_string(port(address));
+}
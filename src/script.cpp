@@ -0,0 +1,135 @@
+/**
+ * @file script.cpp
+ * @brief Implementation of the Script class
+ * @author Martin Mendl <x247581>
+ * @date 18.4.2025
+*/
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "script.hpp"
+
+// Destructor for Script
+Script::~Script() {
+    close();
+}
+
+// Method to unmap the file
+void Script::close() {
+    if (data != nullptr) munmap(const_cast<char*>(data), size);
+    data = nullptr;
+    size = offset = lines = sentOffset = sentLines = 0;
+    startNs = lastReportNs = 0;
+    finished = false;
+}
+
+// Method to map the script
+std::string Script::open(const std::string& path, bool messages, int rate) {
+    close();
+    this->messages = messages;
+    interval = rate > 0 ? 1000000000ull / rate : 0;
+    dueNs = 0;
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return strerror(errno);
+    struct stat info;
+    if (fstat(fd, &info) < 0) {
+        std::string error = strerror(errno);
+        ::close(fd);
+        return error;
+    }
+
+    // an empty script is done before it starts (and cannot be mapped)
+    size = info.st_size;
+    if (size == 0) {
+        ::close(fd);
+        return "";
+    }
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        size = 0;
+        return strerror(errno);
+    }
+    madvise(mapped, size, MADV_SEQUENTIAL);
+    data = static_cast<const char*>(mapped);
+    return "";
+}
+
+// Method to get the next line
+bool Script::next(std::string_view& line) {
+    if (offset >= size) return false;
+    uint64_t now = monotonicNs();
+    if (lines == 0) startNs = lastReportNs = dueNs = now;
+    if (interval > 0) {
+        // a stalled sender catches up a little, not with a burst of everything it missed
+        uint64_t earliest = now > SCRIPT_CATCH_UP_MS * 1000000ull ? now - SCRIPT_CATCH_UP_MS * 1000000ull : 0;
+        dueNs = std::max(dueNs, earliest) + interval;
+    }
+
+    const char* start = data + offset;
+    const char* end = static_cast<const char*>(memchr(start, '\n', size - offset));
+    uint64_t length = end != nullptr ? end - start : size - offset;
+
+    // a line too long for one message goes as several, the line break stays for the last one
+    if (messages && length > SCRIPT_MESSAGE_MAX) {
+        length = SCRIPT_MESSAGE_MAX;
+        offset += length;
+    } else {
+        offset += length + (end != nullptr ? 1 : 0);
+        // CRLF scripts
+        if (length > 0 && start[length - 1] == '\r') length--;
+    }
+    line = std::string_view(start, length);
+    lines++;
+    if (!messages) return true;
+
+    // a content is printable ASCII and spaces, anything else would break the framing or be refused
+    std::size_t bad = 0;
+    while (bad < line.size() && line[bad] >= 0x20 && line[bad] <= 0x7E) bad++;
+    if (bad == line.size()) return true;
+    scratch.assign(line);
+    for (char& c : scratch) {
+        if (c == '\t') c = ' ';
+        else if (c < 0x20 || c > 0x7E) c = '?';
+    }
+    line = scratch;
+    return true;
+}
+
+// Method to hand out the lines that were not sent again
+void Script::rewind() {
+    if (lines == sentLines) return;
+    offset = sentOffset;
+    lines = sentLines;
+    finished = false;
+}
+
+// Method to get the time until the next line is due
+int Script::dueMs() const {
+    if (!pending()) return -1;
+    uint64_t now = monotonicNs();
+    if (interval == 0 || dueNs <= now) return 0;
+    return static_cast<int>((dueNs - now + 999999) / 1000000);
+}
+
+// Method to print the progress
+void Script::report(std::ostream& out) {
+    if (finished || lines == 0) return;
+    uint64_t now = monotonicNs();
+    bool done = offset >= size;
+    if (!done && now - lastReportNs < SCRIPT_REPORT_MS * 1000000ull) return;
+    lastReportNs = now;
+
+    double seconds = (now - startNs) / 1e9;
+    out << (messages ? "sendfile: " : "script: ") << (done ? "done, " : "") << lines << (messages ? " messages, " : " lines, ") << std::fixed << std::setprecision(1)
+        << offset / 1e6 << "/" << size / 1e6 << " MB (" << std::setprecision(0) << 100.0 * offset / size << "%) in "
+        << std::setprecision(2) << seconds << " s, " << std::setprecision(0) << (seconds > 0 ? lines / seconds : 0.0) << (messages ? " messages/s, " : " lines/s, ")
+        << std::setprecision(1) << (seconds > 0 ? offset / seconds / 1e6 : 0.0) << " MB/s\n" << std::flush;
+    finished = done;
+}
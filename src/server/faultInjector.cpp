@@ -0,0 +1,43 @@
+/**
+ * @file faultInjector.cpp
+ * @brief Implementation of the FaultInjector class
+ * @author Martin Mendl <x247581>
+ * @date 18.4.2025
+*/
+
+#include "server.hpp"
+
+// Constructor, every stream gets its own reproducible sequence
+FaultInjector::FaultInjector(const ServerSettings& settings, uint64_t stream) {
+    // splitmix style mixing, so neighbouring streams do not correlate
+    uint64_t seed = settings.getSeed() + 0x9E3779B97F4A7C15ULL * (stream + 1);
+    seed = (seed ^ (seed >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    seed = (seed ^ (seed >> 27)) * 0x94D049BB133111EBULL;
+    generator.seed(seed ^ (seed >> 31));
+
+    loss = settings.getLoss();
+    duplication = settings.getDuplication();
+    delayMs = settings.getDelay();
+    jitterMs = settings.getJitter();
+}
+
+// Method to decide, if a datagram is lost
+bool FaultInjector::drop() {
+    if (loss <= 0.0) return false; // do not consume randomness when disabled
+    return unit(generator) < loss;
+}
+
+// Method to decide, if a datagram is duplicated
+bool FaultInjector::duplicate() {
+    if (duplication <= 0.0) return false;
+    return unit(generator) < duplication;
+}
+
+// Method to get the delay of the next message
+uint64_t FaultInjector::delayNs() {
+    uint64_t delay = static_cast<uint64_t>(delayMs) * 1000000ULL;
+    if (jitterMs > 0) {
+        delay += static_cast<uint64_t>(unit(generator) * jitterMs * 1000000.0);
+    }
+    return delay;
+}
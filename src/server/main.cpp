@@ -0,0 +1,26 @@
+/**
+ * @file main.cpp
+ * @brief Main file for the reference chat server
+ * @author Martin Mendl <x247581>
+ * @date 18.4.2025
+ */
+
+#include <iostream>
+#include <stdexcept>
+#include "serverSettings.hpp"
+#include "server.hpp"
+
+int main(int argc, char* argv[]) {
+    try {
+        ServerSettings settings(argc, argv);
+        if (settings.isVerbose()) settings.representSettings();
+
+        Server server(settings);
+        server.run();
+    }
+    catch (const std::exception& e) {
+        std::cerr << "ERROR: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,222 @@
+/**
+ * @file server.cpp
+ * @brief Implementation of the Server class (accept loop and UDP welcome socket)
+ * @author Martin Mendl <x247581>
+ * @date 18.4.2025
+*/
+
+#include <iostream>
+#include <string>
+#include <functional>
+#include <cstring>
+#include <csignal>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "server.hpp"
+
+#define LISTEN_BACKLOG 1024
+
+// Constructor for Server
+Server::Server(const ServerSettings& settings) : settings(settings), faults(settings, settings.getWorkers()) {
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(settings.getPort());
+    if (inet_pton(AF_INET, settings.getListenIp().c_str(), &addr.sin_addr) <= 0) {
+        throw std::invalid_argument("Invalid listen address: " + settings.getListenIp());
+    }
+
+    // TCP listener
+    tcpFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (tcpFd < 0) {
+        throw std::runtime_error(std::string("failed to set up the TCP listener: ") + strerror(errno));
+    }
+    int one = 1;
+    setsockopt(tcpFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(tcpFd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(tcpFd, LISTEN_BACKLOG) < 0) {
+        throw std::runtime_error(std::string("failed to set up the TCP listener: ") + strerror(errno));
+    }
+
+    // UDP welcome socket
+    udpFd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    if (udpFd < 0 || bind(udpFd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        throw std::runtime_error(std::string("failed to set up the UDP welcome socket: ") + strerror(errno));
+    }
+
+    // SIGINT/SIGTERM are read through a signalfd, workers inherit the blocked mask
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+    signalFd = signalfd(-1, &mask, SFD_NONBLOCK);
+
+    buffer = (char *)malloc(sizeof(char) * BUFFER_SIZE);
+
+    for (unsigned i = 0; i < settings.getWorkers(); ++i) {
+        workers.push_back(std::make_unique<Worker>(*this, i, settings));
+    }
+}
+
+// Destructor for Server
+Server::~Server() {
+    for (auto& worker : workers) worker->stop();
+    workers.clear();
+    close(tcpFd);
+    close(udpFd);
+    close(signalFd);
+    free(buffer);
+}
+
+// Method to get the worker owning a channel
+Worker& Server::ownerOf(const std::string& channel) {
+    return *workers[std::hash<std::string>{}(channel) % workers.size()];
+}
+
+// Method to build a key of a UDP peer
+uint64_t Server::peerKey(const sockaddr_in& peer) {
+    return static_cast<uint64_t>(peer.sin_addr.s_addr) << 16 | peer.sin_port;
+}
+
+// Method to forget a UDP peer
+void Server::forgetPeer(const sockaddr_in& peer) {
+    std::lock_guard<std::mutex> lock(peersMutex);
+    knownPeers.erase(peerKey(peer));
+}
+
+// Method to log a line
+void Server::log(const std::string& line) {
+    if (!settings.isVerbose()) return;
+    std::lock_guard<std::mutex> lock(logMutex);
+    std::cout << "[SERVER] " << line << "\n" << std::flush;
+}
+
+// Main loop of the server (accepting clients)
+void Server::run() {
+    for (auto& worker : workers) worker->start();
+
+    int epollFd = epoll_create1(0);
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = tcpFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, tcpFd, &event);
+    event.data.fd = udpFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, udpFd, &event);
+    event.data.fd = signalFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, signalFd, &event);
+
+    std::cout << "Listening on " << settings.getListenIp() << ":" << settings.getPort()
+              << " (tcp + udp) with " << workers.size() << " worker(s)\n" << std::flush;
+
+    epoll_event events[3];
+    bool running = true;
+    while (running) {
+        int ready = epoll_wait(epollFd, events, 3, -1);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait");
+            break;
+        }
+        for (int i = 0; i < ready; ++i) {
+            if (events[i].data.fd == tcpFd) acceptTcp();
+            if (events[i].data.fd == udpFd) receiveWelcome();
+            if (events[i].data.fd == signalFd) running = false;
+        }
+    }
+
+    close(epollFd);
+    for (auto& worker : workers) worker->stop();
+}
+
+// Method to accept new TCP clients
+void Server::acceptTcp() {
+    while (true) {
+        int fd = accept4(tcpFd, nullptr, nullptr, SOCK_NONBLOCK);
+        if (fd < 0) return; // EAGAIN, everything accepted
+
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        auto session = std::make_unique<Session>();
+        session->id = nextSessionId();
+        session->transport = Mode::TCP;
+        session->fd = fd;
+        log("tcp session " + std::to_string(session->id) + " connected");
+
+        // not in any channel yet, spread the fresh sessions
+        Worker& worker = *workers[nextWorker++ % workers.size()];
+        worker.adopt(std::move(session));
+    }
+}
+
+// Method to handle datagrams on the welcome port
+void Server::receiveWelcome() {
+    while (true) {
+        sockaddr_in peer{};
+        socklen_t peerLen = sizeof(peer);
+        ssize_t received = recvfrom(udpFd, buffer, BUFFER_SIZE, 0, (sockaddr*)&peer, &peerLen);
+        if (received < 0) return;
+        if (received < 3) continue;
+
+        std::string datagram(buffer, received);
+        uint8_t type = static_cast<uint8_t>(datagram[0]);
+        uint16_t msgId = static_cast<uint16_t>(static_cast<uint8_t>(datagram[1])) << 8
+                       | static_cast<uint16_t>(static_cast<uint8_t>(datagram[2]));
+
+        // only AUTH opens a session
+        if (type != 0x02) continue;
+
+        // confirm from the welcome port, retransmitted AUTHs get confirmed again
+        if (!faults.drop()) {
+            std::string confirm = MessageConfirm(msgId).getUDPMsg();
+            sendto(udpFd, confirm.data(), confirm.size(), 0, (sockaddr*)&peer, sizeof(peer));
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(peersMutex);
+            if (!knownPeers.insert(peerKey(peer)).second) continue; // duplicate
+        }
+
+        UDPMessages factory(nullptr);
+        MessagePtr parsed = factory.readResponse(datagram);
+        MessageAuth* auth = dynamic_cast<MessageAuth*>(parsed.get());
+        if (auth == nullptr) {
+            forgetPeer(peer);
+            continue;
+        }
+
+        // dedicated socket on a dynamic port
+        int fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+        sockaddr_in local{};
+        local.sin_family = AF_INET;
+        local.sin_port = 0;
+        inet_pton(AF_INET, settings.getListenIp().c_str(), &local.sin_addr);
+        if (fd < 0 || bind(fd, (sockaddr*)&local, sizeof(local)) < 0) {
+            perror("bind");
+            if (fd >= 0) close(fd);
+            forgetPeer(peer);
+            continue;
+        }
+
+        auto session = std::make_unique<Session>();
+        session->id = nextSessionId();
+        session->transport = Mode::UDP;
+        session->fd = fd;
+        session->peer = peer;
+        session->displayName = auth->getDisplayName();
+        session->authenticated = true;
+        session->channel = "default";
+        session->replyPending = true;
+        session->replyRefId = msgId;
+        session->replyContent = "Auth success.";
+        session->seen[msgId] = true;
+
+        log("udp session " + std::to_string(session->id) + " authenticated as " + session->displayName);
+        ownerOf(session->channel).adopt(std::move(session));
+    }
+}
@@ -0,0 +1,166 @@
+/**
+ * @file serverSettings.cpp
+ * @brief Implementation of the ServerSettings class
+ * @author Martin Mendl <x247581>
+ * @date 18.4.2025
+*/
+#include <iostream>
+#include <string>
+#include <stdexcept>
+#include <cstdlib>
+#include <thread>
+#include "serverSettings.hpp"
+#include "settings.hpp"
+
+// constructor for server settings class (argument parser)
+ServerSettings::ServerSettings(int argc, char* argv[]) {
+
+    listenIp = "0.0.0.0";         // all interfaces by default
+    port = 4567;                  // default port
+    workers = std::max(1u, std::thread::hardware_concurrency());
+    udpTimeoutConfirmation = 250; // default timeout
+    maxUdpRetransmissions = 3;    // default max retransmissions
+    pingInterval = 0;             // no pings by default
+    loss = 0.0;
+    duplication = 0.0;
+    delay = 0;
+    jitter = 0;
+    seed = 1;                     // fixed seed, runs are reproducible by default
+    verbose = false;
+
+    // parse args
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+
+        // listen address
+        if (arg == "-l" && i + 1 < argc) {
+            listenIp = argv[++i];
+            if (determinTargetType(listenIp) != TargetType::IP_v4) {
+                throw std::invalid_argument("Invalid listen address: " + listenIp);
+            }
+            continue;
+        }
+
+        // port
+        if (arg == "-p" && i + 1 < argc) {
+            port = static_cast<uint16_t>(std::stoi(argv[++i]));
+            continue;
+        }
+
+        // worker threads
+        if (arg == "-w" && i + 1 < argc) {
+            int value = std::stoi(argv[++i]);
+            if (value < 1) throw std::invalid_argument("Invalid value for -w. Expected at least 1 worker.");
+            workers = static_cast<unsigned>(value);
+            continue;
+        }
+
+        // udp timeout
+        if (arg == "-d" && i + 1 < argc) {
+            udpTimeoutConfirmation = static_cast<uint16_t>(std::stoi(argv[++i]));
+            continue;
+        }
+
+        // udp retransmition
+        if (arg == "-r" && i + 1 < argc) {
+            maxUdpRetransmissions = static_cast<uint8_t>(std::stoi(argv[++i]));
+            continue;
+        }
+
+        // ping interval
+        if (arg == "--ping" && i + 1 < argc) {
+            pingInterval = std::stoi(argv[++i]);
+            continue;
+        }
+
+        // datagram loss
+        if (arg == "--loss" && i + 1 < argc) {
+            loss = parseProbability(arg, argv[++i]);
+            continue;
+        }
+
+        // datagram duplication
+        if (arg == "--dup" && i + 1 < argc) {
+            duplication = parseProbability(arg, argv[++i]);
+            continue;
+        }
+
+        // fixed delay
+        if (arg == "--delay" && i + 1 < argc) {
+            delay = std::stoi(argv[++i]);
+            continue;
+        }
+
+        // random jitter
+        if (arg == "--jitter" && i + 1 < argc) {
+            jitter = std::stoi(argv[++i]);
+            continue;
+        }
+
+        // seed
+        if (arg == "--seed" && i + 1 < argc) {
+            seed = std::stoull(argv[++i]);
+            continue;
+        }
+
+        // verbose
+        if (arg == "-v") {
+            verbose = true;
+            continue;
+        }
+
+        // help
+        if (arg == "-h") {
+            printHelp();
+            std::exit(0);
+        }
+
+        // invalid argument
+        throw std::invalid_argument("Unknown or malformed argument: " + arg);
+    }
+
+    if (delay < 0 || jitter < 0 || pingInterval < 0) {
+        throw std::invalid_argument("Delay, jitter and ping interval can not be negative.");
+    }
+}
+
+// method to parse a probability in the <0, 1> range
+double ServerSettings::parseProbability(const std::string& arg, const std::string& value) const {
+    double probability = std::stod(value);
+    if (probability < 0.0 || probability > 1.0) {
+        throw std::invalid_argument("Invalid value for " + arg + ". Expected a number between 0 and 1.");
+    }
+    return probability;
+}
+
+// method to represent the settings
+void ServerSettings::representSettings() const {
+    std::cout << "Server settings:\n"
+              << "  Listen: " << listenIp << ":" << port << " (tcp + udp)\n"
+              << "  Workers: " << workers << "\n"
+              << "  UDP Timeout Confirmation: " << udpTimeoutConfirmation << " ms\n"
+              << "  Max UDP Retransmissions: " << maxUdpRetransmissions << "\n"
+              << "  Ping Interval: " << pingInterval << " ms\n"
+              << "  Loss: " << loss << ", Duplication: " << duplication << "\n"
+              << "  Delay: " << delay << " ms (+ up to " << jitter << " ms jitter)\n"
+              << "  Seed: " << seed << "\n" << std::flush;
+}
+
+// method to print help
+void ServerSettings::printHelp() const {
+    std::cout << "Usage: ipk25chat-server [options]\n"
+              << "Options:\n"
+              << "  -l <address>       IPv4 address to listen on (default: 0.0.0.0)\n"
+              << "  -p <port>          Port for both TCP and UDP (default: 4567)\n"
+              << "  -w <workers>       Number of worker threads (default: number of cores)\n"
+              << "  -d <timeout>       UDP confirmation timeout in milliseconds (default: 250)\n"
+              << "  -r <retries>       Maximum number of UDP retransmissions (default: 3)\n"
+              << "  --ping <ms>        Interval between UDP pings, 0 disables (default: 0)\n"
+              << "  --loss <p>         Probability of dropping an outgoing datagram (default: 0)\n"
+              << "  --dup <p>          Probability of duplicating an outgoing datagram (default: 0)\n"
+              << "  --delay <ms>       Delay added to every outgoing message (default: 0)\n"
+              << "  --jitter <ms>      Maximum random jitter on top of the delay (default: 0)\n"
+              << "  --seed <n>         Seed of the fault injection (default: 1)\n"
+              << "  -v                 Log every handled message\n"
+              << "  -h                 Prints this help message and exits\n" << std::flush;
+}
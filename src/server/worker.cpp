@@ -0,0 +1,629 @@
+/**
+ * @file worker.cpp
+ * @brief Implementation of the Worker class (one shard of channels)
+ * @author Martin Mendl <x247581>
+ * @date 18.4.2025
+*/
+
+#include <iostream>
+#include <string>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include "server.hpp"
+
+#define WORKER_EVENTS 64
+#define WAKE_ID 0
+
+// function to get the monotonic time in nanoseconds
+static uint64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Constructor for Worker
+Worker::Worker(Server& server, unsigned index, const ServerSettings& settings)
+    : server(server), index(index), settings(settings), faults(settings, index) {
+
+    epollFd = epoll_create1(0);
+    wakeFd = eventfd(0, EFD_NONBLOCK);
+    if (epollFd < 0 || wakeFd < 0) {
+        throw std::runtime_error("failed to create the worker epoll");
+    }
+
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.u64 = WAKE_ID;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event);
+
+    buffer = (char *)malloc(sizeof(char) * BUFFER_SIZE);
+}
+
+// Destructor for Worker
+Worker::~Worker() {
+    stop();
+    for (auto& entry : sessions) close(entry.second->fd);
+    for (auto& session : inbox) close(session->fd);
+    close(wakeFd);
+    close(epollFd);
+    free(buffer);
+}
+
+// Method to start the worker thread
+void Worker::start() {
+    running = true;
+    thread = std::thread(&Worker::run, this);
+}
+
+// Method to stop the worker thread
+void Worker::stop() {
+    if (!thread.joinable()) return;
+    running = false;
+    uint64_t one = 1;
+    if (write(wakeFd, &one, sizeof(one)) < 0) perror("write");
+    thread.join();
+}
+
+// Method to hand a session over to this worker, called from other threads
+void Worker::adopt(std::unique_ptr<Session> session) {
+    {
+        std::lock_guard<std::mutex> lock(inboxMutex);
+        inbox.push_back(std::move(session));
+    }
+    uint64_t one = 1;
+    if (write(wakeFd, &one, sizeof(one)) < 0) perror("write");
+}
+
+// Main loop of the worker
+void Worker::run() {
+    epoll_event events[WORKER_EVENTS];
+
+    if (settings.getPingInterval() > 0) {
+        schedule({nowNs() + settings.getPingInterval() * 1000000ULL, Timer::Kind::PING, 0, 0, ""});
+    }
+
+    while (running) {
+        int ready = epoll_wait(epollFd, events, WORKER_EVENTS, nextTimeout());
+        if (ready < 0 && errno != EINTR) {
+            perror("epoll_wait");
+            return;
+        }
+
+        for (int i = 0; i < ready; ++i) {
+            uint64_t id = events[i].data.u64;
+
+            // other thread handed us a session (or asked us to stop)
+            if (id == WAKE_ID) {
+                uint64_t value;
+                while (read(wakeFd, &value, sizeof(value)) > 0) {}
+                adoptPending();
+                continue;
+            }
+
+            // session could have been closed or moved by an earlier event
+            auto it = sessions.find(id);
+            if (it == sessions.end()) continue;
+            Session& session = *it->second;
+
+            if (events[i].events & EPOLLOUT) handleWritable(session);
+            if (session.closing) continue;
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) handleReadable(session);
+        }
+
+        processTimers();
+        reapClosing();
+    }
+}
+
+// Method to take over sessions handed to this worker
+void Worker::adoptPending() {
+    std::vector<std::unique_ptr<Session>> incoming;
+    {
+        std::lock_guard<std::mutex> lock(inboxMutex);
+        incoming.swap(inbox);
+    }
+
+    for (auto& owned : incoming) {
+        Session* session = owned.get();
+        uint64_t id = session->id;
+        sessions.emplace(id, std::move(owned));
+
+        epoll_event event{};
+        event.events = EPOLLIN;
+        if (!session->outbuf.empty()) event.events |= EPOLLOUT;
+        event.data.u64 = id;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, session->fd, &event);
+
+        if (!session->channel.empty()) channels[session->channel].push_back(session);
+
+        // timers of the previous owner do not travel, re-arm them
+        uint64_t now = nowNs();
+        for (auto& pending : session->unconfirmed) {
+            schedule({now + settings.getUdpTimeoutConfirmation() * 1000000ULL, Timer::Kind::RETRANSMIT, id, pending.first, ""});
+        }
+        for (auto& deferred : session->deferred) {
+            schedule({deferred.first, Timer::Kind::DELAYED_SEND, id, 0, std::move(deferred.second)});
+        }
+        session->deferred.clear();
+
+        server.log("session " + std::to_string(id) + " adopted by worker " + std::to_string(index));
+
+        if (session->replyPending) completeJoin(*session);
+
+        // TCP bytes that arrived right after the JOIN travel with the session
+        if (session->transport == Mode::TCP && !session->closing && !session->inbuf.empty()) {
+            processTcpInput(*session);
+        }
+    }
+}
+
+// Method to read everything available on a session
+void Worker::handleReadable(Session& session) {
+
+    // TCP, read until the kernel buffer is empty
+    if (session.transport == Mode::TCP) {
+        while (true) {
+            ssize_t received = recv(session.fd, buffer, BUFFER_SIZE, 0);
+            if (received > 0) {
+                session.inbuf.append(buffer, received);
+                continue;
+            }
+            if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            if (received < 0 && errno == EINTR) continue;
+            // connection closed or broken
+            closeSession(session, true);
+            return;
+        }
+        processTcpInput(session);
+        return;
+    }
+
+    // UDP, handle datagram by datagram
+    while (true) {
+        sockaddr_in from{};
+        socklen_t fromLen = sizeof(from);
+        ssize_t received = recvfrom(session.fd, buffer, BUFFER_SIZE, 0, (sockaddr*)&from, &fromLen);
+        if (received < 0) break; // EAGAIN or transient error, epoll wakes us again
+
+        // only the owner of the session may talk on the dynamic port
+        if (from.sin_addr.s_addr != session.peer.sin_addr.s_addr || from.sin_port != session.peer.sin_port) continue;
+
+        if (!processDatagram(session, std::string(buffer, received))) return;
+    }
+}
+
+// Method to flush queued TCP bytes
+void Worker::handleWritable(Session& session) {
+    while (!session.outbuf.empty()) {
+        ssize_t sent = send(session.fd, session.outbuf.data(), session.outbuf.size(), MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return;
+            if (errno == EINTR) continue;
+            session.closing = true;
+            doomed.push_back(session.id);
+            return;
+        }
+        session.outbuf.erase(0, sent);
+    }
+
+    // nothing left, stop watching for writability
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.u64 = session.id;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, session.fd, &event);
+}
+
+// Method to split the TCP buffer into \r\n terminated messages
+void Worker::processTcpInput(Session& session) {
+    std::size_t start = 0;
+    while (true) {
+        std::size_t end = session.inbuf.find("\r\n", start);
+        if (end == std::string::npos) break;
+
+        std::string line = session.inbuf.substr(start, end + 2 - start);
+        start = end + 2;
+
+        MessagePtr msg = tcpFactory.readResponse(line);
+
+        // AUTH/JOIN can hand the session over, the new owner must not see this line again
+        if (msg != nullptr && (msg->getType() == MessageType::AUTH || msg->getType() == MessageType::JOIN)) {
+            session.inbuf.erase(0, start);
+            start = 0;
+        }
+
+        bool stays = handleMessage(session, msg.get(), 0);
+        if (!stays) {
+            // the session is gone, or the rest of its input travelled with it
+            return;
+        }
+    }
+    session.inbuf.erase(0, start);
+}
+
+// Method to handle a single datagram of a UDP session
+bool Worker::processDatagram(Session& session, const std::string& datagram) {
+    if (datagram.size() < 3) return true;
+
+    uint8_t type = static_cast<uint8_t>(datagram[0]);
+    uint16_t msgId = static_cast<uint16_t>(static_cast<uint8_t>(datagram[1])) << 8
+                   | static_cast<uint16_t>(static_cast<uint8_t>(datagram[2]));
+
+    // confirmation of one of our messages
+    if (type == 0x00) {
+        session.unconfirmed.erase(msgId);
+        return true;
+    }
+
+    // everything else is confirmed, even duplicates (our confirm could have been lost)
+    MessageConfirm confirm(msgId);
+    sendUdp(session, confirm.getUDPMsg(), false);
+
+    if (session.seen[msgId] || session.lingering) return true;
+    session.seen[msgId] = true;
+    session.seen[static_cast<uint16_t>(msgId + 32768)] = false; // sliding window, IDs wrap around
+
+    MessagePtr msg = udpFactory.readResponse(datagram);
+    bool stays = handleMessage(session, msg.get(), msgId);
+    return stays;
+}
+
+// Method to act on a client message
+bool Worker::handleMessage(Session& session, Message* msg, uint16_t msgId) {
+
+    if (msg == nullptr) {
+        server.log("session " + std::to_string(session.id) + ": malformed message");
+        sendError(session, "Malformed message.");
+        closeSession(session, true);
+        return false;
+    }
+
+    MessageType type = msg->getType();
+
+    // before AUTH only AUTH, BYE and ERR make sense
+    if (!session.authenticated && type != MessageType::AUTH && type != MessageType::BYE && type != MessageType::ERR) {
+        sendError(session, "Authenticate first.");
+        closeSession(session, false);
+        return false;
+    }
+
+    switch (type) {
+        case MessageType::AUTH: {
+            if (session.authenticated) {
+                sendReply(session, false, msgId, "Already authenticated.");
+                return true;
+            }
+            MessageAuth* auth = dynamic_cast<MessageAuth*>(msg);
+            session.displayName = auth->getDisplayName();
+            session.authenticated = true;
+            server.log("session " + std::to_string(session.id) + ": AUTH as " + session.displayName);
+            return enterChannel(session, "default", msgId, "Auth success.");
+        }
+        case MessageType::JOIN: {
+            MessageJoin* join = dynamic_cast<MessageJoin*>(msg);
+            session.displayName = join->getDisplayName();
+            if (join->getChannelId() == session.channel) {
+                sendReply(session, true, msgId, "Already in " + session.channel + ".");
+                return true;
+            }
+            std::string channel(join->getChannelId());
+            server.log("session " + std::to_string(session.id) + ": JOIN " + channel);
+            return enterChannel(session, channel, msgId, "Join success.");
+        }
+        case MessageType::MSG: {
+            MessageMsg* message = dynamic_cast<MessageMsg*>(msg);
+            session.displayName = message->getDisplayName();
+            broadcast(session.channel, session.displayName, message->getContent(), &session);
+            return true;
+        }
+        case MessageType::BYE:
+        case MessageType::ERR:
+            server.log("session " + std::to_string(session.id) + ": left");
+            if (session.transport == Mode::UDP) {
+                // keep confirming retransmissions, our CONFIRM could get lost
+                linger(session);
+                return true;
+            }
+            closeSession(session, true);
+            return false;
+        default:
+            sendError(session, "Unexpected message.");
+            closeSession(session, true);
+            return false;
+    }
+}
+
+// Method to move a session to a channel
+bool Worker::enterChannel(Session& session, const std::string& channel, uint16_t refId, const std::string& reply) {
+
+    // leave the old channel first
+    if (!session.channel.empty()) {
+        std::vector<Session*>& members = channels[session.channel];
+        members.erase(std::remove(members.begin(), members.end(), &session), members.end());
+        broadcast(session.channel, "Server", session.displayName + " has left " + session.channel + ".", &session);
+        if (members.empty()) channels.erase(session.channel);
+    }
+
+    session.channel = channel;
+    session.replyPending = true;
+    session.replyRefId = refId;
+    session.replyContent = reply;
+
+    // we own the channel, finish right away
+    Worker& owner = server.ownerOf(channel);
+    if (&owner == this) {
+        channels[channel].push_back(&session);
+        completeJoin(session);
+        return true;
+    }
+
+    // hand the session to the owner of the channel
+    owner.adopt(detach(session));
+    return false;
+}
+
+// Method to finish AUTH/JOIN on the owner of the channel
+void Worker::completeJoin(Session& session) {
+    session.replyPending = false;
+    sendReply(session, true, session.replyRefId, session.replyContent);
+    broadcast(session.channel, "Server", session.displayName + " has joined " + session.channel + ".", &session);
+}
+
+// Method to send a reply
+void Worker::sendReply(Session& session, bool ok, uint16_t refId, const std::string& content) {
+    MessageReply reply(0, ok, refId, content);
+    if (session.transport == Mode::TCP) sendTcp(session, reply.getTCPMsg());
+    else sendUdp(session, reply.getUDPMsg(), true);
+}
+
+// Method to send an error
+void Worker::sendError(Session& session, const std::string& content) {
+    MessageError error(0, "Server", content);
+    if (session.transport == Mode::TCP) sendTcp(session, error.getTCPMsg());
+    else sendUdp(session, error.getUDPMsg(), true);
+}
+
+// Method to send a message to everybody in a channel
+void Worker::broadcast(const std::string& channel, const std::string& displayName, const std::string& content, Session* except) {
+    auto it = channels.find(channel);
+    if (it == channels.end()) return;
+
+    // serialize once per transport, only the UDP message ID differs per member
+    MessageMsg msg(0, displayName, content);
+    std::string tcpWire;
+    std::string udpWire;
+
+    for (Session* member : it->second) {
+        if (member == except || member->closing) continue;
+
+        if (member->transport == Mode::TCP) {
+            if (tcpWire.empty()) tcpWire = msg.getTCPMsg();
+            sendTcp(*member, tcpWire);
+            continue;
+        }
+        if (udpWire.empty()) udpWire = msg.getUDPMsg();
+        sendUdp(*member, udpWire, true);
+    }
+}
+
+// Method to write a fresh message ID into a datagram
+uint16_t Worker::stampId(Session& session, std::string& wire) {
+    uint16_t msgId = session.nextMsgId++;
+    wire[1] = static_cast<char>((msgId >> 8) & 0xFF);
+    wire[2] = static_cast<char>(msgId & 0xFF);
+    return msgId;
+}
+
+// Method to send bytes to a TCP session
+void Worker::sendTcp(Session& session, const std::string& wire) {
+    if (!faults.hasDelay()) {
+        writeTcp(session, wire);
+        return;
+    }
+    // the stream must keep its order, so delays never overtake each other
+    uint64_t due = std::max(nowNs() + faults.delayNs(), session.nextDueNs);
+    session.nextDueNs = due;
+    schedule({due, Timer::Kind::DELAYED_SEND, session.id, 0, wire});
+}
+
+// Method to send a datagram to a UDP session
+void Worker::sendUdp(Session& session, std::string wire, bool reliable) {
+    if (reliable) {
+        uint16_t msgId = stampId(session, wire);
+        session.unconfirmed[msgId] = {wire, 1};
+        schedule({nowNs() + settings.getUdpTimeoutConfirmation() * 1000000ULL, Timer::Kind::RETRANSMIT, session.id, msgId, ""});
+    }
+
+    if (faults.hasDelay()) {
+        schedule({nowNs() + faults.delayNs(), Timer::Kind::DELAYED_SEND, session.id, 0, std::move(wire)});
+        return;
+    }
+    transmit(session, wire);
+}
+
+// Method to put bytes on the wire
+void Worker::transmit(Session& session, const std::string& wire) {
+    if (session.transport == Mode::TCP) {
+        writeTcp(session, wire);
+        return;
+    }
+
+    if (faults.drop()) return;
+    int copies = faults.duplicate() ? 2 : 1;
+    for (int i = 0; i < copies; ++i) {
+        if (sendto(session.fd, wire.data(), wire.size(), 0, (sockaddr*)&session.peer, sizeof(session.peer)) < 0) {
+            perror("sendto");
+        }
+    }
+}
+
+// Method to write to a TCP socket without blocking
+void Worker::writeTcp(Session& session, const std::string& wire) {
+    if (session.closing) return;
+
+    // keep the order, older bytes are still waiting
+    if (!session.outbuf.empty()) {
+        session.outbuf.append(wire);
+        return;
+    }
+
+    std::size_t total = 0;
+    while (total < wire.size()) {
+        ssize_t sent = send(session.fd, wire.data() + total, wire.size() - total, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            session.closing = true;
+            doomed.push_back(session.id);
+            return;
+        }
+        total += sent;
+    }
+    if (total == wire.size()) return;
+
+    // kernel buffer is full, wait for EPOLLOUT
+    session.outbuf.append(wire, total, std::string::npos);
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLOUT;
+    event.data.u64 = session.id;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, session.fd, &event);
+}
+
+// Method to register a timer
+void Worker::schedule(Timer timer) {
+    timers.push_back(std::move(timer));
+    std::push_heap(timers.begin(), timers.end(), [](const Timer& a, const Timer& b) { return a.due > b.due; });
+}
+
+// Method to get the epoll timeout
+int Worker::nextTimeout() const {
+    if (timers.empty()) return -1;
+    uint64_t now = nowNs();
+    if (timers.front().due <= now) return 0;
+    return static_cast<int>((timers.front().due - now + 999999) / 1000000);
+}
+
+// Method to fire due timers
+void Worker::processTimers() {
+    auto later = [](const Timer& a, const Timer& b) { return a.due > b.due; };
+    uint64_t now = nowNs();
+
+    while (!timers.empty() && timers.front().due <= now) {
+        std::pop_heap(timers.begin(), timers.end(), later);
+        Timer timer = std::move(timers.back());
+        timers.pop_back();
+
+        // periodic ping of every UDP session of this shard
+        if (timer.kind == Timer::Kind::PING) {
+            for (auto& entry : sessions) {
+                // a session lingering after BYE only confirms retransmissions, its peer has left
+                if (entry.second->transport != Mode::UDP || entry.second->closing || entry.second->lingering) continue;
+                MessagePing ping(0);
+                sendUdp(*entry.second, ping.getUDPMsg(), true);
+            }
+            timer.due = now + settings.getPingInterval() * 1000000ULL;
+            schedule(std::move(timer));
+            continue;
+        }
+
+        // the session could be gone already
+        auto it = sessions.find(timer.sessionId);
+        if (it == sessions.end() || it->second->closing) continue;
+        Session& session = *it->second;
+
+        if (timer.kind == Timer::Kind::DELAYED_SEND) {
+            transmit(session, timer.payload);
+            continue;
+        }
+
+        if (timer.kind == Timer::Kind::CLOSE) {
+            closeSession(session, false);
+            continue;
+        }
+
+        // retransmission, unless the CONFIRM arrived in the meantime
+        auto pending = session.unconfirmed.find(timer.msgId);
+        if (pending == session.unconfirmed.end()) continue;
+
+        if (pending->second.attempts > settings.getMaxUdpRetransmissions()) {
+            server.log("session " + std::to_string(session.id) + ": connection dropped");
+            session.closing = true;
+            doomed.push_back(session.id);
+            continue;
+        }
+        pending->second.attempts++;
+        transmit(session, pending->second.wire);
+        timer.due = now + settings.getUdpTimeoutConfirmation() * 1000000ULL;
+        schedule(std::move(timer));
+    }
+}
+
+// Method to leave the channel but keep the UDP socket for a while
+void Worker::linger(Session& session) {
+    std::vector<Session*>& members = channels[session.channel];
+    members.erase(std::remove(members.begin(), members.end(), &session), members.end());
+    broadcast(session.channel, "Server", session.displayName + " has left " + session.channel + ".", &session);
+    if (members.empty()) channels.erase(session.channel);
+
+    session.channel.clear();
+    session.lingering = true;
+    session.unconfirmed.clear();
+    uint64_t wait = (settings.getMaxUdpRetransmissions() + 1ULL) * settings.getUdpTimeoutConfirmation() * 1000000ULL;
+    schedule({nowNs() + wait, Timer::Kind::CLOSE, session.id, 0, ""});
+}
+
+// Method to take a session out of this worker
+std::unique_ptr<Session> Worker::detach(Session& session) {
+    uint64_t id = session.id;
+
+    // channel membership
+    auto channel = channels.find(session.channel);
+    if (channel != channels.end()) {
+        std::vector<Session*>& members = channel->second;
+        members.erase(std::remove(members.begin(), members.end(), &session), members.end());
+        if (members.empty()) channels.erase(channel);
+    }
+
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, session.fd, nullptr);
+
+    // delayed messages must not get lost on a handoff
+    auto carried = std::stable_partition(timers.begin(), timers.end(), [id](const Timer& timer) {
+        return timer.kind != Timer::Kind::DELAYED_SEND || timer.sessionId != id;
+    });
+    for (auto it = carried; it != timers.end(); ++it) {
+        session.deferred.emplace_back(it->due, std::move(it->payload));
+    }
+    timers.erase(carried, timers.end());
+    std::make_heap(timers.begin(), timers.end(), [](const Timer& a, const Timer& b) { return a.due > b.due; });
+
+    auto it = sessions.find(id);
+    std::unique_ptr<Session> owned = std::move(it->second);
+    sessions.erase(it);
+    return owned;
+}
+
+// Method to close a session
+void Worker::closeSession(Session& session, bool announce) {
+    if (announce && session.authenticated && !session.channel.empty()) {
+        session.closing = true; // do not send our own leave to ourselves
+        broadcast(session.channel, "Server", session.displayName + " has left " + session.channel + ".", &session);
+    }
+
+    std::unique_ptr<Session> owned = detach(session);
+    if (owned->transport == Mode::UDP) server.forgetPeer(owned->peer);
+    if (owned->transport == Mode::TCP) shutdown(owned->fd, SHUT_RDWR);
+    close(owned->fd);
+}
+
+// Method to close sessions that failed during the iteration
+void Worker::reapClosing() {
+    for (uint64_t id : doomed) {
+        auto it = sessions.find(id);
+        if (it == sessions.end()) continue;
+        closeSession(*it->second, true);
+    }
+    doomed.clear();
+}
@@ -9,12 +9,10 @@
 #include <stdexcept>
 #include <cstdlib>
 #include <regex>
-#include <netdb.h>
-#include <arpa/inet.h>
-#include <sys/types.h>
-#include <sys/socket.h>
-#include <cstring>
+#include <fstream>
+#include <vector>
 #include "settings.hpp"
+#include "history.hpp"
 
 // Function to determine the target type
 TargetType determinTargetType(const std::string &target) { 
@@ -28,28 +26,29 @@ TargetType determinTargetType(const std::string &target) {
     return TargetType::UNKNOWN;
 } 
 
-// method to get the ip form a domain
-// helped by -> chat GPT
-std::string Settings::getIpFromDomain(const std::string& domain) {
-    struct addrinfo hints{}, *res, *p;
-    char ipStr[INET_ADDRSTRLEN]; // Buffer for IPv4 address
+// function to read a config file: "option value" per line, # starts a comment
+static std::vector<std::string> readConfig(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) throw std::invalid_argument("Cannot read the config file " + path + ".");
 
-    hints.ai_family = AF_INET; // Only look for IPv4 addresses
-    hints.ai_socktype = SOCK_STREAM;
+    std::vector<std::string> options;
+    std::string line;
+    while (std::getline(file, line)) {
+        std::size_t comment = line.find('#');
+        if (comment != std::string::npos) line.erase(comment);
+        std::size_t start = line.find_first_not_of(" \t\r");
+        if (start == std::string::npos) continue;
+        std::size_t end = line.find_first_of(" \t\r", start);
+        std::string option = line.substr(start, end - start);
+        options.push_back(option[0] == '-' ? option : "--" + option);
 
-    if (getaddrinfo(domain.c_str(), nullptr, &hints, &res) != 0) {
-        return ""; // Return empty string if resolution fails
+        // the rest of the line is the value (it may contain spaces)
+        std::size_t valueStart = end == std::string::npos ? end : line.find_first_not_of(" \t\r", end);
+        if (valueStart == std::string::npos) continue;
+        std::size_t valueEnd = line.find_last_not_of(" \t\r");
+        options.push_back(line.substr(valueStart, valueEnd - valueStart + 1));
     }
-
-    for (p = res; p != nullptr; p = p->ai_next) {
-        struct sockaddr_in* ipv4 = (struct sockaddr_in*)p->ai_addr;
-        inet_ntop(AF_INET, &(ipv4->sin_addr), ipStr, sizeof(ipStr));
-        freeaddrinfo(res); // Free memory
-        return std::string(ipStr); // Return first IPv4 address
-    }
-
-    freeaddrinfo(res);
-    return ""; // No IPv4 address found
+    return options;
 }
 
 // constructor for settings class (argument parser)
@@ -61,14 +60,44 @@ Settings::Settings(int argc, char* argv[]) {
     udpTimeoutConfirmation = 250; // default timeout
     maxUdpRetransmissions = 3; // default max retransmissions
     mode = Mode::NONE; // default mode
+    replaySpeed = 0.0; // offline replay by default
+    historyBudget = HISTORY_DEFAULT_BUDGET;
+    logSync = LogSync::INTERVAL; // at most a second of messages lost on a crash
+    logSyncInterval = 1000;
+    reconnectAttempts = 0; // the reference behaviour is to exit when the server goes away
+    dnsTtl = RESOLVER_CACHE_TTL;
+    poolSize = POOL_DEFAULT_SIZE;
+    fps = RENDER_DEFAULT_FPS;
+    plain = false;
+    displayQueue = DISPLAY_DEFAULT_QUEUE;
+    displayPolicy = DisplayPolicy::BLOCK;
+    bool displayPolicySet = false;
+    pipeline = false;
+    pinNetwork = -1;
+    pinProtocol = -1;
+    const char* cacheHome = getenv("XDG_CACHE_HOME");
+    const char* home = getenv("HOME");
+    if (cacheHome != nullptr && *cacheHome != '\0') dnsCache = std::string(cacheHome) + "/ipk25chat-dns";
+    else if (home != nullptr && *home != '\0') dnsCache = std::string(home) + "/.cache/ipk25chat-dns";
 
-    // parse args
+    // parse args (a config file is spliced in where --config stands)
+    std::vector<std::string> args(argv, argv + argc);
+    int configs = 0;
     for (int i = 1; i < argc; ++i) {
-        std::string arg = argv[i];
+        std::string arg = args[i];
+
+        // options from a file, the arguments after --config override them
+        if (arg == "--config" && i + 1 < argc) {
+            if (++configs > SETTINGS_MAX_CONFIGS) throw std::invalid_argument("Too many --config files (does one include itself?).");
+            std::vector<std::string> options = readConfig(args[++i]);
+            args.insert(args.begin() + i + 1, options.begin(), options.end());
+            argc = static_cast<int>(args.size());
+            continue;
+        }
 
         // mode
         if (arg == "-t" && i + 1 < argc) {
-            std::string protocol = argv[++i];
+            std::string protocol = args[++i];
             if (protocol != "tcp" && protocol != "udp") {
                 throw std::invalid_argument("Invalid value for -t. Expected 'tcp' or 'udp'.");
             }
@@ -78,7 +107,7 @@ Settings::Settings(int argc, char* argv[]) {
         
         // source
         if (arg == "-s" && i + 1 < argc) {
-            std::string serverArg = argv[++i];
+            std::string serverArg = args[++i];
             TargetType result = determinTargetType(serverArg);
             if (result == TargetType::UNKNOWN) {
                 throw std::invalid_argument("Invalid server address: " + serverArg);
@@ -98,32 +127,240 @@ Settings::Settings(int argc, char* argv[]) {
                 continue;
             }
             
-            // domain name
+            // domain name, resolved in the background (the version is known once it resolved)
             server.hostName = serverArg;
-            server.ipVer = IpVersion::IPV4;
-            server.ip = getIpFromDomain(serverArg);
-            if (server.ip.empty()) throw std::invalid_argument("Could not resolve domain: " + serverArg);
             continue;
         }
         // port
         if (arg == "-p" && i + 1 < argc) {
-            server.port = static_cast<uint16_t>(std::stoi(argv[++i]));
+            server.port = static_cast<uint16_t>(std::stoi(args[++i]));
             continue;
 
         } 
 
         // udp timeout
         if (arg == "-d" && i + 1 < argc) {
-            udpTimeoutConfirmation = static_cast<uint16_t>(std::stoi(argv[++i]));
+            udpTimeoutConfirmation = static_cast<uint16_t>(std::stoi(args[++i]));
             continue;
         } 
 
         // udp retransmition
         if (arg == "-r" && i + 1 < argc) {
-            maxUdpRetransmissions = static_cast<uint8_t>(std::stoi(argv[++i]));
+            maxUdpRetransmissions = static_cast<uint8_t>(std::stoi(args[++i]));
             continue;
         } 
 
+        // bulk send script
+        if (arg == "-f" && i + 1 < argc) {
+            scriptFile = args[++i];
+            continue;
+        }
+
+        // event trace output
+        if (arg == "--trace" && i + 1 < argc) {
+            traceFile = args[++i];
+            continue;
+        }
+
+        // raw traffic capture
+        if (arg == "--capture" && i + 1 < argc) {
+            captureFile = args[++i];
+            continue;
+        }
+
+        // capture replay
+        if (arg == "--replay" && i + 1 < argc) {
+            replayFile = args[++i];
+            continue;
+        }
+
+        // replay pace
+        if (arg == "--replay-speed" && i + 1 < argc) {
+            replaySpeed = std::stod(args[++i]);
+            if (replaySpeed < 0) throw std::invalid_argument("Invalid value for --replay-speed. Expected a number >= 0.");
+            continue;
+        }
+
+        // history memory budget
+        if (arg == "--history-mb" && i + 1 < argc) {
+            int megabytes = std::stoi(args[++i]);
+            if (megabytes < 1) throw std::invalid_argument("Invalid value for --history-mb. Expected a positive number.");
+            historyBudget = static_cast<std::size_t>(megabytes) << 20;
+            continue;
+        }
+
+        // message log directory
+        if (arg == "--log-dir" && i + 1 < argc) {
+            logDir = args[++i];
+            continue;
+        }
+
+        // message log flush policy
+        if (arg == "--log-fsync" && i + 1 < argc) {
+            std::string policy = args[++i];
+            if (policy == "never") logSync = LogSync::NEVER;
+            else if (policy == "batch") logSync = LogSync::BATCH;
+            else {
+                logSync = LogSync::INTERVAL;
+                logSyncInterval = std::stoi(policy);
+                if (logSyncInterval < 1) throw std::invalid_argument("Invalid value for --log-fsync. Expected never, batch or a positive number of milliseconds.");
+            }
+            continue;
+        }
+
+        // reconnect attempts
+        if (arg == "--reconnect" && i + 1 < argc) {
+            reconnectAttempts = std::stoi(args[++i]);
+            if (reconnectAttempts < 0) throw std::invalid_argument("Invalid value for --reconnect. Expected a number >= 0.");
+            continue;
+        }
+
+        // object pool size
+        if (arg == "--pool-size" && i + 1 < argc) {
+            int size = std::stoi(args[++i]);
+            if (size < 1) throw std::invalid_argument("Invalid value for --pool-size. Expected a positive number.");
+            poolSize = static_cast<std::size_t>(size);
+            continue;
+        }
+
+        // outbound rate limit (token buckets)
+        if ((arg == "--rate" || arg == "--burst" || arg == "--byte-rate" || arg == "--byte-burst") && i + 1 < argc) {
+            double value = std::stod(args[++i]);
+            if (!(value > 0)) throw std::invalid_argument("Invalid value for " + arg + ". Expected a positive number.");
+            if (arg == "--rate") rateLimit.messages = value;
+            else if (arg == "--burst") rateLimit.messageBurst = value;
+            else if (arg == "--byte-rate") rateLimit.bytes = value;
+            else rateLimit.byteBurst = value;
+            continue;
+        }
+
+        // terminal renderer frame rate
+        if (arg == "--fps" && i + 1 < argc) {
+            fps = std::stoi(args[++i]);
+            if (fps < 1 || fps > 1000) throw std::invalid_argument("Invalid value for --fps. Expected a number between 1 and 1000.");
+            continue;
+        }
+
+        // line output even on a terminal
+        if (arg == "--plain") {
+            plain = true;
+            continue;
+        }
+
+        // bound of the display queue
+        if (arg == "--display-queue" && i + 1 < argc) {
+            int size = std::stoi(args[++i]);
+            if (size < 1) throw std::invalid_argument("Invalid value for --display-queue. Expected a positive number.");
+            displayQueue = static_cast<std::size_t>(size);
+            continue;
+        }
+
+        // what happens to received messages the display cannot keep up with
+        if (arg == "--display-policy" && i + 1 < argc) {
+            std::string policy = args[++i];
+            if (policy == "block") displayPolicy = DisplayPolicy::BLOCK;
+            else if (policy == "drop-oldest") displayPolicy = DisplayPolicy::DROP_OLDEST;
+            else if (policy == "sample") displayPolicy = DisplayPolicy::SAMPLE;
+            else throw std::invalid_argument("Invalid value for --display-policy. Expected 'block', 'drop-oldest' or 'sample'.");
+            displayPolicySet = true;
+            continue;
+        }
+
+        // network thread confirming and queueing the datagrams
+        if (arg == "--pipeline") {
+            pipeline = true;
+            continue;
+        }
+
+        // CPUs of the pipeline threads
+        if (arg == "--pin" && i + 1 < argc) {
+            std::string cpus = args[++i];
+            std::size_t comma = cpus.find(',');
+            if (comma == std::string::npos) throw std::invalid_argument("Invalid value for --pin. Expected <network cpu>,<protocol cpu>.");
+            pinNetwork = std::stoi(cpus.substr(0, comma));
+            pinProtocol = std::stoi(cpus.substr(comma + 1));
+            if (pinNetwork < 0 || pinProtocol < 0) throw std::invalid_argument("Invalid value for --pin. Expected CPU numbers >= 0.");
+            pipeline = true;
+            continue;
+        }
+
+        // socket buffers, the kernel drops the datagrams that do not fit
+        if ((arg == "--rcvbuf" || arg == "--sndbuf") && i + 1 < argc) {
+            int bytes = std::stoi(args[++i]);
+            if (bytes < 1) throw std::invalid_argument("Invalid value for " + arg + ". Expected a positive number of bytes.");
+            (arg == "--rcvbuf" ? socketOptions.receiveBuffer : socketOptions.sendBuffer) = bytes;
+            continue;
+        }
+
+        // busy polling of the socket
+        if (arg == "--busy-poll" && i + 1 < argc) {
+            socketOptions.busyPoll = std::stoi(args[++i]);
+            if (socketOptions.busyPoll < 0) throw std::invalid_argument("Invalid value for --busy-poll. Expected microseconds >= 0.");
+            continue;
+        }
+
+        // TCP latency options
+        if (arg == "--nodelay") {
+            socketOptions.noDelay = true;
+            continue;
+        }
+        if (arg == "--quickack") {
+            socketOptions.quickAck = true;
+            continue;
+        }
+
+        // traffic class, the whole byte or just the DSCP bits
+        if ((arg == "--tos" || arg == "--dscp") && i + 1 < argc) {
+            int value = std::stoi(args[++i], nullptr, 0);
+            int limit = arg == "--tos" ? 255 : 63;
+            if (value < 0 || value > limit) throw std::invalid_argument("Invalid value for " + arg + ". Expected a number between 0 and " + std::to_string(limit) + ".");
+            socketOptions.tos = arg == "--tos" ? value : value << 2;
+            continue;
+        }
+
+        // local address and port
+        if (arg == "--bind" && i + 1 < argc) {
+            socketOptions.bindAddress = args[++i];
+            continue;
+        }
+        if (arg == "--bind-port" && i + 1 < argc) {
+            int port = std::stoi(args[++i]);
+            if (port < 1 || port > 65535) throw std::invalid_argument("Invalid value for --bind-port. Expected a number between 1 and 65535.");
+            socketOptions.bindPort = static_cast<uint16_t>(port);
+            continue;
+        }
+
+        // zero-copy sends of large frames
+        if (arg == "--zerocopy" && i + 1 < argc) {
+            socketOptions.zeroCopy = std::stoi(args[++i]);
+            if (socketOptions.zeroCopy < 1) throw std::invalid_argument("Invalid value for --zerocopy. Expected a size in bytes >= 1.");
+            continue;
+        }
+        if (arg == "--zerocopy-force") {
+            socketOptions.zeroCopyForce = true;
+            continue;
+        }
+
+        // kernel receive timestamps
+        if (arg == "--rx-timestamps") {
+            socketOptions.rxTimestamps = true;
+            continue;
+        }
+
+        // resolver cache
+        if (arg == "--dns-cache" && i + 1 < argc) {
+            dnsCache = args[++i];
+            if (dnsCache == "off") dnsCache.clear();
+            continue;
+        }
+
+        // resolver cache entry lifetime
+        if (arg == "--dns-ttl" && i + 1 < argc) {
+            dnsTtl = std::stoi(args[++i]);
+            if (dnsTtl < 0) throw std::invalid_argument("Invalid value for --dns-ttl. Expected a number of seconds >= 0.");
+            continue;
+        }
+
         // help
         if (arg == "-h") {
             printHelp();
@@ -135,10 +372,45 @@ Settings::Settings(int argc, char* argv[]) {
         throw std::invalid_argument("Unknown or malformed argument: " + arg);
     }
 
+    // an offline replay never touches the network, the server is not needed
+    if (!replayFile.empty() && replaySpeed == 0 && server.ip.empty() && server.hostName.empty()) {
+        server.ip = "127.0.0.1";
+        server.ipVer = IpVersion::IPV4;
+    }
+
     // Check mandatory arguments
-    if (mode == Mode::NONE || server.ipVer == IpVersion::None) {
+    if (mode == Mode::NONE || (server.ip.empty() && server.hostName.empty())) {
         throw std::invalid_argument("Missing mandatory arguments. Use -h for help.");
     }
+
+    // a paused UDP socket would leave the messages of the server unconfirmed, it would retransmit and give up
+    if (!displayPolicySet) displayPolicy = mode == Mode::TCP ? DisplayPolicy::BLOCK : DisplayPolicy::SAMPLE;
+    if (mode == Mode::UDP && displayPolicy == DisplayPolicy::BLOCK) {
+        throw std::invalid_argument("Invalid value for --display-policy. 'block' is not available with -t udp.");
+    }
+
+    // TCP has no confirmations to take off the protocol thread
+    if (pipeline && mode == Mode::TCP) {
+        throw std::invalid_argument("Invalid argument --pipeline. Only available with -t udp.");
+    }
+
+    // a burst without its rate would limit nothing
+    if ((rateLimit.messageBurst > 0 && rateLimit.messages == 0) || (rateLimit.byteBurst > 0 && rateLimit.bytes == 0)) {
+        throw std::invalid_argument("Invalid argument --burst/--byte-burst. Needs --rate/--byte-rate.");
+    }
+
+    // UDP datagrams are far below the size where pinning pages pays off
+    if (socketOptions.zeroCopy > 0 && mode == Mode::UDP) {
+        throw std::invalid_argument("Invalid argument --zerocopy. Only available with -t tcp.");
+    }
+    if (socketOptions.zeroCopyForce && socketOptions.zeroCopy == 0) {
+        throw std::invalid_argument("Invalid argument --zerocopy-force. Needs --zerocopy.");
+    }
+
+    // runs while the rest of the client starts up
+    resolver.setCache(dnsCache, dnsTtl);
+    resolver.start(server.hostName.empty() ? server.ip : server.hostName, server.port);
+    server.resolver = &resolver;
 }
 
 // method to represent the settings (debug)
@@ -150,7 +422,8 @@ void Settings::representSettings() const {
               << "  Server IP Version: " << (server.ipVer == IpVersion::IPV4 ? "IPv4" : "IPv6") << "\n"
               << "  Server Port: " << server.port << "\n"
               << "  UDP Timeout Confirmation: " << udpTimeoutConfirmation << " ms\n"
-              << "  Max UDP Retransmissions: " << maxUdpRetransmissions << "\n" << std::flush;;
+              << "  Max UDP Retransmissions: " << maxUdpRetransmissions << "\n"
+              << "  Trace File: " << traceFile << "\n" << std::flush;;
 }
 
 // method to print help
@@ -162,5 +435,40 @@ void Settings::printHelp() const {
               << "  -p <port>          Server port (default: 4567)\n"
               << "  -d <timeout>       UDP confirmation timeout in milliseconds (default: 250)\n"
               << "  -r <retries>       Maximum number of UDP retransmissions (default: 3)\n"
+              << "  -f <script>        Sends the lines of <script> as fast as the protocol allows (stdin stays usable)\n"
+              << "  --capture <file>   Records every raw chunk sent and received into <file>\n"
+              << "  --replay <file>    Replays a capture instead of reading stdin\n"
+              << "  --replay-speed <n> Replays at n times the captured pace against -s (default: 0, offline, as fast as possible)\n"
+              << "  --history-mb <n>   Memory budget of the searchable message history (default: 64)\n"
+              << "  --log-dir <dir>    Appends displayed and sent messages to a log in <dir> (read with /scrollback)\n"
+              << "  --log-fsync <p>    Log flush policy: never, batch (every event loop iteration) or <ms> (default: 1000)\n"
+              << "  --reconnect <n>    Reconnects and resumes the session up to n times per outage (default: 0, exit)\n"
+              << "  --pool-size <n>    Messages, commands and buffers kept for reuse per pool (default: 16)\n"
+              << "  --rate <n>         Sends at most n messages per second, the rest wait in order (CONFIRM, BYE and ERR never wait)\n"
+              << "  --burst <n>        Messages sent back to back at most under --rate (default: one second of the rate)\n"
+              << "  --byte-rate <n>    Sends at most n bytes per second on the wire, the rest wait in order\n"
+              << "  --byte-burst <n>   Bytes sent back to back at most under --byte-rate (default: one second of the rate)\n"
+              << "  --fps <n>          Frames per second the terminal renderer draws at most (default: 60)\n"
+              << "  --plain            Plain line output with the terminal's own echo, even on a terminal\n"
+              << "  --display-queue <n> Received messages the display queue holds before its policy applies (default: 4096)\n"
+              << "  --display-policy <p> Full display queue: block (stop reading the server), drop-oldest or sample (default: block for tcp, sample for udp)\n"
+              << "  --pipeline         UDP: receive and confirm on a network thread, parse and display on the main thread\n"
+              << "  --pin <net>,<main> Pins the pipeline threads to these CPUs (implies --pipeline)\n"
+              << "  --config <file>    Reads options from <file>, one \"option value\" per line (later arguments override it)\n"
+              << "  --rcvbuf <bytes>   Socket receive buffer (SO_RCVBUF, forced past rmem_max when allowed)\n"
+              << "  --sndbuf <bytes>   Socket send buffer (SO_SNDBUF, forced past wmem_max when allowed)\n"
+              << "  --busy-poll <us>   Busy polls the socket for up to <us> microseconds (SO_BUSY_POLL)\n"
+              << "  --nodelay          TCP: sends small frames right away (TCP_NODELAY)\n"
+              << "  --quickack         TCP: acknowledges right away (TCP_QUICKACK)\n"
+              << "  --tos <n>          IP_TOS / IPV6_TCLASS byte\n"
+              << "  --dscp <n>         DSCP code point (the upper six bits of --tos)\n"
+              << "  --bind <address>   Local address of the socket\n"
+              << "  --bind-port <port> Local port of the socket\n"
+              << "  --zerocopy <bytes> TCP: sends MSGs of at least <bytes> (and 4096) with MSG_ZEROCOPY\n"
+              << "  --zerocopy-force   Keeps MSG_ZEROCOPY when the kernel copies anyway (for measuring)\n"
+              << "  --rx-timestamps    Records kernel arrival -> parse/confirm/display latencies (SO_TIMESTAMPNS)\n"
+              << "  --dns-cache <file> Resolver cache, off disables it (default: ~/.cache/ipk25chat-dns)\n"
+              << "  --dns-ttl <s>      Seconds a cached address is used before it is refreshed (default: 300)\n"
+              << "  --trace <file>     Dumps the binary event trace to <file> on exit and on SIGUSR1\n"
               << "  -h                 Prints this help message and exits\n" << std::flush;;
 }
\ No newline at end of file
@@ -0,0 +1,149 @@
+/**
+ * @file socketOptions.cpp
+ * @brief Implementation of the SocketOptions struct
+ * @author Martin Mendl <x247581>
+ * @date 18.4.2025
+*/
+
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <netinet/tcp.h>
+#include <netinet/udp.h>
+#include <arpa/inet.h>
+#include "socketOptions.hpp"
+#include "resolver.hpp"
+
+// function to set an integer option, a failure is reported and skipped
+static void setOption(int fd, int level, int name, int value, const char* label) {
+    if (setsockopt(fd, level, name, &value, sizeof(value)) == -1) {
+        std::cout << "ERROR: cannot set " << label << "=" << value << ": " << strerror(errno) << "\n" << std::flush;
+    }
+}
+
+// function to read an integer option (-1 if it cannot be read)
+static int getOption(int fd, int level, int name) {
+    int value = 0;
+    socklen_t length = sizeof(value);
+    return getsockopt(fd, level, name, &value, &length) == 0 ? value : -1;
+}
+
+// function to size a buffer, past the rmem_max/wmem_max cap if the process may
+static void setBuffer(int fd, int name, int forceName, int bytes, const char* label) {
+    setOption(fd, SOL_SOCKET, name, bytes, label);
+    // the kernel doubles the value for its bookkeeping, less means it was capped
+    if (getOption(fd, SOL_SOCKET, name) >= 2 * bytes) return;
+    if (setsockopt(fd, SOL_SOCKET, forceName, &bytes, sizeof(bytes)) == -1 && errno != EPERM) {
+        std::cout << "ERROR: cannot force " << label << "=" << bytes << ": " << strerror(errno) << "\n" << std::flush;
+    }
+}
+
+// Method to set the options on a new socket
+bool SocketOptions::apply(int fd, int family, Mode mode) const {
+    if (receiveBuffer > 0) setBuffer(fd, SO_RCVBUF, SO_RCVBUFFORCE, receiveBuffer, "SO_RCVBUF");
+    if (sendBuffer > 0) setBuffer(fd, SO_SNDBUF, SO_SNDBUFFORCE, sendBuffer, "SO_SNDBUF");
+    if (busyPoll >= 0) setOption(fd, SOL_SOCKET, SO_BUSY_POLL, busyPoll, "SO_BUSY_POLL");
+    if (tos >= 0) {
+        if (family == AF_INET6) setOption(fd, IPPROTO_IPV6, IPV6_TCLASS, tos, "IPV6_TCLASS");
+        else setOption(fd, IPPROTO_IP, IP_TOS, tos, "IP_TOS");
+    }
+    if (mode == Mode::TCP) {
+        if (noDelay) setOption(fd, IPPROTO_TCP, TCP_NODELAY, 1, "TCP_NODELAY");
+        if (zeroCopy > 0) setOption(fd, SOL_SOCKET, SO_ZEROCOPY, 1, "SO_ZEROCOPY");
+        rearm(fd);
+    }
+    if (rxTimestamps) setOption(fd, SOL_SOCKET, SO_TIMESTAMPNS, 1, "SO_TIMESTAMPNS");
+    if (bindAddress.empty() && bindPort == 0) return true;
+
+    // the local address has to be of the family of the server address
+    sockaddr_storage local{};
+    local.ss_family = static_cast<sa_family_t>(family);
+    if (family == AF_INET6) {
+        sockaddr_in6& address = reinterpret_cast<sockaddr_in6&>(local);
+        address.sin6_addr = in6addr_any;
+        if (!bindAddress.empty() && inet_pton(AF_INET6, bindAddress.c_str(), &address.sin6_addr) != 1) {
+            errno = EAFNOSUPPORT;
+            return false;
+        }
+    } else {
+        sockaddr_in& address = reinterpret_cast<sockaddr_in&>(local);
+        address.sin_addr.s_addr = htonl(INADDR_ANY);
+        if (!bindAddress.empty() && inet_pton(AF_INET, bindAddress.c_str(), &address.sin_addr) != 1) {
+            errno = EAFNOSUPPORT;
+            return false;
+        }
+    }
+    Resolver::setPort(local, bindPort);
+
+    // a fixed port is shared by the racing connects (and by the socket of a reconnect)
+    if (bindPort != 0) setOption(fd, SOL_SOCKET, SO_REUSEADDR, 1, "SO_REUSEADDR");
+    return bind(fd, reinterpret_cast<sockaddr*>(&local), Resolver::length(local)) == 0;
+}
+
+// Method to set TCP_QUICKACK again
+void SocketOptions::rearm(int fd) const {
+    if (!quickAck) return;
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_QUICKACK, &one, sizeof(one));
+}
+
+// Method to write the effective values
+void SocketOptions::report(int fd, Mode mode, std::ostream& out) {
+    sockaddr_storage local{};
+    socklen_t length = sizeof(local);
+    bool named = getsockname(fd, reinterpret_cast<sockaddr*>(&local), &length) == 0;
+    int tos = local.ss_family == AF_INET6 ? getOption(fd, IPPROTO_IPV6, IPV6_TCLASS) : getOption(fd, IPPROTO_IP, IP_TOS);
+
+    out << "socket: local=" << (named ? Resolver::toString(local) : "?")
+        << " rcvbuf=" << getOption(fd, SOL_SOCKET, SO_RCVBUF)
+        << " sndbuf=" << getOption(fd, SOL_SOCKET, SO_SNDBUF)
+        << " busy-poll=" << getOption(fd, SOL_SOCKET, SO_BUSY_POLL)
+        << " tos=" << tos
+        << " rx-timestamps=" << getOption(fd, SOL_SOCKET, SO_TIMESTAMPNS);
+    if (mode == Mode::TCP) {
+        out << " nodelay=" << getOption(fd, IPPROTO_TCP, TCP_NODELAY)
+            << " quickack=" << getOption(fd, IPPROTO_TCP, TCP_QUICKACK)
+            << " zerocopy=" << getOption(fd, SOL_SOCKET, SO_ZEROCOPY);
+    }
+    out << "\n" << std::flush;
+}
+
+/*
+With SO_TIMESTAMPNS the kernel attaches the time the packet was received
+(software timestamp, taken before any queueing in the socket) as a control
+message. For TCP a read spanning several segments carries the time of the
+last one, the time the newest bytes arrived. With UDP_GRO the kernel may
+hand over several datagrams of one sender back to back, all of the same
+size but the last, and says so in another control message.
+*/
+ssize_t SocketOptions::receive(int fd, char* data, std::size_t size, sockaddr_storage* from, uint64_t& arrivalNs, int* segment) {
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(timespec)) + CMSG_SPACE(sizeof(int))];
+    iovec vector{data, size};
+    msghdr header{};
+    header.msg_name = from;
+    header.msg_namelen = from != nullptr ? sizeof(*from) : 0;
+    header.msg_iov = &vector;
+    header.msg_iovlen = 1;
+    header.msg_control = control;
+    header.msg_controllen = sizeof(control);
+
+    arrivalNs = 0;
+    if (segment != nullptr) *segment = 0;
+    ssize_t length = recvmsg(fd, &header, 0);
+    if (length < 0) return length;
+    for (cmsghdr* message = CMSG_FIRSTHDR(&header); message != nullptr; message = CMSG_NXTHDR(&header, message)) {
+        if (segment != nullptr && message->cmsg_level == SOL_UDP && message->cmsg_type == UDP_GRO) {
+            memcpy(segment, CMSG_DATA(message), sizeof(*segment));
+            continue;
+        }
+        if (message->cmsg_level != SOL_SOCKET || message->cmsg_type != SCM_TIMESTAMPNS) continue;
+        timespec stamp;
+        memcpy(&stamp, CMSG_DATA(message), sizeof(stamp));
+        arrivalNs = static_cast<uint64_t>(stamp.tv_sec) * 1000000000ull + stamp.tv_nsec;
+    }
+    return length;
+}
@@ -0,0 +1,211 @@
+/**
+ * @file archiveScan.cpp
+ * @brief Scanner of the compressed message log archive (ipk25chat-archive)
+ * @author Martin Mendl <x247581>
+ * @date 18.4.2025
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "messageLog.hpp"
+#include "latency.hpp"
+#include "lz.hpp"
+
+// totals over all scanned archives
+struct ScanTotals {
+    uint64_t raw = 0;         // bytes before compression
+    uint64_t stored = 0;      // bytes in the archive files
+    uint64_t messages = 0;    // records
+    uint64_t scanNs = 0;      // wall time of the whole scan (read + decompress + parse)
+    uint64_t codecNs = 0;     // time spent in the decompressor only
+};
+
+// function to print the usage
+static void printHelp() {
+    std::cout << "Usage: ipk25chat-archive <log-dir> [options]\n"
+              << "Options:\n"
+              << "  -c                 Archives the sealed segments (every .log but the newest) first\n"
+              << "  -p                 Prints every archived message\n"
+              << "  -h                 Prints this help message and exits\n" << std::flush;
+}
+
+// function to list the files of a directory with an extension, sorted
+static std::vector<std::string> listFiles(const std::string& dir, const std::string& extension) {
+    std::vector<std::string> files;
+    DIR* handle = opendir(dir.c_str());
+    if (handle == nullptr) return files;
+    while (dirent* entry = readdir(handle)) {
+        std::string name = entry->d_name;
+        if (name.size() == 20 + extension.size() && name.compare(20, extension.size(), extension) == 0) files.push_back(dir + "/" + name);
+    }
+    closedir(handle);
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+// function to print the records of a decompressed block
+static uint64_t parseBlock(const char* data, uint64_t length, bool print) {
+    uint64_t offset = 0, count = 0;
+    LogRecordHeader header;
+    while (offset + sizeof(header) <= length) {
+        memcpy(&header, data + offset, sizeof(header));
+        if (header.length < sizeof(header) || offset + header.length > length) break;
+        if (print) {
+            const char* fields = data + offset + sizeof(header);
+            time_t seconds = static_cast<time_t>(header.timeNs / 1000000000);
+            struct tm local;
+            localtime_r(&seconds, &local);
+            char stamp[32];
+            strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &local);
+            std::cout << "[" << stamp << "] [" << std::string(fields, header.channelLength) << "] "
+                      << std::string(fields + header.channelLength, header.senderLength) << ": "
+                      << std::string(fields + header.channelLength + header.senderLength, header.contentLength) << "\n";
+        }
+        offset += header.length;
+        count++;
+    }
+    return count;
+}
+
+// function to scan one archive, decompressing every block
+static bool scanArchive(const std::string& path, bool print, ScanTotals& totals) {
+    uint64_t start = monotonicNs();
+    int fd = open(path.c_str(), O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) < 0 || info.st_size < static_cast<off_t>(sizeof(LogArchiveHeader))) {
+        if (fd >= 0) close(fd);
+        std::cerr << "Error: cannot open " << path << "\n";
+        return false;
+    }
+    uint64_t size = info.st_size;
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) return false;
+    const char* data = static_cast<const char*>(mapped);
+    madvise(mapped, size, MADV_SEQUENTIAL);
+
+    LogArchiveHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, LOG_ARCHIVE_MAGIC, sizeof(header.magic)) != 0 || header.indexOffset > size
+        || header.blocks > (size - header.indexOffset) / sizeof(LogArchiveBlock)) {
+        munmap(mapped, size);
+        std::cerr << "Error: " << path << " is not a message log archive\n";
+        return false;
+    }
+    std::vector<LogArchiveBlock> blocks(header.blocks);
+    memcpy(blocks.data(), data + header.indexOffset, blocks.size() * sizeof(LogArchiveBlock));
+
+    std::vector<char> raw;
+    uint64_t messages = 0, codecNs = 0;
+    bool ok = true;
+    for (std::size_t i = 0; i < blocks.size() && ok; ++i) {
+        const LogArchiveBlock& block = blocks[i];
+        if (block.offset > size || block.size > size - block.offset) {
+            ok = false;
+            break;
+        }
+        raw.resize(block.rawSize);
+        uint64_t codecStart = monotonicNs();
+        if (block.size == block.rawSize) memcpy(raw.data(), data + block.offset, block.size);
+        else ok = LZ::decompress(data + block.offset, block.size, raw.data(), block.rawSize);
+        codecNs += monotonicNs() - codecStart;
+        if (ok) messages += parseBlock(raw.data(), raw.size(), print);
+    }
+    munmap(mapped, size);
+    uint64_t scanNs = monotonicNs() - start;
+
+    if (!ok) std::cerr << "Error: corrupt block in " << path << "\n";
+    if (!print) {
+        std::cout << path.substr(path.rfind('/') + 1) << ": " << blocks.size() << " blocks, " << messages << " messages, "
+                  << std::fixed << std::setprecision(1) << header.rawSize / 1e6 << " MB -> " << size / 1e6 << " MB ("
+                  << std::setprecision(2) << (size ? static_cast<double>(header.rawSize) / size : 0.0) << "x)\n";
+    }
+    totals.raw += header.rawSize;
+    totals.stored += size;
+    totals.messages += messages;
+    totals.scanNs += scanNs;
+    totals.codecNs += codecNs;
+    return ok;
+}
+
+int main(int argc, char* argv[]) {
+
+    std::string dir;
+    bool compress = false, print = false;
+
+    // parse args
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-c") {
+            compress = true;
+            continue;
+        }
+        if (arg == "-p") {
+            print = true;
+            continue;
+        }
+        if (arg == "-h") {
+            printHelp();
+            return 0;
+        }
+        if (dir.empty() && arg[0] != '-') {
+            dir = arg;
+            continue;
+        }
+        std::cerr << "Error: unknown argument " << arg << "\n";
+        return 1;
+    }
+    if (dir.empty()) {
+        printHelp();
+        return 1;
+    }
+
+    // the newest segment may still be written by a running client
+    if (compress) {
+        std::vector<std::string> sealed = listFiles(dir, ".log");
+        if (!sealed.empty()) sealed.pop_back();
+        uint64_t raw = 0, stored = 0, elapsed = 0;
+        for (const std::string& path : sealed) {
+            uint64_t start = monotonicNs();
+            if (!MessageLog::archiveSegment(path)) {
+                std::cerr << "Error: cannot archive " << path << "\n";
+                continue;
+            }
+            elapsed += monotonicNs() - start;
+            std::string archive = path.substr(0, path.size() - 4) + ".lza";
+            struct stat info;
+            LogArchiveHeader header{};
+            int fd = open(archive.c_str(), O_RDONLY);
+            if (fd >= 0 && fstat(fd, &info) == 0 && read(fd, &header, sizeof(header)) == sizeof(header)) {
+                raw += header.rawSize;
+                stored += info.st_size;
+            }
+            if (fd >= 0) close(fd);
+        }
+        if (!sealed.empty()) {
+            std::cerr << "archived " << sealed.size() << " segment(s): " << std::fixed << std::setprecision(1) << raw / 1e6 << " MB -> "
+                      << stored / 1e6 << " MB, " << (elapsed ? raw / (elapsed / 1e9) / 1e6 : 0.0) << " MB/s\n";
+        }
+    }
+
+    ScanTotals totals;
+    bool ok = true;
+    for (const std::string& path : listFiles(dir, ".lza")) ok = scanArchive(path, print, totals) && ok;
+
+    std::ostream& out = print ? std::cerr : std::cout;
+    out << "total: " << totals.messages << " messages, " << std::fixed << std::setprecision(1) << totals.raw / 1e6 << " MB -> "
+        << totals.stored / 1e6 << " MB (" << std::setprecision(2) << (totals.stored ? static_cast<double>(totals.raw) / totals.stored : 0.0) << "x), "
+        << "scan " << std::setprecision(0) << (totals.scanNs ? totals.raw / (totals.scanNs / 1e9) / 1e6 : 0.0) << " MB/s, "
+        << "decompress " << (totals.codecNs ? totals.raw / (totals.codecNs / 1e9) / 1e6 : 0.0) << " MB/s\n" << std::flush;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,895 @@
+/**
+ * @file loadDriver.cpp
+ * @brief Load driver and benchmarks of the client (ipk25chat-load)
+ * @author Martin Mendl <x247581>
+ * @date 18.4.2025
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <sys/personality.h>
+#include <sys/ptrace.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "capture.hpp"
+#include "latency.hpp"
+
+/*
+The driver plays the server on loopback and runs the real client as a
+child process: stdin is a generated file (or a pipe), stdout goes to
+/dev/null and stderr is collected for the diagnostics the client prints
+when it exits. The child's RssAnon is sampled from /proc while it runs,
+its CPU time and peak RSS come from wait4().
+*/
+
+/// Interval of the /proc samples in milliseconds.
+#define LOAD_SAMPLE_MS 5
+/// Frames the flooding server hands to one send(), in bytes at least.
+#define LOAD_BLOCK_SIZE (256 * 1024)
+/// Share of a soak run that warms the client up (pools, buffers, history budget), in percent.
+#define LOAD_SOAK_WARM_UP 10
+/// RssAnon a soak run may grow by after warm-up, in KiB.
+#define LOAD_SOAK_GROWTH_KIB 256
+/// Socket buffers of a soak run in bytes (both ends), what is in flight is not yet handled by the client.
+#define LOAD_SOAK_BUFFER 65536
+/// Datagrams of one segmented (GSO) send at most (the kernel takes up to 64).
+#define LOAD_GSO_SEGMENTS 64
+/// Time without a CONFIRM after which the unconfirmed datagrams of the window are sent again, in milliseconds.
+#define LOAD_UDP_RETRY_MS 20
+/// Content size from which the zerocopy mode sends with MSG_ZEROCOPY.
+#define LOAD_ZEROCOPY_MIN 16384
+/// Time the client may take to connect, authenticate or exit, in milliseconds.
+#define LOAD_TIMEOUT_MS 10000
+
+// the client under test and what it left behind
+struct ClientRun {
+    pid_t pid = -1;
+    int errFd = -1;             // stderr of the client
+    std::string errors;         // everything it wrote there
+    struct rusage usage{};      // CPU time and peak RSS (ru_maxrss), once it exited
+    int status = 0;             // exit status
+    bool exited = false;
+    uint64_t peakAnonKiB = 0;   // highest sampled RssAnon
+    uint64_t lastSampleNs = 0;  // time of the last sample
+    std::vector<std::pair<uint64_t, uint64_t>> samples; // messages done -> RssAnon in KiB
+};
+
+static std::string clientPath = "./ipk25chat-client";
+
+// function to print the usage
+static void printHelp() {
+    std::cout << "Usage: ipk25chat-load <mode> [options] [-- client options]\n"
+              << "Modes:\n"
+              << "  large              MB/s and peak RSS of the client sending and receiving large MSGs over TCP\n"
+              << "  soak               Sends and receives a million MSGs, fails on pool misses or RssAnon growth after warm-up\n"
+              << "  udp                Confirmed datagrams/s of the client receiving MSGs over UDP\n"
+              << "  instructions       User-space instructions per MSG of the client replaying a capture offline\n"
+              << "  zerocopy           CPU per GB of the client sending large MSGs: copied, --zerocopy, --zerocopy-force\n"
+              << "Options:\n"
+              << "  -c <path>          Client executable (default ./ipk25chat-client)\n"
+              << "  -n <count>         Messages per direction (default 2000, soak 1000000, udp 60000, instructions 10000 or 2 single-stepped, zerocopy 10000)\n"
+              << "  -s <bytes>         Content size of a message (default 60000, soak, udp and instructions 100)\n"
+              << "  -r <KiB>           soak: RssAnon growth allowed after warm-up (default " << LOAD_SOAK_GROWTH_KIB << ")\n"
+              << "  -w <datagrams>     udp: unconfirmed datagrams in flight at most (default 64)\n"
+              << "  -g                 udp: sends the window in segmented (UDP_SEGMENT) batches\n"
+              << "  -h                 Prints this help message and exits\n" << std::flush;
+}
+
+// function to read a field of /proc/<pid>/status in KiB (0 if it is gone)
+static uint64_t procStatusKiB(pid_t pid, const char* field) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/status", static_cast<int>(pid));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+    char text[4096];
+    ssize_t length = read(fd, text, sizeof(text) - 1);
+    close(fd);
+    if (length <= 0) return 0;
+    text[length] = '\0';
+    const char* found = strstr(text, field);
+    return found != nullptr ? strtoull(found + strlen(field) + 1, nullptr, 10) : 0;
+}
+
+// function to start the client against the driver
+static bool startClient(ClientRun& run, const char* transport, int port, int inputFd, const std::vector<std::string>& extra) {
+    int errPipe[2];
+    if (pipe2(errPipe, O_CLOEXEC) == -1) return false;
+    std::vector<std::string> args = {clientPath, "-t", transport, "-s", "127.0.0.1", "-p", std::to_string(port), "--dns-cache", "off"};
+    args.insert(args.end(), extra.begin(), extra.end());
+
+    run.pid = fork();
+    if (run.pid == 0) {
+        int devNull = open("/dev/null", O_WRONLY);
+        dup2(inputFd, STDIN_FILENO);
+        dup2(devNull, STDOUT_FILENO);
+        dup2(errPipe[1], STDERR_FILENO);
+        std::vector<char*> argv;
+        for (std::string& arg : args) argv.push_back(arg.data());
+        argv.push_back(nullptr);
+        execv(argv[0], argv.data());
+        _exit(127);
+    }
+    close(errPipe[1]);
+    if (run.pid < 0) {
+        close(errPipe[0]);
+        return false;
+    }
+    run.errFd = errPipe[0];
+    fcntl(run.errFd, F_SETFL, O_NONBLOCK);
+    return true;
+}
+
+// function to collect the client's stderr and sample its memory (every LOAD_SAMPLE_MS while it runs)
+static void watchClient(ClientRun& run, uint64_t progress = 0) {
+    uint64_t now = monotonicNs();
+    if (!run.exited && now - run.lastSampleNs < LOAD_SAMPLE_MS * 1000000ull) return;
+    run.lastSampleNs = now;
+
+    char chunk[4096];
+    ssize_t length;
+    while (run.errFd >= 0 && (length = read(run.errFd, chunk, sizeof(chunk))) > 0) run.errors.append(chunk, length);
+    uint64_t anon = run.exited ? 0 : procStatusKiB(run.pid, "RssAnon:");
+    if (anon == 0) return;
+    run.peakAnonKiB = std::max(run.peakAnonKiB, anon);
+    run.samples.emplace_back(progress, anon);
+}
+
+// function to wait for the client to exit (killed after timeoutMs)
+static bool finishClient(ClientRun& run, int timeoutMs) {
+    uint64_t deadline = monotonicNs() + static_cast<uint64_t>(timeoutMs) * 1000000;
+    while (!run.exited) {
+        watchClient(run);
+        pid_t done = wait4(run.pid, &run.status, WNOHANG, &run.usage);
+        if (done == run.pid) {
+            run.exited = true;
+            break;
+        }
+        if (monotonicNs() >= deadline) {
+            kill(run.pid, SIGKILL);
+            wait4(run.pid, &run.status, 0, &run.usage);
+            run.exited = true;
+            watchClient(run);
+            return false;
+        }
+        usleep(10000);
+    }
+    watchClient(run);
+    close(run.errFd);
+    run.errFd = -1;
+    return WIFEXITED(run.status) && WEXITSTATUS(run.status) == 0;
+}
+
+// function to open the TCP listener on a free loopback port
+static int listenTcp(int& port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    struct sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    if (fd < 0 || bind(fd, (struct sockaddr*)&address, sizeof(address)) == -1 || listen(fd, 1) == -1
+        || getsockname(fd, (struct sockaddr*)&address, &length) == -1) {
+        perror("listen");
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    port = ntohs(address.sin_port);
+    return fd;
+}
+
+// counts the frames the client sends and spots its BYE, without looking at every byte
+struct FrameCounter {
+    uint64_t bytes = 0;
+    uint64_t frames = 0;
+    bool bye = false;
+    std::string head;   // first bytes of the current frame
+
+    void feed(const char* data, std::size_t size) {
+        bytes += size;
+        std::size_t offset = 0;
+        while (offset < size) {
+            if (head.size() < 4) {
+                std::size_t take = std::min<std::size_t>(4 - head.size(), size - offset);
+                head.append(data + offset, take);
+            }
+            const char* end = static_cast<const char*>(memchr(data + offset, '\n', size - offset));
+            if (end == nullptr) break;
+            if (head.compare(0, 4, "BYE ") == 0) bye = true;
+            else frames++;
+            head.clear();
+            offset = end - data + 1;
+        }
+    }
+};
+
+// function to accept the client and answer its AUTH, the rest of the first read goes to the counter
+static int acceptSession(int listener, ClientRun& run, FrameCounter& counter) {
+    struct pollfd pfd = {listener, POLLIN, 0};
+    uint64_t deadline = monotonicNs() + LOAD_TIMEOUT_MS * 1000000ull;
+    while (poll(&pfd, 1, LOAD_SAMPLE_MS) <= 0) {
+        watchClient(run);
+        if (monotonicNs() >= deadline || waitpid(run.pid, nullptr, WNOHANG) == run.pid) return -1;
+    }
+    int fd = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd < 0) return -1;
+
+    std::string received;
+    char chunk[4096];
+    std::size_t end;
+    while ((end = received.find("\r\n")) == std::string::npos) {
+        ssize_t length = recv(fd, chunk, sizeof(chunk), 0);
+        if (length <= 0) {
+            close(fd);
+            return -1;
+        }
+        received.append(chunk, length);
+    }
+    static const char reply[] = "REPLY OK IS welcome\r\n";
+    if (received.compare(0, 5, "AUTH ") != 0 || send(fd, reply, sizeof(reply) - 1, MSG_NOSIGNAL) != sizeof(reply) - 1) {
+        close(fd);
+        return -1;
+    }
+    counter.feed(received.data() + end + 2, received.size() - end - 2);
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    return fd;
+}
+
+// function to write a file of /auth and count message lines of size bytes
+static int makeInput(uint64_t count, std::size_t size) {
+    char path[] = "/tmp/ipk25chat-load-XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) return -1;
+    unlink(path);
+    std::string block = "/auth load secret loader\n";
+    std::string line(size, 'x');
+    line += '\n';
+    for (uint64_t i = 0; i < count; ++i) {
+        // every line differs, a sink could not mistake a repeated one for a retransmission
+        std::string number = std::to_string(i);
+        std::copy(number.begin(), number.end(), line.begin());
+        block += line;
+        if (block.size() < (1 << 20) && i + 1 < count) continue;
+        if (write(fd, block.data(), block.size()) != static_cast<ssize_t>(block.size())) {
+            close(fd);
+            return -1;
+        }
+        block.clear();
+    }
+    if (!block.empty() && write(fd, block.data(), block.size()) != static_cast<ssize_t>(block.size())) {
+        close(fd);
+        return -1;
+    }
+    lseek(fd, 0, SEEK_SET);
+    return fd;
+}
+
+// result of one direction
+struct Result {
+    uint64_t messages = 0;
+    uint64_t bytes = 0;
+    uint64_t elapsedNs = 0;
+    bool ok = false;
+};
+
+// function to print a result with the client's resources
+static void printResult(const char* label, const Result& result, const ClientRun& run) {
+    double seconds = result.elapsedNs / 1e9;
+    double user = run.usage.ru_utime.tv_sec + run.usage.ru_utime.tv_usec / 1e6;
+    double system = run.usage.ru_stime.tv_sec + run.usage.ru_stime.tv_usec / 1e6;
+    std::cout << std::left << std::setw(9) << label << std::right << std::fixed
+              << result.messages << " messages, " << std::setprecision(1) << result.bytes / 1e6 << " MB in "
+              << std::setprecision(3) << seconds << " s, " << std::setprecision(1) << (seconds > 0 ? result.bytes / seconds / 1e6 : 0.0) << " MB/s, "
+              << "peak RSS " << run.usage.ru_maxrss / 1024.0 << " MB (RssAnon " << run.peakAnonKiB / 1024.0 << " MB), "
+              << "cpu user " << std::setprecision(2) << user << " s sys " << system << " s"
+              << (result.ok ? "" : "  FAILED") << "\n" << std::flush;
+    // what went wrong is in the client's output (its errors and the diagnostics it printed on exit)
+    if (!result.ok) std::cerr << run.errors << std::flush;
+}
+
+// function to measure the client sending count messages (stdin is a file, EOF sends the BYE)
+static Result runSend(uint64_t count, std::size_t size, const char* transport, const std::vector<std::string>& extra, ClientRun& run) {
+    Result result;
+    int port;
+    int listener = listenTcp(port);
+    int input = makeInput(count, size);
+    if (listener < 0 || input < 0 || !startClient(run, transport, port, input, extra)) {
+        std::cerr << "Error: cannot start the client\n";
+        return result;
+    }
+    close(input);
+
+    FrameCounter counter;
+    int fd = acceptSession(listener, run, counter);
+    close(listener);
+    uint64_t start = monotonicNs();
+    char* chunk = new char[1 << 20];
+    struct pollfd pfd = {fd, POLLIN, 0};
+    while (fd >= 0 && !counter.bye) {
+        watchClient(run, counter.frames);
+        if (poll(&pfd, 1, LOAD_SAMPLE_MS) <= 0) {
+            if (waitpid(run.pid, nullptr, WNOHANG) == run.pid) break;
+            continue;
+        }
+        ssize_t length = recv(fd, chunk, 1 << 20, 0);
+        if (length < 0 && (errno == EAGAIN || errno == EINTR)) continue;
+        if (length <= 0) break;
+        counter.feed(chunk, length);
+    }
+    result.elapsedNs = monotonicNs() - start;
+    delete[] chunk;
+
+    result.messages = counter.frames;
+    result.bytes = counter.bytes;
+    result.ok = finishClient(run, LOAD_TIMEOUT_MS) && counter.bye && counter.frames == count;
+    if (fd >= 0) close(fd);
+    return result;
+}
+
+// function to measure the client receiving count messages (the server floods, then says BYE)
+static Result runReceive(uint64_t count, std::size_t size, int sendBuffer, const std::vector<std::string>& extra, ClientRun& run) {
+    Result result;
+    int port;
+    int listener = listenTcp(port);
+    int input[2];
+    if (listener < 0 || pipe2(input, O_CLOEXEC) == -1 || !startClient(run, "tcp", port, input[0], extra)) {
+        std::cerr << "Error: cannot start the client\n";
+        return result;
+    }
+    close(input[0]);
+    static const char auth[] = "/auth load secret loader\n";
+    if (write(input[1], auth, sizeof(auth) - 1) != sizeof(auth) - 1) return result;
+
+    FrameCounter counter;
+    int fd = acceptSession(listener, run, counter);
+    close(listener);
+    if (fd < 0) {
+        close(input[1]);
+        finishClient(run, LOAD_TIMEOUT_MS);
+        return result;
+    }
+    if (sendBuffer > 0) setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sendBuffer, sizeof(sendBuffer));
+
+    // the frames go out in blocks, only the counter in front of each content changes
+    std::string frame = "MSG FROM peer IS " + std::string(size, 'y') + "\r\n";
+    std::string block;
+    std::size_t offset = 0;
+    uint64_t queued = 0;
+    bool byeQueued = false, delivered = false;
+    uint64_t start = monotonicNs();
+    while (!delivered) {
+        if (offset == block.size()) {
+            block.clear();
+            offset = 0;
+            while (queued < count && block.size() < LOAD_BLOCK_SIZE) {
+                std::string number = std::to_string(queued++);
+                std::copy(number.begin(), number.end(), frame.begin() + 17);
+                block += frame;
+            }
+            if (block.empty()) {
+                block = "BYE FROM peer\r\n";
+                byeQueued = true;
+            }
+        }
+        watchClient(run, queued);
+        struct pollfd pfd = {fd, POLLOUT, 0};
+        if (poll(&pfd, 1, LOAD_SAMPLE_MS) <= 0) {
+            if (waitpid(run.pid, nullptr, WNOHANG) == run.pid) break;
+            continue;
+        }
+        if (pfd.revents & (POLLERR | POLLHUP)) break;
+        ssize_t written = send(fd, block.data() + offset, block.size() - offset, MSG_NOSIGNAL);
+        if (written < 0 && (errno == EAGAIN || errno == EINTR)) continue;
+        if (written < 0) break;
+        offset += written;
+        delivered = byeQueued && offset == block.size();
+    }
+    result.messages = delivered ? count : 0;
+    result.bytes = result.messages * frame.size();
+
+    // done once the client displayed everything and exited on the BYE
+    result.ok = finishClient(run, LOAD_TIMEOUT_MS * 6) && delivered;
+    result.elapsedNs = monotonicNs() - start;
+    close(fd);
+    close(input[1]);
+    return result;
+}
+
+// function to open a UDP socket on a free loopback port
+static int bindUdp(int& port) {
+    int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    struct sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    if (fd < 0 || bind(fd, (struct sockaddr*)&address, sizeof(address)) == -1 || getsockname(fd, (struct sockaddr*)&address, &length) == -1) {
+        perror("bind");
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    port = ntohs(address.sin_port);
+    return fd;
+}
+
+// function to build the MSG datagram with an ID, every one has the same size (GSO cuts equal segments)
+static void udpMessage(std::string& datagram, uint16_t id, std::size_t size) {
+    datagram.assign("\x04\0\0peer", 7);
+    datagram += '\0';
+    datagram[1] = static_cast<char>(id >> 8);
+    datagram[2] = static_cast<char>(id & 0xFF);
+    std::string number = std::to_string(id);
+    datagram += number;
+    datagram.append(size - std::min(size, number.size()), 'z');
+    datagram += '\0';
+}
+
+/*
+The UDP run answers the AUTH like the real server: CONFIRM from the
+welcome port, REPLY from a session port of its own (the client moves
+there, and connects its socket to it). Then up to -w MSGs are kept
+unconfirmed; a CONFIRM frees a slot. With -g the datagrams of the window
+go out in segmented sends, as a batching server would send them. A
+datagram the client did not confirm within LOAD_UDP_RETRY_MS is sent
+again (the client confirms a duplicate and drops it); a window larger than
+the client's receive buffer loses datagrams and shows up as retries.
+*/
+
+// function to measure the client confirming count MSGs
+static Result runUdp(uint64_t count, std::size_t size, int window, bool segmented, const std::vector<std::string>& extra, ClientRun& run, bool& segmentedOk, uint64_t& retries) {
+    Result result;
+    int port, sessionPort;
+    int welcome = bindUdp(port);
+    int session = bindUdp(sessionPort);
+    int input[2];
+    if (welcome < 0 || session < 0 || pipe2(input, O_CLOEXEC) == -1 || !startClient(run, "udp", port, input[0], extra)) {
+        std::cerr << "Error: cannot start the client\n";
+        return result;
+    }
+    close(input[0]);
+    static const char auth[] = "/auth load secret loader\n";
+    if (write(input[1], auth, sizeof(auth) - 1) != sizeof(auth) - 1) return result;
+
+    // AUTH on the welcome port
+    char datagram[65536];
+    struct sockaddr_in client{};
+    socklen_t clientLength = sizeof(client);
+    struct pollfd pfd = {welcome, POLLIN, 0};
+    uint64_t deadline = monotonicNs() + LOAD_TIMEOUT_MS * 1000000ull;
+    ssize_t length = -1;
+    while (length < 3 && monotonicNs() < deadline) {
+        watchClient(run);
+        if (poll(&pfd, 1, LOAD_SAMPLE_MS) <= 0) continue;
+        length = recvfrom(welcome, datagram, sizeof(datagram), 0, (struct sockaddr*)&client, &clientLength);
+        if (length >= 3 && datagram[0] != 0x02) length = -1;
+    }
+    if (length < 3) {
+        close(input[1]);
+        finishClient(run, LOAD_TIMEOUT_MS);
+        return result;
+    }
+    char confirm[3] = {0x00, datagram[1], datagram[2]};
+    sendto(welcome, confirm, sizeof(confirm), 0, (struct sockaddr*)&client, clientLength);
+    connect(session, (struct sockaddr*)&client, clientLength);
+    std::string reply("\x01\0\0\x01", 4);
+    reply += datagram[1];
+    reply += datagram[2];
+    reply.append("welcome", 8);
+    send(session, reply.data(), reply.size(), 0);
+    fcntl(session, F_SETFL, O_NONBLOCK);
+
+    // the window: ID i is slot i % window, confirmed or not
+    count = std::min<uint64_t>(count, 65534);
+    std::vector<bool> confirmed(count + 2, false);
+    std::vector<uint64_t> sentNs(count + 2, 0);
+    uint64_t next = 1, base = 1, done = 0;
+    std::string message, batch;
+    udpMessage(message, 1, size);
+    std::size_t segmentSize = message.size();
+    uint64_t start = monotonicNs(), lastConfirmNs = start;
+    retries = 0;
+    segmentedOk = segmented;
+    pfd = {session, POLLIN, 0};
+
+    while (done < count) {
+        watchClient(run, done);
+        uint64_t now = monotonicNs();
+
+        // fill the window, in segmented batches if asked to
+        while (next <= count && next - base < static_cast<uint64_t>(window)) {
+            batch.clear();
+            uint64_t first = next;
+            int segments = segmentedOk ? LOAD_GSO_SEGMENTS : 1;
+            for (int i = 0; i < segments && next <= count && next - base < static_cast<uint64_t>(window); ++i, ++next) {
+                udpMessage(message, static_cast<uint16_t>(next), size);
+                batch += message;
+                sentNs[next] = now;
+            }
+            struct iovec vector = {batch.data(), batch.size()};
+            struct msghdr header{};
+            header.msg_iov = &vector;
+            header.msg_iovlen = 1;
+            alignas(cmsghdr) char control[CMSG_SPACE(sizeof(uint16_t))] = {};
+            if (next - first > 1) {
+                header.msg_control = control;
+                header.msg_controllen = sizeof(control);
+                cmsghdr* option = CMSG_FIRSTHDR(&header);
+                option->cmsg_level = SOL_UDP;
+                option->cmsg_type = UDP_SEGMENT;
+                option->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+                uint16_t segment = static_cast<uint16_t>(segmentSize);
+                memcpy(CMSG_DATA(option), &segment, sizeof(segment));
+            }
+            if (sendmsg(session, &header, 0) >= 0) continue;
+            if (errno == EAGAIN) {
+                next = first; // the socket buffer is full, the CONFIRMs make room
+                break;
+            }
+            // the kernel cannot segment, one datagram per send from now on
+            if (header.msg_control != nullptr && (errno == EIO || errno == EINVAL || errno == ENOPROTOOPT || errno == EOPNOTSUPP)) {
+                segmentedOk = false;
+                next = first;
+                continue;
+            }
+            perror("sendmsg");
+            break;
+        }
+
+        // the unconfirmed datagrams past their time go again
+        if (base < next && now - sentNs[base] >= LOAD_UDP_RETRY_MS * 1000000ull) {
+            for (uint64_t id = base; id < next; ++id) {
+                if (confirmed[id] || now - sentNs[id] < LOAD_UDP_RETRY_MS * 1000000ull) continue;
+                udpMessage(message, static_cast<uint16_t>(id), size);
+                send(session, message.data(), message.size(), 0);
+                sentNs[id] = now;
+                retries++;
+            }
+        }
+        if (now - lastConfirmNs >= LOAD_TIMEOUT_MS * 1000000ull) {
+            std::cerr << "Error: no CONFIRM in " << LOAD_TIMEOUT_MS << " ms\n";
+            break;
+        }
+
+        if (poll(&pfd, 1, LOAD_UDP_RETRY_MS) <= 0) continue;
+        while ((length = recv(session, datagram, sizeof(datagram), 0)) >= 3) {
+            if (datagram[0] != 0x00) continue;
+            uint64_t id = static_cast<uint8_t>(datagram[1]) << 8 | static_cast<uint8_t>(datagram[2]);
+            if (id == 0 || id > count || confirmed[id]) continue;
+            confirmed[id] = true;
+            done++;
+            lastConfirmNs = monotonicNs();
+        }
+        while (base <= count && confirmed[base]) base++;
+    }
+    result.elapsedNs = monotonicNs() - start;
+    result.messages = done;
+    result.bytes = done * segmentSize;
+
+    // BYE, the client confirms it and exits
+    std::string bye("\xff\0\0peer", 7);
+    bye += '\0';
+    bye[1] = static_cast<char>((count + 1) >> 8);
+    bye[2] = static_cast<char>((count + 1) & 0xFF);
+    send(session, bye.data(), bye.size(), 0);
+    result.ok = finishClient(run, LOAD_TIMEOUT_MS) && done == count;
+    close(input[1]);
+    close(welcome);
+    close(session);
+    return result;
+}
+
+// function to write a TCP capture: AUTH, its REPLY, count received MSGs and BYE
+static bool writeCapture(const std::string& path, uint64_t count, std::size_t size) {
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file == nullptr) return false;
+    CaptureFileHeader header{};
+    memcpy(header.magic, CAPTURE_MAGIC, sizeof(header.magic));
+    header.transport = static_cast<uint8_t>(Mode::TCP);
+    fwrite(&header, sizeof(header), 1, file);
+    uint64_t ns = 0;
+    auto record = [&](bool outgoing, const std::string& data) {
+        CaptureRecordHeader chunk{};
+        chunk.ns = ns += 1000;
+        chunk.length = static_cast<uint32_t>(data.size());
+        chunk.outgoing = outgoing;
+        fwrite(&chunk, sizeof(chunk), 1, file);
+        fwrite(data.data(), 1, data.size(), file);
+    };
+    record(true, "AUTH load AS loader USING secret\r\n");
+    record(false, "REPLY OK IS welcome\r\n");
+    std::string content(size, 'x');
+    for (uint64_t i = 0; i < count; ++i) {
+        std::string number = std::to_string(i);
+        std::copy(number.begin(), number.end(), content.begin());
+        record(false, "MSG FROM peer IS " + content + "\r\n");
+    }
+    record(true, "BYE FROM loader\r\n");
+    return fclose(file) == 0;
+}
+
+/*
+Instructions are counted in user space only, so the kernel's share of
+writing the output does not blur the difference between two builds. With
+a PMU the child gets a hardware counter that starts at exec; without one
+(virtual machines often have none) it is single-stepped with ptrace,
+which is exact but slow, and misses threads the client starts (they only
+do startup work). Startup cancels out: the same client replays count and
+2 * count MSGs, the difference is divided by count.
+*/
+
+// function to run the client on a capture and count its user-space instructions
+static bool countInstructions(const std::string& capture, const std::vector<std::string>& extra, bool hardware, uint64_t& instructions) {
+    std::vector<std::string> args = {clientPath, "-t", "tcp", "-s", "127.0.0.1", "--replay", capture};
+    args.insert(args.end(), extra.begin(), extra.end());
+    int start[2];
+    if (pipe2(start, O_CLOEXEC) == -1) return false;
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        int devNull = open("/dev/null", O_RDWR);
+        dup2(devNull, STDIN_FILENO);
+        dup2(devNull, STDOUT_FILENO);
+        dup2(devNull, STDERR_FILENO);
+        // the counter is attached (or the tracer ready) before the client starts
+        char go;
+        close(start[1]);
+        if (read(start[0], &go, 1) != 1) _exit(127);
+        // the same addresses every run, the startup of two runs then takes the same instructions
+        personality(ADDR_NO_RANDOMIZE);
+        if (!hardware && ptrace(PTRACE_TRACEME, 0, nullptr, nullptr) == -1) _exit(127);
+        std::vector<char*> argv;
+        for (std::string& arg : args) argv.push_back(arg.data());
+        argv.push_back(nullptr);
+        execv(argv[0], argv.data());
+        _exit(127);
+    }
+    close(start[0]);
+    if (pid < 0) {
+        close(start[1]);
+        return false;
+    }
+
+    int counter = -1;
+    if (hardware) {
+        struct perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+        attr.disabled = 1;
+        attr.enable_on_exec = 1;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        counter = static_cast<int>(syscall(SYS_perf_event_open, &attr, pid, -1, -1, PERF_FLAG_FD_CLOEXEC));
+    }
+    bool started = (!hardware || counter >= 0) && write(start[1], "g", 1) == 1;
+    close(start[1]);
+    int status = 0;
+    instructions = 0;
+    if (!started) {
+        kill(pid, SIGKILL);
+        waitpid(pid, &status, 0);
+        if (counter >= 0) close(counter);
+        return false;
+    }
+
+    if (hardware) {
+        waitpid(pid, &status, 0);
+        if (read(counter, &instructions, sizeof(instructions)) != sizeof(instructions)) instructions = 0;
+        close(counter);
+    } else {
+        // the first stop is the exec, every following SIGTRAP is one instruction
+        bool exec = true;
+        while (waitpid(pid, &status, 0) == pid && WIFSTOPPED(status)) {
+            int signal = WSTOPSIG(status);
+            if (signal == SIGTRAP) {
+                if (!exec) instructions++;
+                exec = false;
+                signal = 0;
+            }
+            if (ptrace(PTRACE_SINGLESTEP, pid, nullptr, reinterpret_cast<void*>(static_cast<long>(signal))) == -1) break;
+        }
+    }
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 && instructions > 0;
+}
+
+// function to check for a hardware instruction counter
+static bool hasInstructionCounter() {
+    struct perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    int counter = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC));
+    if (counter < 0) return false;
+    close(counter);
+    return true;
+}
+
+// function to read a counter from the diagnostics the client printed (-1 if it is not there)
+static long long counterValue(const std::string& errors, const std::string& name) {
+    std::size_t found = errors.rfind(" " + name + "=");
+    if (found == std::string::npos) found = errors.rfind("\n" + name + "=");
+    if (found == std::string::npos) return -1;
+    return strtoll(errors.c_str() + found + name.size() + 2, nullptr, 10);
+}
+
+// function to check a soak run: no pool misses, RssAnon flat once the client warmed up
+static bool checkSoak(const char* label, uint64_t count, uint64_t toleranceKiB, const ClientRun& run) {
+    uint64_t warmUp = count * LOAD_SOAK_WARM_UP / 100;
+    uint64_t warmKiB = 0, laterKiB = 0, laterSamples = 0;
+    for (const auto& [progress, anon] : run.samples) {
+        if (progress <= warmUp) warmKiB = std::max(warmKiB, anon);
+        else {
+            laterKiB = std::max(laterKiB, anon);
+            laterSamples++;
+        }
+    }
+    long long misses = counterValue(run.errors, "pool-misses");
+    uint64_t growth = laterKiB > warmKiB ? laterKiB - warmKiB : 0;
+    bool ok = misses == 0 && laterSamples > 0 && growth <= toleranceKiB;
+    std::cout << std::left << std::setw(9) << label << std::right << "RssAnon " << warmKiB << " KiB after warm-up, "
+              << laterKiB << " KiB at most afterwards (+" << growth << " KiB, " << laterSamples << " samples), pool-misses=" << misses
+              << (ok ? "  ok" : "  FAILED") << "\n" << std::flush;
+    return ok;
+}
+
+int main(int argc, char* argv[]) {
+    std::string mode;
+    uint64_t count = 0;
+    std::size_t size = 0;
+    uint64_t toleranceKiB = LOAD_SOAK_GROWTH_KIB;
+    int window = 64;
+    bool segmented = false;
+    std::vector<std::string> extra;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--") {
+            extra.assign(argv + i + 1, argv + argc);
+            break;
+        }
+        if (arg == "-c" && i + 1 < argc) {
+            clientPath = argv[++i];
+            continue;
+        }
+        if (arg == "-n" && i + 1 < argc) {
+            count = strtoull(argv[++i], nullptr, 10);
+            continue;
+        }
+        if (arg == "-s" && i + 1 < argc) {
+            size = std::clamp<std::size_t>(strtoull(argv[++i], nullptr, 10), 16, 60000);
+            continue;
+        }
+        if (arg == "-r" && i + 1 < argc) {
+            toleranceKiB = strtoull(argv[++i], nullptr, 10);
+            continue;
+        }
+        if (arg == "-w" && i + 1 < argc) {
+            window = std::max(1, atoi(argv[++i]));
+            continue;
+        }
+        if (arg == "-g") {
+            segmented = true;
+            continue;
+        }
+        if (arg == "-h") {
+            printHelp();
+            return 0;
+        }
+        if (mode.empty() && arg[0] != '-') {
+            mode = arg;
+            continue;
+        }
+        std::cerr << "Error: unknown argument " << arg << "\n";
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    if (mode == "large") {
+        if (count == 0) count = 2000;
+        if (size == 0) size = 60000;
+        ClientRun sender, receiver;
+        Result sent = runSend(count, size, "tcp", extra, sender);
+        printResult("send:", sent, sender);
+        Result received = runReceive(count, size, 0, extra, receiver);
+        printResult("receive:", received, receiver);
+        return sent.ok && received.ok ? 0 : 1;
+    }
+    if (mode == "soak") {
+        if (count == 0) count = 1000000;
+        if (size == 0) size = 100;
+        // the history would grow until its 64 MiB default budget, a small one is full during warm-up;
+        // a small receive buffer keeps the client close to what the driver counts as sent
+        extra.insert(extra.begin(), {"--history-mb", "1", "--rcvbuf", std::to_string(LOAD_SOAK_BUFFER)});
+        ClientRun sender, receiver;
+        Result sent = runSend(count, size, "tcp", extra, sender);
+        printResult("send:", sent, sender);
+        bool sendFlat = checkSoak("send:", count, toleranceKiB, sender);
+        Result received = runReceive(count, size, LOAD_SOAK_BUFFER, extra, receiver);
+        printResult("receive:", received, receiver);
+        bool receiveFlat = checkSoak("receive:", count, toleranceKiB, receiver);
+        return sent.ok && received.ok && sendFlat && receiveFlat ? 0 : 1;
+    }
+    if (mode == "udp") {
+        if (count == 0) count = 60000;
+        if (size == 0) size = 100;
+        ClientRun receiver;
+        bool segmentedOk = false;
+        uint64_t retries = 0;
+        Result confirmed = runUdp(count, size, window, segmented, extra, receiver, segmentedOk, retries);
+        double seconds = confirmed.elapsedNs / 1e9;
+        std::cout << "udp:     " << confirmed.messages << " datagrams confirmed in " << std::fixed << std::setprecision(3) << seconds << " s, "
+                  << std::setprecision(0) << (seconds > 0 ? confirmed.messages / seconds : 0.0) << " datagrams/s, window " << window << ", retries " << retries
+                  << (segmented ? (segmentedOk ? ", segmented sends" : ", segmented sends refused by the kernel") : "")
+                  << ", client gro-receives=" << counterValue(receiver.errors, "gro-receives")
+                  << " confirm-batches=" << counterValue(receiver.errors, "confirm-batches") << "\n";
+        printResult("client:", confirmed, receiver);
+        return confirmed.ok ? 0 : 1;
+    }
+    if (mode == "instructions") {
+        bool hardware = hasInstructionCounter();
+        if (count == 0) count = hardware ? 10000 : 2; // single-stepping takes about 10 us per instruction
+        if (size == 0) size = 100;
+        char directory[] = "/tmp/ipk25chat-load-XXXXXX";
+        if (mkdtemp(directory) == nullptr) {
+            perror("mkdtemp");
+            return 1;
+        }
+        std::string single = std::string(directory) + "/single", twice = std::string(directory) + "/twice";
+        uint64_t once = 0, doubled = 0;
+        bool ok = writeCapture(single, count, size) && writeCapture(twice, 2 * count, size)
+            && countInstructions(single, extra, hardware, once) && countInstructions(twice, extra, hardware, doubled);
+        unlink(single.c_str());
+        unlink(twice.c_str());
+        rmdir(directory);
+        if (!ok || doubled < once) {
+            std::cerr << "Error: the replay of " << clientPath << " failed\n";
+            return 1;
+        }
+        std::cout << std::left << std::setw(30) << clientPath << std::right << " " << (doubled - once) / count << " instructions per MSG ("
+                  << (hardware ? "hardware counter" : "ptrace single-step") << ", user space, " << count << " vs " << 2 * count
+                  << " MSGs, startup " << once - (doubled - once) << ")\n";
+        return 0;
+    }
+    if (mode == "zerocopy") {
+        if (count == 0) count = 10000;
+        if (size == 0) size = 60000;
+        // the same sends copied, with zero-copy (falls back once the kernel copies), and with zero-copy kept
+        static const std::vector<std::pair<const char*, std::vector<std::string>>> variants = {
+            {"copy:", {}},
+            {"zc:", {"--zerocopy", std::to_string(LOAD_ZEROCOPY_MIN)}},
+            {"forced:", {"--zerocopy", std::to_string(LOAD_ZEROCOPY_MIN), "--zerocopy-force"}},
+        };
+        bool ok = true;
+        for (const auto& [label, options] : variants) {
+            std::vector<std::string> arguments = options;
+            arguments.insert(arguments.end(), extra.begin(), extra.end());
+            ClientRun sender;
+            Result sent = runSend(count, size, "tcp", arguments, sender);
+            printResult(label, sent, sender);
+            double cpu = sender.usage.ru_utime.tv_sec + sender.usage.ru_utime.tv_usec / 1e6 + sender.usage.ru_stime.tv_sec + sender.usage.ru_stime.tv_usec / 1e6;
+            std::cout << std::left << std::setw(9) << "" << std::right << std::setprecision(3)
+                      << (sent.bytes > 0 ? cpu / (sent.bytes / 1e9) : 0.0) << " cpu s/GB, zerocopy-sends=" << counterValue(sender.errors, "zerocopy-sends")
+                      << " zerocopy-copied=" << counterValue(sender.errors, "zerocopy-copied") << "\n";
+            ok = ok && sent.ok;
+        }
+        return ok ? 0 : 1;
+    }
+    printHelp();
+    return 1;
+}
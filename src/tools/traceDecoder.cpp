@@ -0,0 +1,126 @@
+/**
+ * @file traceDecoder.cpp
+ * @brief Decoder printing the timeline of a binary trace file (ipk25chat-trace)
+ * @author Martin Mendl <x247581>
+ * @date 18.4.2025
+ */
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <cstring>
+#include "trace.hpp"
+
+// function to get a printable name of an event kind
+static const char* kindName(uint8_t kind) {
+    static const char* names[] = {"SEND", "RECV", "CONFIRM", "RETRANSMIT", "TIMEOUT", "STATE", "DROP"};
+    return kind < sizeof(names) / sizeof(names[0]) ? names[kind] : "?";
+}
+
+// function to get a printable name of a FSM state
+static const char* stateName(unsigned state) {
+    static const char* names[] = {"START", "AUTH", "OPEN", "JOIN", "END"};
+    return state < sizeof(names) / sizeof(names[0]) ? names[state] : "?";
+}
+
+// function to get a printable name of a message type
+static const char* typeName(unsigned type) {
+    static const char* names[] = {"AUTH", "BYE", "CONFIRM", "ERR", "JOIN", "MSG", "PING", "REPLY OK", "REPLY NOK", "-"};
+    return type < sizeof(names) / sizeof(names[0]) ? names[type] : "?";
+}
+
+// function to print the usage
+static void printHelp() {
+    std::cout << "Usage: ipk25chat-trace <file> [options]\n"
+              << "Options:\n"
+              << "  -m <id>            Only prints events of the given message ID\n"
+              << "  -h                 Prints this help message and exits\n" << std::flush;
+}
+
+int main(int argc, char* argv[]) {
+
+    std::string path;
+    long onlyId = -1;
+
+    // parse args
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-m" && i + 1 < argc) {
+            onlyId = std::stol(argv[++i]);
+            continue;
+        }
+        if (arg == "-h") {
+            printHelp();
+            return 0;
+        }
+        if (path.empty() && arg[0] != '-') {
+            path = arg;
+            continue;
+        }
+        std::cerr << "ERROR: Unknown or malformed argument: " << arg << "\n";
+        return 1;
+    }
+    if (path.empty()) {
+        printHelp();
+        return 1;
+    }
+
+    // read the header
+    std::ifstream file(path, std::ios::binary);
+    TraceHeader header{};
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0) {
+        std::cerr << "ERROR: " << path << " is not a trace file\n";
+        return 1;
+    }
+    if (header.version != TRACE_VERSION) {
+        std::cerr << "ERROR: unsupported trace version " << header.version << "\n";
+        return 1;
+    }
+
+    std::vector<TraceRecord> records(header.records);
+    if (!file.read(reinterpret_cast<char*>(records.data()), records.size() * sizeof(TraceRecord))) {
+        std::cerr << "ERROR: trace file is truncated\n";
+        return 1;
+    }
+
+    // ticks -> ns, scaled by the two clock pairs taken by the client
+    double nsPerTick = 1.0;
+    if (header.ticksEnd > header.ticksStart && header.nsEnd > header.nsStart) {
+        nsPerTick = static_cast<double>(header.nsEnd - header.nsStart) / (header.ticksEnd - header.ticksStart);
+    }
+
+    std::cout << "trace: " << header.records << " records, " << header.written << " emitted, "
+              << header.written - header.records << " overwritten, "
+              << std::fixed << std::setprecision(3) << 1.0 / nsPerTick << " ticks/ns\n";
+    std::cout << std::right << std::setw(14) << "time(us)" << std::setw(12) << "delta(us)" << "  "
+              << std::left << std::setw(12) << "event" << std::setw(7) << "state"
+              << std::setw(11) << "type" << std::right << std::setw(7) << "msg-id" << std::setw(9) << "size" << "\n";
+
+    if (records.empty()) return 0;
+    uint64_t origin = records.front().ticks;
+    uint64_t previous = origin;
+
+    for (const TraceRecord& record : records) {
+        if (onlyId >= 0 && record.msgId != onlyId) continue;
+
+        double time = (record.ticks - origin) * nsPerTick / 1000.0;
+        double delta = (record.ticks - previous) * nsPerTick / 1000.0;
+        previous = record.ticks;
+
+        std::cout << std::right << std::setw(14) << time << std::setw(12) << delta << "  "
+                  << std::left << std::setw(12) << kindName(record.kind)
+                  << std::setw(7) << stateName(record.info >> 4)
+                  << std::setw(11) << typeName(record.info & 0x0F) << std::right
+                  << std::setw(7) << record.msgId;
+
+        // a state change carries the previous state instead of a size
+        if (record.kind == static_cast<uint8_t>(TraceKind::STATE)) {
+            std::cout << "  (from " << stateName(record.size) << ")\n";
+        } else {
+            std::cout << std::setw(9) << record.size << "\n";
+        }
+    }
+    return 0;
+}
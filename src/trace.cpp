@@ -0,0 +1,63 @@
+/**
+ * @file trace.cpp
+ * @brief Implementation of the Trace ring dump
+ * @author Martin Mendl <x247581>
+ * @date 18.4.2025
+*/
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include "trace.hpp"
+
+TraceRecord Trace::ring[TRACE_CAPACITY];
+std::atomic<uint64_t> Trace::head{0};
+std::string Trace::output;
+
+// clock pair taken at start-up, the decoder scales ticks between it and the dump pair
+static const uint64_t startTicks = Trace::ticks();
+static const uint64_t startNs = monotonicNs();
+
+// function to write a whole buffer
+static bool writeAll(int fd, const void* data, size_t size) {
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t written = write(fd, bytes, size);
+        if (written < 0) return false;
+        bytes += written;
+        size -= written;
+    }
+    return true;
+}
+
+// Method to write the ring to the output file
+bool Trace::dump() {
+    if (output.empty()) return false;
+
+    uint64_t written = head.load(std::memory_order_relaxed);
+    uint64_t records = written < TRACE_CAPACITY ? written : TRACE_CAPACITY;
+    uint64_t first = written - records; // oldest record still in the ring
+
+    TraceHeader header{};
+    memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.version = TRACE_VERSION;
+    header.records = static_cast<uint32_t>(records);
+    header.written = written;
+    header.ticksStart = startTicks;
+    header.nsStart = startNs;
+    header.ticksEnd = ticks();
+    header.nsEnd = monotonicNs();
+
+    int fd = open(output.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+
+    // the ring wraps, write it as (at most) two runs in chronological order
+    uint64_t start = first & (TRACE_CAPACITY - 1);
+    uint64_t firstRun = std::min<uint64_t>(records, TRACE_CAPACITY - start);
+    bool ok = writeAll(fd, &header, sizeof(header))
+           && writeAll(fd, &ring[start], firstRun * sizeof(TraceRecord))
+           && writeAll(fd, &ring[0], (records - firstRun) * sizeof(TraceRecord));
+    close(fd);
+    return ok;
+}